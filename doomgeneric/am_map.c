@@ -90,7 +90,7 @@
 #define INITSCALEMTOF (.2*FRACUNIT)
 // how much the automap moves window per tic in frame-buffer coordinates
 // moves 140 pixels in 1 second
-#define F_PANINC	4
+#define F_PANINC	(4 << hires)
 // how much zoom-in per tic
 // goes to 2x in 1 second
 #define M_ZOOMIN        ((int) (1.02*FRACUNIT))
@@ -198,8 +198,6 @@ static int 	grid = 0;
 static int 	leveljuststarted = 1; 	// kluge until AM_LevelInit() is called
 
 boolean    	automapactive = false;
-static int 	finit_width = SCREENWIDTH;
-static int 	finit_height = SCREENHEIGHT - 32;
 
 // location of window on screen
 static int 	f_x;
@@ -519,9 +517,10 @@ void AM_LevelInit(void)
 {
     leveljuststarted = 0;
 
+    // The map is drawn in screen pixels, above the status bar.
     f_x = f_y = 0;
-    f_w = finit_width;
-    f_h = finit_height;
+    f_w = SCREENWIDTH;
+    f_h = SCREENHEIGHT - (ST_HEIGHT << hires);
 
     AM_clearMarks();
 
@@ -833,7 +832,17 @@ void AM_Ticker (void)
 //
 void AM_clearFB(int color)
 {
-    memset(fb, color, f_w*f_h);
+    int x;
+
+    if (!colmajor)
+    {
+	memset(fb, color, f_w*f_h);
+	return;
+    }
+
+    // the automap is the top of each column
+    for (x=0 ; x<f_w ; x++)
+	memset(fb + SCREENOFS(x, 0), color, f_h);
 }
 
 
@@ -1007,7 +1016,7 @@ AM_drawFline
 	return;
     }
 
-#define PUTDOT(xx,yy,cc) fb[(yy)*f_w+(xx)]=(cc)
+#define PUTDOT(xx,yy,cc) fb[SCREENOFS(xx,yy)]=(cc)
 
     dx = fl->b.x - fl->a.x;
     ax = 2 * (dx<0 ? -dx : dx);
@@ -1318,12 +1327,12 @@ void AM_drawMarks(void)
 	{
 	    //      w = SHORT(marknums[i]->width);
 	    //      h = SHORT(marknums[i]->height);
-	    w = 5; // because something's wrong with the wad, i guess
-	    h = 6; // because something's wrong with the wad, i guess
+	    w = 5 << hires; // because something's wrong with the wad, i guess
+	    h = 6 << hires; // because something's wrong with the wad, i guess
 	    fx = CXMTOF(markpoints[i].x);
 	    fy = CYMTOF(markpoints[i].y);
 	    if (fx >= f_x && fx <= f_w - w && fy >= f_y && fy <= f_h - h)
-		V_DrawPatch(fx, fy, marknums[i]);
+		V_DrawPatch(fx >> hires, fy >> hires, marknums[i]);
 	}
     }
 
@@ -1331,7 +1340,9 @@ void AM_drawMarks(void)
 
 void AM_drawCrosshair(int color)
 {
-    fb[(f_w*(f_h+1))/2] = color; // single point for now
+    int center = (f_w*(f_h+1))/2;
+
+    fb[SCREENOFS(center % f_w, center / f_w)] = color; // single point for now
 
 }
 
@@ -1350,6 +1361,6 @@ void AM_Drawer (void)
 
     AM_drawMarks();
 
-    V_MarkRect(f_x, f_y, f_w, f_h);
+    V_MarkRect(f_x >> hires, f_y >> hires, f_w >> hires, f_h >> hires);
 
 }
@@ -1,5 +1,35 @@
+
+# All harts start here (QEMU '-bios none'): hart 0 boots the kernel on the
+# main stack, the others get their own stack and park in smp_hart_entry()
+# until the job system (smp.c) has work for them. Each hart sets up its
+# thread-local storage block (tp) before running any C code using it.
+
+.equ SMP_MAX_HARTS, 8
+.equ HART_STACK_SIZE, 0x100000
+
 .global _start
 _start:
+    csrr t0, mhartid
+    bnez t0, secondary
     lla sp, _stack_top
+    li a0, 0
+    jal smp_tls_setup
+    li a0, 0                # no command line: argc = 0, argv = NULL
+    li a1, 0
     jal main
     j .
+
+secondary:
+    li t1, SMP_MAX_HARTS
+    bgeu t0, t1, park
+    # stack of hart N: _hart_stack_top - (N-1) * HART_STACK_SIZE
+    lla sp, _hart_stack_top
+    addi t1, t0, -1
+    li t2, HART_STACK_SIZE
+    mul t1, t1, t2
+    sub sp, sp, t1
+    mv a0, t0
+    jal smp_hart_entry
+park:
+    wfi
+    j park
@@ -0,0 +1,488 @@
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	Golden digests of the world state and of the screen.
+//	After every tic, the mobjs, sectors and players are hashed;
+//	 after every frame, the screen. The digests are printed as
+//	 "golden: tic=<n> <subsystem>=<sha1>" lines, and a log of a
+//	 previous run can be given back with -goldenfile: the game
+//	 stops at the first tic where a subsystem differs.
+//
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "doomstat.h"
+#include "d_golden.h"
+#include "i_system.h"
+#include "i_video.h"
+#include "m_argv.h"
+#include "m_misc.h"
+#include "p_local.h"
+#include "sha1.h"
+#include "w_file.h"
+
+
+typedef enum
+{
+    golden_mobjs,
+    golden_sectors,
+    golden_players,
+    golden_video,
+    NUMGOLDEN
+
+} goldensub_t;
+
+static char*		goldennames[NUMGOLDEN] =
+{
+    "mobjs",
+    "sectors",
+    "players",
+    "video",
+};
+
+// Reference digests of one tic.
+typedef struct
+{
+    sha1_digest_t	digests[NUMGOLDEN];
+    int			present;	// bit per subsystem
+
+} goldentic_t;
+
+static boolean		golden;
+static char*		goldenfile;
+static goldentic_t*	reference;
+static int		numreference;
+static int		checked[NUMGOLDEN];
+static int		lastframetic = -1;
+
+// play simulation random number index, see m_random.c
+extern int		prndindex;
+
+
+//
+// Hex strings
+//
+static void D_DigestToHex (char* hex, sha1_digest_t digest)
+{
+    static const char	digits[] = "0123456789abcdef";
+    int			i;
+
+    for (i = 0; i < sizeof(sha1_digest_t); i++)
+    {
+	hex[i * 2] = digits[digest[i] >> 4];
+	hex[i * 2 + 1] = digits[digest[i] & 15];
+    }
+    hex[i * 2] = '\0';
+}
+
+static int D_HexDigit (char c)
+{
+    if (c >= '0' && c <= '9')
+	return c - '0';
+    if (c >= 'a' && c <= 'f')
+	return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F')
+	return c - 'A' + 10;
+    return -1;
+}
+
+static boolean D_HexToDigest (sha1_digest_t digest, char* hex)
+{
+    int		i;
+    int		hi, lo;
+
+    for (i = 0; i < sizeof(sha1_digest_t); i++)
+    {
+	hi = D_HexDigit (hex[i * 2]);
+	lo = hi < 0 ? -1 : D_HexDigit (hex[i * 2 + 1]);
+
+	if (lo < 0)
+	    return false;
+
+	digest[i] = (hi << 4) | lo;
+    }
+
+    return true;
+}
+
+
+//
+// Reference file
+//
+
+static goldentic_t* D_ReferenceTic (int tic)
+{
+    int		newsize;
+
+    if (tic >= numreference)
+    {
+	newsize = numreference ? numreference : 1024;
+
+	while (newsize <= tic)
+	    newsize *= 2;
+
+	reference = realloc (reference, newsize * sizeof(*reference));
+
+	if (reference == NULL)
+	    I_Error ("D_ReferenceTic: no memory for %d tics", newsize);
+
+	memset (reference + numreference, 0,
+		(newsize - numreference) * sizeof(*reference));
+	numreference = newsize;
+    }
+
+    return &reference[tic];
+}
+
+// Parses "golden: tic=<n> <subsystem>=<sha1> ..."; other lines
+//  are ignored, so the whole log of a run can be given.
+static void D_ParseGoldenLine (char* line)
+{
+    goldentic_t*	ref;
+    char*		p;
+    char*		value;
+    int			tic;
+    int			i;
+
+    p = strstr (line, "golden: tic=");
+
+    if (p == NULL)
+	return;
+
+    tic = atoi (p + 12);
+
+    if (tic < 0)
+	return;
+
+    ref = D_ReferenceTic (tic);
+
+    for (p = strchr (p + 12, ' '); p != NULL; p = strchr (p, ' '))
+    {
+	p++;
+	value = strchr (p, '=');
+
+	if (value == NULL)
+	    break;
+
+	value++;
+
+	for (i = 0; i < NUMGOLDEN; i++)
+	{
+	    if (!strncmp (p, goldennames[i], value - 1 - p)
+	     && strlen (goldennames[i]) == value - 1 - p
+	     && D_HexToDigest (ref->digests[i], value))
+	    {
+		ref->present |= 1 << i;
+	    }
+	}
+    }
+}
+
+static void D_LoadGoldenFile (char* name)
+{
+    wad_file_t*	file;
+    char*	text;
+    char*	line;
+    char*	next;
+    int		i;
+    int		tics;
+
+    file = W_OpenFile (name);
+
+    if (file == NULL)
+	I_Error ("D_LoadGoldenFile: couldn't open %s", name);
+
+    text = malloc (file->length + 1);
+    W_Read (file, 0, text, file->length);
+    text[file->length] = '\0';
+    W_CloseFile (file);
+
+    for (line = text; line != NULL; line = next)
+    {
+	next = strchr (line, '\n');
+
+	if (next != NULL)
+	    *next++ = '\0';
+
+	D_ParseGoldenLine (line);
+    }
+
+    free (text);
+
+    tics = 0;
+
+    for (i = 0; i < numreference; i++)
+    {
+	if (reference[i].present)
+	    tics++;
+    }
+
+    printf ("D_LoadGoldenFile: %d tics of digests in %s\n", tics, name);
+}
+
+
+//
+// Digests
+//
+
+static void D_HashMobjs (sha1_context_t* context)
+{
+    thinker_t*	th;
+    mobj_t*	mo;
+
+    for (th = thinkercap.next; th != &thinkercap; th = th->next)
+    {
+	if (th->function.acp1 != (actionf_p1) P_MobjThinker)
+	    continue;
+
+	mo = (mobj_t *) th;
+
+	SHA1_UpdateInt32 (context, mo->type);
+	SHA1_UpdateInt32 (context, mo->x);
+	SHA1_UpdateInt32 (context, mo->y);
+	SHA1_UpdateInt32 (context, mo->z);
+	SHA1_UpdateInt32 (context, mo->angle);
+	SHA1_UpdateInt32 (context, mo->momx);
+	SHA1_UpdateInt32 (context, mo->momy);
+	SHA1_UpdateInt32 (context, mo->momz);
+	SHA1_UpdateInt32 (context, mo->floorz);
+	SHA1_UpdateInt32 (context, mo->ceilingz);
+	SHA1_UpdateInt32 (context, mo->state - states);
+	SHA1_UpdateInt32 (context, mo->tics);
+	SHA1_UpdateInt32 (context, mo->frame);
+	SHA1_UpdateInt32 (context, mo->flags);
+	SHA1_UpdateInt32 (context, mo->health);
+	SHA1_UpdateInt32 (context, mo->movedir);
+	SHA1_UpdateInt32 (context, mo->movecount);
+	SHA1_UpdateInt32 (context, mo->reactiontime);
+	SHA1_UpdateInt32 (context, mo->threshold);
+	SHA1_UpdateInt32 (context, mo->target != NULL);
+    }
+
+    // The random number generator is advanced by the mobjs.
+    SHA1_UpdateInt32 (context, prndindex);
+}
+
+static void D_HashSectors (sha1_context_t* context)
+{
+    sector_t*	sec;
+    int		i;
+
+    for (i = 0, sec = sectors; i < numsectors; i++, sec++)
+    {
+	SHA1_UpdateInt32 (context, sec->floorheight);
+	SHA1_UpdateInt32 (context, sec->ceilingheight);
+	SHA1_UpdateInt32 (context, sec->floorpic);
+	SHA1_UpdateInt32 (context, sec->ceilingpic);
+	SHA1_UpdateInt32 (context, sec->lightlevel);
+	SHA1_UpdateInt32 (context, sec->special);
+	SHA1_UpdateInt32 (context, sec->specialdata != NULL);
+    }
+}
+
+static void D_HashPlayers (sha1_context_t* context)
+{
+    player_t*	player;
+    int		i, j;
+
+    for (i = 0; i < MAXPLAYERS; i++)
+    {
+	if (!playeringame[i])
+	    continue;
+
+	player = &players[i];
+
+	SHA1_UpdateInt32 (context, player->playerstate);
+	SHA1_UpdateInt32 (context, player->viewz);
+	SHA1_UpdateInt32 (context, player->viewheight);
+	SHA1_UpdateInt32 (context, player->deltaviewheight);
+	SHA1_UpdateInt32 (context, player->bob);
+	SHA1_UpdateInt32 (context, player->health);
+	SHA1_UpdateInt32 (context, player->armorpoints);
+	SHA1_UpdateInt32 (context, player->armortype);
+	SHA1_UpdateInt32 (context, player->readyweapon);
+	SHA1_UpdateInt32 (context, player->pendingweapon);
+	SHA1_UpdateInt32 (context, player->killcount);
+	SHA1_UpdateInt32 (context, player->itemcount);
+	SHA1_UpdateInt32 (context, player->secretcount);
+	SHA1_UpdateInt32 (context, player->damagecount);
+	SHA1_UpdateInt32 (context, player->bonuscount);
+	SHA1_UpdateInt32 (context, player->extralight);
+
+	for (j = 0; j < NUMPOWERS; j++)
+	    SHA1_UpdateInt32 (context, player->powers[j]);
+	for (j = 0; j < NUMCARDS; j++)
+	    SHA1_UpdateInt32 (context, player->cards[j]);
+	for (j = 0; j < NUMWEAPONS; j++)
+	    SHA1_UpdateInt32 (context, player->weaponowned[j]);
+	for (j = 0; j < NUMAMMO; j++)
+	    SHA1_UpdateInt32 (context, player->ammo[j]);
+
+	for (j = 0; j < NUMPSPRITES; j++)
+	{
+	    SHA1_UpdateInt32 (context, player->psprites[j].state
+				       ? player->psprites[j].state - states
+				       : -1);
+	    SHA1_UpdateInt32 (context, player->psprites[j].tics);
+	    SHA1_UpdateInt32 (context, player->psprites[j].sx);
+	    SHA1_UpdateInt32 (context, player->psprites[j].sy);
+	}
+    }
+}
+
+// Row by row, so that -colmajor runs give the same digests.
+static void D_HashVideo (sha1_context_t* context)
+{
+    static byte	row[MAXWIDTH];
+    int		y;
+
+    if (!colmajor)
+    {
+	SHA1_Update (context, I_VideoBuffer, SCREENWIDTH * SCREENHEIGHT);
+	return;
+    }
+
+    for (y = 0; y < SCREENHEIGHT; y++)
+    {
+	I_ReadScreenRow (I_VideoBuffer, y, row);
+	SHA1_Update (context, row, SCREENWIDTH);
+    }
+}
+
+static void (*goldenhash[NUMGOLDEN]) (sha1_context_t* context) =
+{
+    D_HashMobjs,
+    D_HashSectors,
+    D_HashPlayers,
+    D_HashVideo,
+};
+
+//
+// D_GoldenCheck
+// Hashes subsystems first to last, prints their digests and
+//  compares them with the reference.
+//
+static void D_GoldenCheck (int tic, goldensub_t first, goldensub_t last)
+{
+    sha1_context_t	context;
+    sha1_digest_t	digests[NUMGOLDEN];
+    goldentic_t*	ref;
+    char		hex[sizeof(sha1_digest_t) * 2 + 1];
+    char		expected[sizeof(sha1_digest_t) * 2 + 1];
+    char		line[256];
+    int			len;
+    int			i;
+
+    len = M_snprintf (line, sizeof(line), "golden: tic=%d", tic);
+
+    for (i = first; i <= last; i++)
+    {
+	SHA1_Init (&context);
+	goldenhash[i] (&context);
+	SHA1_Final (digests[i], &context);
+
+	D_DigestToHex (hex, digests[i]);
+	len += M_snprintf (line + len, sizeof(line) - len, " %s=%s",
+			   goldennames[i], hex);
+    }
+
+    // Written synchronously: the console ring could drop lines.
+    fprintf (stderr, "%s\n", line);
+
+    if (reference == NULL || tic >= numreference)
+	return;
+
+    ref = &reference[tic];
+
+    for (i = first; i <= last; i++)
+    {
+	if (!(ref->present & (1 << i)))
+	    continue;
+
+	checked[i]++;
+
+	if (memcmp (ref->digests[i], digests[i], sizeof(sha1_digest_t)))
+	{
+	    D_DigestToHex (hex, digests[i]);
+	    D_DigestToHex (expected, ref->digests[i]);
+	    fprintf (stderr, "golden: first divergence at tic %d in %s: "
+		     "expected %s, got %s\n",
+		     tic, goldennames[i], expected, hex);
+
+	    I_Error ("golden: tic %d differs from %s in %s",
+		     tic, goldenfile, goldennames[i]);
+	}
+    }
+}
+
+void D_GoldenTic (void)
+{
+    if (golden)
+	D_GoldenCheck (gametic, golden_mobjs, golden_players);
+}
+
+void D_GoldenFrame (void)
+{
+    // Only the first frame after a tic: the number of frames
+    //  drawn between tics depends on the speed of the machine.
+    if (!golden || gamestate != GS_LEVEL || gametic == lastframetic)
+	return;
+
+    lastframetic = gametic;
+    D_GoldenCheck (gametic, golden_video, golden_video);
+}
+
+static void D_GoldenSummary (void)
+{
+    if (reference == NULL)
+	return;
+
+    printf ("golden: %d tics and %d frames match %s\n",
+	    checked[golden_mobjs], checked[golden_video], goldenfile);
+}
+
+void D_GoldenInit (void)
+{
+    int		p;
+
+    //!
+    // @category demo
+    //
+    // Print digests of the mobjs, sectors and players after every
+    // tic, and of the screen after every frame (not with -pipeline,
+    // where the view lags the tic by one).
+    //
+
+    golden = M_CheckParm ("-golden") > 0;
+
+    //!
+    // @arg <file>
+    // @category demo
+    //
+    // Compare the digests with the log of a previous -golden run:
+    // the game stops with an error at the first tic that differs.
+    // Screens are compared at the tics both runs drew a frame for.
+    //
+
+    p = M_CheckParmWithArgs ("-goldenfile", 1);
+
+    if (p)
+    {
+	golden = true;
+	goldenfile = myargv[p + 1];
+	D_LoadGoldenFile (goldenfile);
+	I_AtExit (D_GoldenSummary, false);
+    }
+}
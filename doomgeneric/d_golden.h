@@ -0,0 +1,33 @@
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	Golden digests of the world state and of the screen, to check
+//	 that demo playback is unchanged by an optimization.
+//
+
+
+#ifndef __D_GOLDEN__
+#define __D_GOLDEN__
+
+#include "doomtype.h"
+
+
+// Reads -golden and -goldenfile.
+void D_GoldenInit (void);
+
+// After each tic of the play simulation (P_Ticker).
+void D_GoldenTic (void);
+
+// After each frame is drawn (D_Display).
+void D_GoldenFrame (void);
+
+#endif
@@ -0,0 +1,231 @@
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	Frame time governor.
+//	The time a frame keeps the hart busy (not sleeping) is averaged
+//	 over a window of frames. Above the budget, the view gets one
+//	 step cheaper: low detail first, then a smaller view window.
+//	 Well under the budget for several windows, it gets one step
+//	 back towards the detail and size of the menu.
+//	The detail and size set from the menu are left alone: they
+//	 are the best quality the governor goes back to.
+//
+
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "doomstat.h"
+#include "d_govern.h"
+#include "d_loop.h"
+#include "i_timer.h"
+#include "m_argv.h"
+#include "m_menu.h"
+#include "r_main.h"
+
+
+// Frames averaged for each decision.
+#define GOVERNOR_WINDOW		35
+
+// Quality goes back up below this share of the budget (percent),
+//  held for this number of windows.
+#define GOVERNOR_RAISE_SHARE	70
+#define GOVERNOR_RAISE_WINDOWS	3
+
+// Smallest view window (screenblocks) the governor goes down to.
+#define GOVERNOR_MINBLOCKS	6
+
+int	frame_governor = 0;
+int	frame_budget = 1000000 / TICRATE;
+
+static boolean	governing;
+
+// 0: detail and size of the menu, each level is one step cheaper.
+static int	level;
+static int	menublocks;
+static int	menudetail;
+
+static uint64_t	lastframetime;
+static uint64_t	lastsleeptime;
+
+static uint64_t	windowbusy;
+static int	windowframes;
+static int	fastwindows;
+
+// The next window has frames that are not representative
+//  (resize, level load): it is discarded.
+static boolean	settle;
+
+
+//
+// D_GovernorMaxLevel
+// Low detail, then one screen size less per level.
+//
+static int D_GovernorMaxLevel (void)
+{
+    int		levels;
+
+    levels = menudetail ? 0 : 1;
+
+    if (menublocks > GOVERNOR_MINBLOCKS)
+	levels += menublocks - GOVERNOR_MINBLOCKS;
+
+    return levels;
+}
+
+static void D_GovernorSetLevel (int newlevel, int busy)
+{
+    int		blocks;
+    int		detail;
+    int		steps;
+
+    level = newlevel;
+    steps = level;
+    blocks = menublocks;
+    detail = menudetail;
+
+    if (steps > 0 && !detail)
+    {
+	detail = 1;
+	steps--;
+    }
+
+    blocks -= steps;
+
+    R_SetViewSize (blocks, detail);
+    settle = true;
+    fastwindows = 0;
+
+    printf ("D_Governor: %d us per frame for a %d us budget, "
+	    "%s detail, screen size %d\n",
+	    busy, frame_budget, detail ? "low" : "high", blocks);
+}
+
+void D_GovernorInit (void)
+{
+    int		p;
+
+    //!
+    // @category video
+    //
+    // Lower the detail and the view size when frames take longer
+    // than the frame budget, and restore them when there is time
+    // to spare (frame_governor in the configuration file).
+    //
+
+    if (M_CheckParm ("-governor"))
+	frame_governor = 1;
+
+    //!
+    // @category video
+    //
+    // Disable the frame time governor.
+    //
+
+    if (M_CheckParm ("-nogovernor"))
+	frame_governor = 0;
+
+    //!
+    // @arg <us>
+    // @category video
+    //
+    // Frame time budget of the governor, in microseconds
+    // (frame_budget in the configuration file, default one tic).
+    //
+
+    p = M_CheckParmWithArgs ("-framebudget", 1);
+
+    if (p > 0)
+	frame_budget = atoi (myargv[p + 1]);
+
+    governing = frame_governor && frame_budget > 0;
+
+    if (!governing)
+	return;
+
+    menublocks = screenblocks;
+    menudetail = detailLevel;
+    settle = true;
+
+    printf ("D_GovernorInit: %d us frame budget\n", frame_budget);
+}
+
+void D_GovernorFrame (void)
+{
+    uint64_t	now;
+    uint64_t	slept;
+    uint64_t	busy;
+    int		average;
+
+    now = I_GetTimeUS ();
+    slept = I_GetSleepTimeUS ();
+    busy = (now - lastframetime) - (slept - lastsleeptime);
+    lastframetime = now;
+    lastsleeptime = slept;
+
+    if (!governing)
+	return;
+
+    // Changed from the menu, which also set the view size.
+    if (screenblocks != menublocks || detailLevel != menudetail)
+    {
+	menublocks = screenblocks;
+	menudetail = detailLevel;
+	level = 0;
+	fastwindows = 0;
+	settle = true;
+    }
+
+    // Only time the game being played: timedemos measure the
+    //  renderer as configured.
+    if (gamestate != GS_LEVEL || menuactive || paused
+     || automapactive || singletics)
+    {
+	windowbusy = 0;
+	windowframes = 0;
+	settle = true;
+	return;
+    }
+
+    windowbusy += busy;
+    windowframes++;
+
+    if (windowframes < GOVERNOR_WINDOW)
+	return;
+
+    average = windowbusy / windowframes;
+    windowbusy = 0;
+    windowframes = 0;
+
+    if (settle)
+    {
+	settle = false;
+	return;
+    }
+
+    if (average > frame_budget)
+    {
+	fastwindows = 0;
+
+	if (level < D_GovernorMaxLevel ())
+	    D_GovernorSetLevel (level + 1, average);
+    }
+    else if (average < frame_budget / 100 * GOVERNOR_RAISE_SHARE && level > 0)
+    {
+	if (++fastwindows >= GOVERNOR_RAISE_WINDOWS)
+	    D_GovernorSetLevel (level - 1, average);
+    }
+    else
+    {
+	fastwindows = 0;
+    }
+}
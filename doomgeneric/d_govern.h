@@ -0,0 +1,34 @@
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	Frame time governor: lowers the detail and the view size
+//	 when frames take longer than the budget.
+//
+
+
+#ifndef __D_GOVERN__
+#define __D_GOVERN__
+
+#include "doomtype.h"
+
+
+// Configuration variables (frame_governor, frame_budget).
+extern int frame_governor;
+extern int frame_budget;
+
+// Reads -governor, -nogovernor and -framebudget.
+void D_GovernorInit (void);
+
+// At the end of every frame of the game loop.
+void D_GovernorFrame (void);
+
+#endif
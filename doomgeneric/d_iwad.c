@@ -700,6 +700,10 @@ char *D_TryFindWADByName(char *filename)
 // should be executed (notably loading PWADs).
 //
 
+// Default IWAD, as given with -fw_cfg name=opt/doom/iwad,file=...
+
+#define HOST_IWAD "opt/doom/iwad"
+
 char *D_FindIWAD(int mask, GameMission_t *mission)
 {
     char *result;
@@ -732,6 +736,14 @@ char *D_FindIWAD(int mask, GameMission_t *mission)
         
         *mission = IdentifyIWADByName(result, mask);
     }
+    else if (M_FileExists(HOST_IWAD))
+    {
+        // IWAD supplied by the host through fw_cfg.  Its name tells
+        // nothing: the mission is identified from the lumps.
+
+        result = HOST_IWAD;
+        *mission = none;
+    }
     else
     {
         // Search through the list and look for an IWAD
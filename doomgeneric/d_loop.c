@@ -76,6 +76,11 @@ int gametic;
 
 boolean singletics = false;
 
+// When set to true, TryRunTics() returns when no tic is due instead
+// of waiting for one, so that frames are drawn between tics (-uncapped).
+
+boolean uncapped = false;
+
 // Index of the local player.
 
 static int localplayer;
@@ -118,19 +123,22 @@ static int player_class;
 
 static int GetAdjustedTime(void)
 {
-    int time_ms;
+    int64_t time_us;
 
-    time_ms = I_GetTimeMS();
+    // Microseconds, so that a tic starts exactly when I_GetTime
+    // says it does: the game loop sleeps until that instant.
+
+    time_us = I_GetTimeUS();
 
     if (new_sync)
     {
 	// Use the adjustments from net_client.c only if we are
 	// using the new sync mode.
 
-        time_ms += (offsetms / FRACUNIT);
+        time_us += (int64_t) (offsetms / FRACUNIT) * 1000;
     }
 
-    return (time_ms * TICRATE) / 1000;
+    return (time_us * TICRATE) / 1000000;
 }
 
 static boolean BuildNewTic(void)
@@ -773,6 +781,14 @@ void TryRunTics (void)
 	if (lowtic < gametic/ticdup)
 	    I_Error ("TryRunTics: lowtic < gametic");
 
+        // Woken up by the tic: run it rather than update the screen
+        // once more without it.
+
+        if (PlayersInGame() && lowtic >= gametic/ticdup + counts)
+        {
+            break;
+        }
+
         // Don't stay in this loop forever.  The menu is still running,
         // so return to update the screen
 
@@ -781,7 +797,15 @@ void TryRunTics (void)
 	    return;
 	}
 
-        I_Sleep(1);
+        if (uncapped)
+        {
+            return;
+        }
+
+        // Nothing can happen before the next tic but input: sleep
+        // until it starts instead of polling every millisecond.
+
+        I_SleepUntilUS(I_GetTicTimeUS((entertic + 1) * ticdup));
     }
 
     // run the count * ticdup dics
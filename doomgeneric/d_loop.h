@@ -75,6 +75,7 @@ void D_StartNetGame(net_gamesettings_t *settings,
                     netgame_startup_callback_t callback);
 
 extern boolean singletics;
+extern boolean uncapped;
 extern int gametic, ticdup;
 
 #endif
@@ -50,6 +50,7 @@
 #include "m_controls.h"
 #include "m_misc.h"
 #include "m_menu.h"
+#include "m_perf.h"
 #include "p_saveg.h"
 
 #include "i_endoom.h"
@@ -69,11 +70,19 @@
 #include "net_query.h"
 
 #include "p_setup.h"
+#include "p_tick.h"
 #include "r_local.h"
 #include "statdump.h"
 
+#include "d_golden.h"
+#include "d_govern.h"
 #include "d_main.h"
 
+#ifdef RENDER_SMP
+#include "rtc.h"
+#include "smp.h"
+#endif
+
 //
 // D-DoomLoop()
 // Not a globally visible function,
@@ -181,11 +190,20 @@ void D_Display (void)
     boolean			done;
     boolean			wipe;
     boolean			redrawsbar;
+    boolean			viewready;
+    perfstamp_t			perfstart;
 
     if (nodrawers)
     	return;                    // for comparative timing / profiling
 		
     redrawsbar = false;
+    viewready = false;
+
+#ifdef RENDER_SMP
+    // The view of the last tic may still be rendering in the
+    //  background: wait before drawing, render again if resized.
+    viewready = R_FinishPlayerView () && !setsizeneeded;
+#endif
     
     // change the view size if needed
     if (setsizeneeded)
@@ -215,12 +233,14 @@ void D_Display (void)
 			break;
 		if (automapactive)
 			AM_Drawer ();
-		if (wipe || (viewheight != 200 && fullscreen) )
+		if (wipe || (viewheight != SCREENHEIGHT && fullscreen) )
 			redrawsbar = true;
 		if (inhelpscreensstate && !inhelpscreens)
 			redrawsbar = true;              // just put away the help screen
-		ST_Drawer (viewheight == 200, redrawsbar );
-		fullscreen = viewheight == 200;
+		M_PerfStart (&perfstart);
+		ST_Drawer (viewheight == SCREENHEIGHT, redrawsbar );
+		M_PerfStop (perf_statusbar, &perfstart);
+		fullscreen = viewheight == SCREENHEIGHT;
 		break;
 
       case GS_INTERMISSION:
@@ -240,11 +260,15 @@ void D_Display (void)
     I_UpdateNoBlit ();
     
     // draw the view directly
-    if (gamestate == GS_LEVEL && !automapactive && gametic)
+    if (gamestate == GS_LEVEL && !automapactive && gametic && !viewready)
     	R_RenderPlayerView (&players[displayplayer]);
 
     if (gamestate == GS_LEVEL && gametic)
+    {
+	M_PerfStart (&perfstart);
     	HU_Drawer ();
+	M_PerfStop (perf_hud, &perfstart);
+    }
     
     // clean up border stuff
     if (gamestate != oldgamestate && gamestate != GS_LEVEL)
@@ -258,7 +282,7 @@ void D_Display (void)
     }
 
     // see if the border needs to be updated to the screen
-    if (gamestate == GS_LEVEL && !automapactive && scaledviewwidth != 320)
+    if (gamestate == GS_LEVEL && !automapactive && scaledviewwidth != SCREENWIDTH)
     {
 		if (menuactive || menuactivestate || !viewactivestate)
 			borderdrawcount = 3;
@@ -287,8 +311,9 @@ void D_Display (void)
 		if (automapactive)
 			y = 4;
 		else
-			y = viewwindowy+4;
-		V_DrawPatchDirect(viewwindowx + (scaledviewwidth - 68) / 2, y,
+			y = (viewwindowy >> hires) + 4;
+		V_DrawPatchDirect((viewwindowx >> hires)
+				  + ((scaledviewwidth >> hires) - 68) / 2, y,
 							  W_CacheLumpName (DEH_String("M_PAUSE"), PU_CACHE));
     }
 
@@ -316,7 +341,8 @@ void D_Display (void)
 	{
 	    nowtime = I_GetTime ();
 	    tics = nowtime - wipestart;
-            I_Sleep(1);
+	    if (tics <= 0)
+		I_SleepUntilUS (I_GetTicTimeUS (wipestart + 1));
 	} while (tics <= 0);
         
 	wipestart = nowtime;
@@ -368,6 +394,8 @@ void D_BindVariables(void)
     M_BindVariable("vanilla_savegame_limit", &vanilla_savegame_limit);
     M_BindVariable("vanilla_demo_limit",     &vanilla_demo_limit);
     M_BindVariable("show_endoom",            &show_endoom);
+    M_BindVariable("frame_governor",         &frame_governor);
+    M_BindVariable("frame_budget",           &frame_budget);
 
     // Multiplayer chat macros
 
@@ -403,20 +431,261 @@ boolean D_GrabMouseCallback(void)
     return (gamestate == GS_LEVEL) && !demoplayback && !advancedemo;
 }
 
+#ifdef RENDER_SMP
+
+//
+// Pipelined display
+// Hart 0 runs the tics and composes the screen while other harts
+//  render the view of the last tic (R_StartPlayerView) and present
+//  the last frame (I_FinishUpdate).
+//
+
+static boolean		pipeline;
+static int		pipelineframes;
+static uint64_t		pipelinestart;
+static uint64_t		pipelinereport;
+static uint64_t		simulatetime;
+static uint64_t		composetime;
+
+// mtime runs at 10 MHz
+#define PIPELINE_REPORT_TICKS	(10 * 10000000ULL)
+
+static void D_PrintPipelineStage (char *name, uint64_t busy, uint64_t wall)
+{
+    printf ("D_Pipeline: %s %d%% busy, %d us/frame\n", name,
+            (int) (busy * 100 / wall), (int) (busy / 10 / pipelineframes));
+}
+
+//
+// D_PrintPipelineStats
+// Occupancy of each stage since the start: the busiest one
+//  limits the frame rate. Simulate includes waiting for tics,
+//  compose includes the stalls waiting for render and present.
+//
+static void D_PrintPipelineStats (void)
+{
+    uint64_t	wall;
+    uint64_t	renderbusy, renderstall;
+    uint64_t	presentbusy, presentstall;
+
+    wall = kmtime () - pipelinestart;
+
+    if (pipelineframes == 0 || wall == 0)
+        return;
+
+    R_ViewStageTimes (&renderbusy, &renderstall);
+    I_PresentStageTimes (&presentbusy, &presentstall);
+
+    printf ("D_Pipeline: %d frames in %d ms\n",
+            pipelineframes, (int) (wall / 10000));
+    D_PrintPipelineStage ("simulate", simulatetime, wall);
+    D_PrintPipelineStage ("compose", composetime, wall);
+    D_PrintPipelineStage ("render", renderbusy, wall);
+    D_PrintPipelineStage ("present", presentbusy, wall);
+    D_PrintPipelineStage ("stall render", renderstall, wall);
+    D_PrintPipelineStage ("stall present", presentstall, wall);
+}
+
+static void D_InitPipeline (void)
+{
+    //!
+    // @category video
+    //
+    // Pipeline the display across harts: while the next tics run,
+    // the view of the last one is rendered and the last frame is
+    // presented by other harts. The view lags the status bar and
+    // messages by one tic. Stage occupancy is printed periodically.
+    //
+
+    if (!M_CheckParm ("-pipeline"))
+        return;
+
+    if (smp_num_harts () < 2)
+    {
+        printf ("D_InitPipeline: needs 2 harts or more, disabled\n");
+        return;
+    }
+
+    pipeline = true;
+    I_StartPresentStage ();
+    I_AtExit (D_PrintPipelineStats, true);
+
+    pipelinestart = pipelinereport = kmtime ();
+    printf ("D_InitPipeline: simulate, render and present pipelined\n");
+}
+
+static void D_PipelineTick (void)
+{
+    uint64_t	start, simulated, now;
+    perfstamp_t	perfframe, perftic;
+
+    M_PerfStart (&perfframe);
+    I_StartFrame ();
+
+    start = kmtime ();
+    M_PerfStart (&perftic);
+    TryRunTics ();
+    M_PerfStop (perf_tic, &perftic);
+    S_UpdateSounds (players[consoleplayer].mo);
+    simulated = kmtime ();
+
+    if (screenvisible)
+    {
+        // No golden video digest: the view drawn is that of an
+        //  earlier tic than the status bar around it.
+        D_Display ();
+
+        // Render the world as it is now while the next tics run.
+        if (gamestate == GS_LEVEL && !automapactive && gametic && !nodrawers)
+            R_StartPlayerView (&players[displayplayer]);
+    }
+
+    now = kmtime ();
+    simulatetime += simulated - start;
+    composetime += now - simulated;
+    pipelineframes++;
+    M_PerfStop (perf_frame, &perfframe);
+    M_PerfFrame ();
+    D_GovernorFrame ();
+
+    if (now - pipelinereport >= PIPELINE_REPORT_TICKS)
+    {
+        D_PrintPipelineStats ();
+        pipelinereport = now;
+    }
+}
+
+#endif
+
+
+//
+// Uncapped framerate
+// Frames are drawn between tics, from positions interpolated
+//  between the last two: the play simulation is unchanged.
+//
+
+// frames per second with -maxfps, 0 for no limit
+static int		maxfps;
+static uint64_t		nextframetime;
+
+static void D_InitUncapped (void)
+{
+    int		p;
+
+    //!
+    // @category video
+    //
+    // Draw frames as fast as possible rather than once per tic,
+    // interpolating the view between tics. Games and demos play
+    // the same. Not with -pipeline; -timedemo draws every tic.
+    //
+
+    if (!M_CheckParm ("-uncapped"))
+        return;
+
+#ifdef RENDER_SMP
+    if (pipeline)
+    {
+        printf ("D_InitUncapped: not with -pipeline, disabled\n");
+        return;
+    }
+#endif
+
+    //!
+    // @arg <n>
+    // @category video
+    //
+    // With -uncapped, draw at most n frames per second.
+    //
+
+    p = M_CheckParmWithArgs ("-maxfps", 1);
+
+    if (p > 0)
+        maxfps = atoi (myargv[p + 1]);
+
+    uncapped = true;
+    printf ("D_InitUncapped: frames drawn between tics, at most %d per second "
+            "(0: no limit)\n", maxfps);
+}
+
+//
+// D_CapFrameRate
+// Waits for the start of the next frame with -maxfps.
+//
+static void D_CapFrameRate (void)
+{
+    uint64_t	now;
+
+    if (!uncapped || maxfps <= 0)
+        return;
+
+    now = I_GetTimeUS ();
+
+    if (now < nextframetime)
+        I_SleepUntilUS (nextframetime);
+    else
+        nextframetime = now;            // late: don't catch up
+
+    nextframetime += 1000000 / maxfps;
+}
+
+//
+// D_InterpolateView
+// How far the clock is into the current tic: the view is drawn
+//  that far from the positions before the last tic, if it ran
+//  the play simulation (not paused or in the menu).
+//
+static void D_InterpolateView (void)
+{
+    uint64_t	now;
+
+    interpolateview = uncapped && !singletics
+                   && gamestate == GS_LEVEL
+                   && oldpositionstic == gametic - 1;
+
+    if (!interpolateview)
+        return;
+
+    now = I_GetTimeUS ();
+    fractionaltic = ((now * TICRATE) % 1000000) * FRACUNIT / 1000000;
+}
+
 void doomgeneric_Tick()
 {
+    perfstamp_t	perfframe, perftic;
+
+#ifdef RENDER_SMP
+    if (pipeline)
+    {
+        D_PipelineTick ();
+        return;
+    }
+#endif
+
+    M_PerfStart (&perfframe);
+
+    D_CapFrameRate ();
+
     // frame syncronous IO operations
     I_StartFrame ();
 
+    M_PerfStart (&perftic);
     TryRunTics (); // will run at least one tic
+    M_PerfStop (perf_tic, &perftic);
 
     S_UpdateSounds (players[consoleplayer].mo);// move positional sounds
 
     // Update display, next frame, with current state.
     if (screenvisible)
     {
+        D_InterpolateView ();
         D_Display ();
+        D_GoldenFrame ();
     }
+
+    M_PerfStop (perf_frame, &perfframe);
+    M_PerfFrame ();
+    D_GovernorFrame ();
 }
 
 //
@@ -877,6 +1146,41 @@ static boolean D_AddFile(char *filename)
     return handle != NULL;
 }
 
+//
+// D_AddDemo
+// Loads demo.lmp if present, and gives the name of the lump to play.
+//
+static void D_AddDemo(char *name, char *lumpname)
+{
+    char file[256];
+
+    // With Vanilla you have to specify the file without extension,
+    // but make that optional.
+    if (M_StringEndsWith(name, ".lmp"))
+    {
+        M_StringCopy(file, name, sizeof(file));
+    }
+    else
+    {
+        DEH_snprintf(file, sizeof(file), "%s.lmp", name);
+    }
+
+    if (D_AddFile(file))
+    {
+        M_StringCopy(lumpname, lumpinfo[numlumps - 1].name, 9);
+    }
+    else
+    {
+        // If file failed to load, still continue trying to play
+        // the demo in the same way as Vanilla Doom.  This makes
+        // tricks like "-playdemo demo1" possible.
+
+        M_StringCopy(lumpname, name, 9);
+    }
+
+    printf("Playing demo %s.\n", file);
+}
+
 // Copyright message banners
 // Some dehacked mods replace these.  These are only displayed if they are 
 // replaced by dehacked.
@@ -1085,7 +1389,8 @@ static void D_Endoom(void)
 
     I_Endoom(endoom);
 
-	exit(0);
+    // I_Quit exits once the handlers registered before this one,
+    // such as the platform statistics, have run.
 }
 
 #if ORIGCODE
@@ -1167,8 +1472,12 @@ void D_DoomMain (void)
 {
     printf("D_DoomMain\n");
     int p;
+    int i;
     char file[256];
-    char demolumpname[9];
+    // the demo lump names must outlive D_DoomMain (see D_DoomLoop)
+    static char demolumpname[9];
+    char **timedemos;
+    int numtimedemos;
 #if ORIGCODE
     int numiwadlumps;
 #endif
@@ -1473,45 +1782,44 @@ void D_DoomMain (void)
     if (!p)
     {
         //!
-        // @arg <demo>
+        // @arg <demo> [<demo>...]
         // @category demo
         // @vanilla
         //
         // Play back the demo named demo.lmp, determining the framerate
-        // of the screen.
+        // of the screen. Several demos are timed back to back, then
+        // the results are printed and the game quits.
         //
 	p = M_CheckParmWithArgs("-timedemo", 1);
 
     }
 
+    timedemos = NULL;
+    numtimedemos = 0;
+
     if (p)
     {
-        // With Vanilla you have to specify the file without extension,
-        // but make that optional.
-        if (M_StringEndsWith(myargv[p + 1], ".lmp"))
-        {
-            M_StringCopy(file, myargv[p + 1], sizeof(file));
-        }
-        else
-        {
-            DEH_snprintf(file, sizeof(file), "%s.lmp", myargv[p+1]);
-        }
+        D_AddDemo(myargv[p + 1], demolumpname);
 
-        if (D_AddFile(file))
+        if (!strcasecmp(myargv[p], "-timedemo"))
         {
-            M_StringCopy(demolumpname, lumpinfo[numlumps - 1].name,
-                         sizeof(demolumpname));
-        }
-        else
-        {
-            // If file failed to load, still continue trying to play
-            // the demo in the same way as Vanilla Doom.  This makes
-            // tricks like "-playdemo demo1" possible.
+            numtimedemos = 1;
 
-            M_StringCopy(demolumpname, myargv[p + 1], sizeof(demolumpname));
-        }
+            while (p + numtimedemos + 1 < myargc
+                && myargv[p + numtimedemos + 1][0] != '-')
+            {
+                ++numtimedemos;
+            }
+
+            timedemos = malloc(numtimedemos * sizeof(*timedemos));
+            timedemos[0] = demolumpname;
 
-        printf("Playing demo %s.\n", file);
+            for (i = 1; i < numtimedemos; ++i)
+            {
+                timedemos[i] = malloc(sizeof(demolumpname));
+                D_AddDemo(myargv[p + 1 + i], timedemos[i]);
+            }
+        }
     }
 
     I_AtExit((atexit_func_t) G_CheckDemoStatus, true);
@@ -1767,6 +2075,15 @@ void D_DoomMain (void)
     DEH_printf("R_Init: Init DOOM refresh daemon - ");
     R_Init ();
 
+#ifdef RENDER_SMP
+    D_InitPipeline ();
+#endif
+    D_InitUncapped ();
+    D_GovernorInit ();
+
+    D_GoldenInit ();
+    M_PerfInit ();
+
     DEH_printf("\nP_Init: Init Playloop state.\n");
     P_Init ();
 
@@ -1822,10 +2139,9 @@ void D_DoomMain (void)
         return;
     }
 
-    p = M_CheckParmWithArgs("-timedemo", 1);
-    if (p)
+    if (numtimedemos > 0)
     {
-		G_TimeDemo (demolumpname);
+		G_TimeDemoList (timedemos, numtimedemos);
 		D_DoomLoop ();
         return;
     }
@@ -39,6 +39,10 @@ void DG_Init();
 void DG_DrawFrame();
 void DG_SleepMs(uint32_t ms);
 uint32_t DG_GetTicksMs();
+// Microsecond clock and sleep until it reaches a deadline, or until an
+// input event arrives: the game loop waits for the exact start of a tic.
+uint64_t DG_GetTicksUs();
+void DG_SleepUntilUs(uint64_t deadline);
 int DG_GetKey(int* pressed, unsigned char* key);
 void DG_SetWindowTitle(const char * title);
 
@@ -6,11 +6,42 @@
 #include "qemu_dma.h"
 #include "virtio_keyboard.h"
 #include "virt_clint.h"
+#include "plic.h"
+#include "prof.h"
+#include "membench.h"
+#include "smp.h"
+#include "m_argv.h"
+#include "i_system.h"
 
 #include <stdio.h>
+#include <malloc.h>
 
 fb_info fb; // global video framebuffer
 
+// AT scan code of Scroll Lock (unused by Doom): prints the profile
+#define KEY_CODE_PROF_DUMP 0x46
+
+// profiler defaults (-profile)
+#define DEFAULT_PROF_RATE 1000
+#define DEFAULT_PROF_SAMPLES (64 * 1024)
+
+static boolean profiling = false;
+
+// number of ramfb scanout buffers (1 = draw into displayed buffer)
+#define DEFAULT_FB_BUFFERS 3
+
+// skip waiting for display refresh before reusing a buffer (double buffering only)
+static boolean fb_flip_nowait = false;
+
+static void DG_PrintStats(void)
+{
+	ramfb_print_stats(&fb);
+	virtio_keyboard_print_stats();
+	clint_print_stats();
+	kconsole_print_stats();
+	malloc_stats();
+}
+
 void DG_Init()
 {
 	printf("DG_Init\n");
@@ -21,25 +52,53 @@ void DG_Init()
 		printf("DG_Init: guest fw_cfg dma-interface enabled \n");
 	} else {
 		printf("DG_Init: guest fw_cfg dma-interface NOT enabled - abort \n");
-		poweroff();
+		poweroff_exit(1);
 		return;
 	}
   
-  uint32_t fb_width = 640;
-  uint32_t fb_height = 400;
+  uint32_t fb_width = DOOMGENERIC_RESX;
+  uint32_t fb_height = DOOMGENERIC_RESY;
   uint32_t fb_bpp = 4;
   uint32_t fb_stride = fb_bpp * fb_width;
 
-  fb.fb_addr = (uint64_t) malloc(fb_stride * fb_height);
+  // DG_ScreenBuffer is used as first scanout buffer: I_FinishUpdate() expands
+  // the palette straight into ramfb memory and no copy is needed on present
+  fb.fb_addr = (uint64_t) DG_ScreenBuffer;
   fb.fb_width = fb_width;
   fb.fb_height = fb_height;
   fb.fb_bpp = fb_bpp;
   fb.fb_stride = fb_stride;
   fb.fb_size = fb_stride * fb_height;
-  
+
+  //!
+  // @arg <n>
+  //
+  // Number of ramfb scanout buffers: 1 (single), 2 (double) or 3 (triple buffering).
+  //
+  int fb_buffers = DEFAULT_FB_BUFFERS;
+  int p = M_CheckParmWithArgs("-fbbuffers", 1);
+  if (p > 0) {
+	fb_buffers = atoi(myargv[p + 1]);
+  }
+
+  //!
+  // With double buffering, don't wait for the display refresh before
+  // drawing into the buffer shown by previous frame (may tear).
+  //
+  fb_flip_nowait = M_CheckParm("-noflipwait") > 0;
+
+  if (ramfb_setup_buffers(&fb, fb_buffers) != 0) {
+	printf("DG_Init: error allocating [%d] ramfb buffers \n", fb_buffers);
+	poweroff_exit(1);
+	return;
+  }
+  // draw into back buffer, first one is on screen
+  DG_ScreenBuffer = (pixel_t *) fb.fb_buffers[fb.fb_back];
+  I_AtExit(DG_PrintStats, true);
+
   if (ramfb_setup(&fb) != 0){
     printf("DG_Init: error setting up ramfb \n");
-	poweroff();
+	poweroff_exit(1);
 	return;
   }
   printf("DG_Init: setup ramfb successfull\n");
@@ -47,28 +106,112 @@ void DG_Init()
   int res =virtio_keyboard_init();
   if (res < 0 ) {
 	printf("DG_Init: error during virtio keyboad init [%d] - abort\n", res);
-	poweroff();
+	poweroff_exit(1);
 	return;
   }
   printf("DG_Init: virtio keyboad init successfully\n");
 
   if (init_interrupts() < 0) {
-	poweroff();
+	poweroff_exit(1);
 	return;
   }
   printf("DG_Init: interrupts setup completed successfully\n");
+
+  //!
+  // @arg <hz>
+  //
+  // Sample the code running on hart 0 <hz> times per second from the timer
+  // interrupt (see prof.c). The histogram of the sampled stacks is printed
+  // when Scroll Lock is pressed and at exit.
+  //
+  p = M_CheckParmWithArgs("-profile", 1);
+  if (p > 0) {
+	int rate = atoi(myargv[p + 1]);
+	int max_samples = DEFAULT_PROF_SAMPLES;
+
+	//!
+	// @arg <n>
+	//
+	// Size of the profiler buffer, in samples (default 65536).
+	//
+	int q = M_CheckParmWithArgs("-profilesamples", 1);
+	if (q > 0) {
+		max_samples = atoi(myargv[q + 1]);
+	}
+	if (rate <= 0) {
+		rate = DEFAULT_PROF_RATE;
+	}
+	if (prof_init(rate, max_samples) == 0) {
+		I_AtExit(prof_dump, true);
+		prof_start();
+		profiling = true;
+	}
+  }
+
+  //!
+  // Poll the keyboard virtqueue on every input read instead of taking
+  // its interrupts through the PLIC.
+  //
+  if (!M_CheckParm("-inputpoll")) {
+	plic_init();
+	if (virtio_keyboard_enable_irq() < 0) {
+		printf("DG_Init: keyboard interrupt setup failed, polling\n");
+	} else {
+		printf("DG_Init: keyboard events are interrupt driven\n");
+	}
+  }
+
+  //!
+  // Keep console output synchronous: every byte is written to the UART
+  // by the caller (default is buffered, drained by the UART interrupt).
+  //
+  if (!M_CheckParm("-syncconsole")) {
+	// without the PLIC the ring is drained when the game loop sleeps
+	kconsole_start(!M_CheckParm("-inputpoll"));
+  }
+
+  if (M_CheckParm("-membench")) {
+	membench();
+	poweroff();
+  }
+
+  smp_init();
+
+  //!
+  // Run job system self-test and multi-hart scaling benchmark, then power off.
+  //
+  if (M_CheckParm("-smpbench")) {
+	smp_selftest();
+	smp_bench();
+	poweroff();
+  }
 }
 
 void DG_DrawFrame()
 {
 	//printf("DG_DrawFrame\n");
-	draw_frame((uint32_t*)DG_ScreenBuffer, &fb);
+	// frame has already been written in ramfb memory (see DG_Init)
+	if (fb.fb_num_buffers < 2)
+		return;
+
+	DG_ScreenBuffer = (pixel_t *) ramfb_flip(&fb);
+
+	// double buffering: don't draw into the new back buffer while still on screen
+	uint64_t busy = ramfb_back_busy_ticks(&fb);
+	if (busy > 0 && !fb_flip_nowait) {
+		// the timer interrupt only targets hart 0: others poll (pipelined present)
+		if (read_mhartid() == 0)
+			sleep_us(busy / 10);
+		else
+			kusleep(busy / 10);
+	}
 }
 
 void DG_SleepMs(uint32_t ms)
 {
 	//printf("DG_SleepMs: ms [%d]\n", ms);
 	//kusleep(ms * 1000);
+	kconsole_idle();
 	sleep_us(ms * 1000);
 }
 
@@ -79,6 +222,17 @@ uint32_t DG_GetTicksMs()
 	return ticks / 10000;
 }
 
+uint64_t DG_GetTicksUs()
+{
+	return kmtime() / 10;
+}
+
+void DG_SleepUntilUs(uint64_t deadline)
+{
+	kconsole_idle();
+	sleep_until(deadline * 10);
+}
+
 
 // convert console extended char into doomkey
 unsigned char convert_to_doomkey(int code) {
@@ -101,6 +255,14 @@ unsigned char convert_to_doomkey(int code) {
 int DG_GetKey(int* pressed, unsigned char* doomKey)
 {
 	struct virtio_input_event key_event = virtio_keyboard_read_event();
+
+	// the profile dump key is not passed to the game: go on with the next event
+	while (profiling && key_event.type != VirtioInputEvNone
+	       && key_event.code == KEY_CODE_PROF_DUMP) {
+		if (key_event.value)
+			prof_dump();
+		key_event = virtio_keyboard_read_event();
+	}
 	if (key_event.type == VirtioInputEvNone)
 		return 0; // no key event detected
 	unsigned char key = convert_to_doomkey(key_event.code);
@@ -115,9 +277,29 @@ void DG_SetWindowTitle(const char * title)
 	printf("DG_SetWindowTitle\n");
 }
 
+// Command line: there is none on bare metal, the host can pass one as a
+// response file with -fw_cfg name=opt/doom/args,file=args.txt (or string=...)
+#define BOOT_ARGS_FILE "opt/doom/args"
+
+static char boot_arg0[] = "doomgeneric";
+static char boot_args_file[] = "@" BOOT_ARGS_FILE;
+static char *boot_argv[] = { boot_arg0, NULL, NULL };
+
 int main(int argc, char **argv)
 {
+	int boot_argc = 1;
+
 	printf("main\n");
+
+	// native build (native.c): the command line of the process
+	if (argc == 0) {
+		fw_cfg_list_files();
+		if (fw_cfg_find(BOOT_ARGS_FILE) != NULL)
+			boot_argv[boot_argc++] = boot_args_file;
+		argc = boot_argc;
+		argv = boot_argv;
+	}
+
     doomgeneric_Create(argc, argv);
 
     while (1)
@@ -238,23 +238,17 @@ void F_TextWrite (void)
     
     // erase the entire screen to a tiled background
     src = W_CacheLumpName ( finaleflat , PU_CACHE);
-    dest = I_VideoBuffer;
 	
+    // With -hires, each pixel of the flat covers two by two.
     for (y=0 ; y<SCREENHEIGHT ; y++)
     {
-	for (x=0 ; x<SCREENWIDTH/64 ; x++)
-	{
-	    memcpy (dest, src+((y&63)<<6), 64);
-	    dest += 64;
-	}
-	if (SCREENWIDTH&63)
-	{
-	    memcpy (dest, src+((y&63)<<6), SCREENWIDTH&63);
-	    dest += (SCREENWIDTH&63);
-	}
+	dest = I_VideoBuffer + SCREENOFS(0, y);
+
+	for (x=0 ; x<SCREENWIDTH ; x++, dest += SCREENXSTEP)
+	    *dest = src[(((y >> hires) & 63) << 6) + ((x >> hires) & 63)];
     }
 
-    V_MarkRect (0, 0, SCREENWIDTH, SCREENHEIGHT);
+    V_MarkRect (0, 0, ORIGWIDTH, ORIGHEIGHT);
     
     // draw some of the text onto the screen
     cx = 10;
@@ -284,7 +278,7 @@ void F_TextWrite (void)
 	}
 		
 	w = SHORT (hu_font[c]->width);
-	if (cx+w > SCREENWIDTH)
+	if (cx+w > ORIGWIDTH)
 	    break;
 	V_DrawPatch(cx, cy, hu_font[c]);
 	cx+=w;
@@ -579,21 +573,33 @@ F_DrawPatchCol
     byte*	dest;
     byte*	desttop;
     int		count;
+    int		xstep;
+    int		ystep;
 	
     column = (column_t *)((byte *)patch + LONG(patch->columnofs[col]));
-    desttop = I_VideoBuffer + x;
+    desttop = I_VideoBuffer + SCREENOFS(x << hires, 0);
+    xstep = SCREENXSTEP;
+    ystep = SCREENYSTEP;
 
     // step through the posts in a column
     while (column->topdelta != 0xff )
     {
 	source = (byte *)column + 3;
-	dest = desttop + column->topdelta*SCREENWIDTH;
+	dest = desttop + (column->topdelta << hires)*ystep;
 	count = column->length;
 		
 	while (count--)
 	{
-	    *dest = *source++;
-	    dest += SCREENWIDTH;
+	    *dest = *source;
+
+	    // -hires: two by two pixels
+	    if (hires)
+	    {
+		dest[xstep] = dest[ystep] = dest[ystep+xstep] = *source;
+		dest += ystep;
+	    }
+	    source++;
+	    dest += ystep;
 	}
 	column = (column_t *)(  (byte *)column + column->length + 4 );
     }
@@ -616,7 +622,7 @@ void F_BunnyScroll (void)
     p1 = W_CacheLumpName (DEH_String("PFUB2"), PU_LEVEL);
     p2 = W_CacheLumpName (DEH_String("PFUB1"), PU_LEVEL);
 
-    V_MarkRect (0, 0, SCREENWIDTH, SCREENHEIGHT);
+    V_MarkRect (0, 0, ORIGWIDTH, ORIGHEIGHT);
 	
     scrolled = (320 - ((signed int) finalecount-230)/2);
     if (scrolled > 320)
@@ -624,7 +630,7 @@ void F_BunnyScroll (void)
     if (scrolled < 0)
 	scrolled = 0;
 		
-    for ( x=0 ; x<SCREENWIDTH ; x++)
+    for ( x=0 ; x<ORIGWIDTH ; x++)
     {
 	if (x+scrolled < 320)
 	    F_DrawPatchCol (x, p1, x+scrolled);
@@ -636,8 +642,8 @@ void F_BunnyScroll (void)
 	return;
     if (finalecount < 1180)
     {
-        V_DrawPatch((SCREENWIDTH - 13 * 8) / 2,
-                    (SCREENHEIGHT - 8 * 8) / 2, 
+        V_DrawPatch((ORIGWIDTH - 13 * 8) / 2,
+                    (ORIGHEIGHT - 8 * 8) / 2, 
                     W_CacheLumpName(DEH_String("END0"), PU_CACHE));
 	laststage = 0;
 	return;
@@ -653,8 +659,8 @@ void F_BunnyScroll (void)
     }
 	
     DEH_snprintf(name, 10, "END%i", stage);
-    V_DrawPatch((SCREENWIDTH - 13 * 8) / 2, 
-                (SCREENHEIGHT - 8 * 8) / 2, 
+    V_DrawPatch((ORIGWIDTH - 13 * 8) / 2, 
+                (ORIGHEIGHT - 8 * 8) / 2, 
                 W_CacheLumpName (name,PU_CACHE));
 }
 
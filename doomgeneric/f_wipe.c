@@ -142,11 +142,18 @@ wipe_initMelt
     
     // makes this wipe faster (in theory)
     // to have stuff in column-major format
-    wipe_shittyColMajorXform((short*)wipe_scr_start, width/2, height);
-    wipe_shittyColMajorXform((short*)wipe_scr_end, width/2, height);
+    // (-colmajor screens already are, by pixel columns)
+    if (!colmajor)
+    {
+	wipe_shittyColMajorXform((short*)wipe_scr_start, width/2, height);
+	wipe_shittyColMajorXform((short*)wipe_scr_end, width/2, height);
+    }
     
     // setup initial column positions
     // (y<0 => not ready to scroll yet)
+    // Columns and rows are those of the 320x200 screen: with
+    //  -hires, each column melts two pixel pairs by two rows.
+    width >>= hires;
     y = (int *) Z_Malloc(width*sizeof(int), PU_STATIC, 0);
     y[0] = -(M_Random()%16);
     for (i=1;i<width;i++)
@@ -160,6 +167,55 @@ wipe_initMelt
     return 0;
 }
 
+//
+// wipe_meltColumn
+// Column i of pixel pairs shows the end screen down to row bottom,
+//  and the start screen moved down to there below it.
+//
+static void
+wipe_meltColumn
+( int	i,
+  int	width,
+  int	height,
+  int	top,
+  int	bottom )
+{
+    int		j;
+    int		idx;
+    short*	s;
+    short*	d;
+
+    if (colmajor)
+    {
+	// both pixel columns of the pair, each contiguous
+	for (j = i*2; j < i*2+2; j++)
+	{
+	    memcpy(wipe_scr + j*height + top,
+		   wipe_scr_end + j*height + top, bottom-top);
+	    memcpy(wipe_scr + j*height + bottom,
+		   wipe_scr_start + j*height, height-bottom);
+	}
+	return;
+    }
+
+    s = &((short *)wipe_scr_end)[i*height+top];
+    d = &((short *)wipe_scr)[top*width+i];
+    idx = 0;
+    for (j=bottom-top;j;j--)
+    {
+	d[idx] = *(s++);
+	idx += width;
+    }
+    s = &((short *)wipe_scr_start)[i*height];
+    d = &((short *)wipe_scr)[bottom*width+i];
+    idx = 0;
+    for (j=height-bottom;j;j--)
+    {
+	d[idx] = *(s++);
+	idx += width;
+    }
+}
+
 int
 wipe_doMelt
 ( int	width,
@@ -167,45 +223,35 @@ wipe_doMelt
   int	ticks )
 {
     int		i;
-    int		j;
+    int		col;
+    int		cols;
+    int		rows;
     int		dy;
-    int		idx;
     
-    short*	s;
-    short*	d;
     boolean	done = true;
 
     width/=2;
 
+    // Melting columns and rows, in the 320x200 screen.
+    cols = width >> hires;
+    rows = height >> hires;
+
     while (ticks--)
     {
-	for (i=0;i<width;i++)
+	for (col=0;col<cols;col++)
 	{
-	    if (y[i]<0)
+	    if (y[col]<0)
 	    {
-		y[i]++; done = false;
+		y[col]++; done = false;
 	    }
-	    else if (y[i] < height)
+	    else if (y[col] < rows)
 	    {
-		dy = (y[i] < 16) ? y[i]+1 : 8;
-		if (y[i]+dy >= height) dy = height - y[i];
-		s = &((short *)wipe_scr_end)[i*height+y[i]];
-		d = &((short *)wipe_scr)[y[i]*width+i];
-		idx = 0;
-		for (j=dy;j;j--)
-		{
-		    d[idx] = *(s++);
-		    idx += width;
-		}
-		y[i] += dy;
-		s = &((short *)wipe_scr_start)[i*height];
-		d = &((short *)wipe_scr)[y[i]*width+i];
-		idx = 0;
-		for (j=height-y[i];j;j--)
-		{
-		    d[idx] = *(s++);
-		    idx += width;
-		}
+		dy = (y[col] < 16) ? y[col]+1 : 8;
+		if (y[col]+dy >= rows) dy = rows - y[col];
+		for (i = col << hires; i < (col+1) << hires; i++)
+		    wipe_meltColumn(i, width, height,
+				    y[col] << hires, (y[col]+dy) << hires);
+		y[col] += dy;
 		done = false;
 	    }
 	}
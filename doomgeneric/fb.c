@@ -1,7 +1,9 @@
 #include "fb.h"
 #include "qemu_dma.h"
+#include "rtc.h"
 
 #include <stdio.h>
+#include <stdlib.h>
 
 /* Framebuffer
 see https://www.kraxel.org/blog/2019/02/ramfb-display-in-qemu/
@@ -16,25 +18,121 @@ void memcpy_(void *dest, void *src, uint64_t n)
        cdest[i] = csrc[i];
 }
 
-int ramfb_setup(fb_info *fb) {
-    uint32_t select = qemu_cfg_find_file();
-
-    if (select == 0) {
-        return 1;
-    }
+// fw_cfg selector of "etc/ramfb" file, looked up once in ramfb_setup()
+static uint32_t ramfb_select = 0;
 
+static void ramfb_register(fb_info *fb, uint64_t addr) {
     struct QemuRAMFBCfg cfg = {
-        .addr   = __builtin_bswap64(fb->fb_addr),
+        .addr   = __builtin_bswap64(addr),
         .fourcc = __builtin_bswap32(DRM_FORMAT_XRGB8888),
         .flags  = __builtin_bswap32(0),
         .width  = __builtin_bswap32(fb->fb_width),
         .height = __builtin_bswap32(fb->fb_height),
         .stride = __builtin_bswap32(fb->fb_stride),
     };
-    qemu_cfg_write_entry(&cfg, select, sizeof(cfg));
+    qemu_cfg_write_entry(&cfg, ramfb_select, sizeof(cfg));
+}
+
+int ramfb_setup(fb_info *fb) {
+    uint32_t select = qemu_cfg_find_file();
+
+    if (select == 0) {
+        return 1;
+    }
+    ramfb_select = select;
+
+    ramfb_register(fb, fb->fb_addr);
     return 0;
 }
 
+/**
+ * @brief Sets up 'num_buffers' scanout buffers for page flipping: 'fb_addr' is used
+ *        as first (displayed) buffer, the others are allocated.
+ *        Must be called before ramfb_setup().
+ *
+ * @return int 0 on success
+ */
+int ramfb_setup_buffers(fb_info *fb, uint32_t num_buffers) {
+    if (num_buffers < 1 || num_buffers > RAMFB_MAX_BUFFERS) {
+        return 1;
+    }
+
+    fb->fb_buffers[0] = fb->fb_addr;
+    for (int i = 1; i < num_buffers; i++) {
+        fb->fb_buffers[i] = (uint64_t) calloc(1, fb->fb_size);
+        if (fb->fb_buffers[i] == 0) {
+            return 1;
+        }
+    }
+    fb->fb_num_buffers = num_buffers;
+    fb->fb_back = num_buffers > 1 ? 1 : 0;
+    return 0;
+}
+
+/**
+ * @brief Displays the back buffer, re-registering ramfb with its address.
+ *        QEMU keeps scanning out the previous buffer until its next display
+ *        refresh, meanwhile the game can draw into the new back buffer.
+ *
+ * @return uint64_t address of the buffer where next frame has to be drawn
+ */
+uint64_t ramfb_flip(fb_info *fb) {
+    fb_flip_stats *stats = &fb->fb_stats;
+    uint64_t t0 = kmtime();
+
+    // QEMU does not tell when it scans a buffer out: compare the time
+    // between flips with its refresh interval instead
+    if (stats->flips > 0) {
+        uint64_t interval = t0 - stats->last_flip;
+        stats->interval_total += interval;
+        if (stats->flips == 1 || interval < stats->interval_min) {
+            stats->interval_min = interval;
+        }
+        if (interval > stats->interval_max) {
+            stats->interval_max = interval;
+        }
+    }
+
+    fb->fb_addr = fb->fb_buffers[fb->fb_back];
+    ramfb_register(fb, fb->fb_addr);
+
+    uint64_t latency = kmtime() - t0;
+    stats->latency_total += latency;
+    if (latency > stats->latency_max) {
+        stats->latency_max = latency;
+    }
+    stats->flips++;
+    stats->last_flip = t0;
+
+    fb->fb_back = (fb->fb_back + 1) % fb->fb_num_buffers;
+    return fb->fb_buffers[fb->fb_back];
+}
+
+/**
+ * @brief With double buffering the new back buffer has been displayed until
+ *        last flip: returns how long (mtime ticks) it may still be on screen.
+ *        With three buffers it was replaced one flip earlier, so no wait is needed.
+ */
+uint64_t ramfb_back_busy_ticks(fb_info *fb) {
+    if (fb->fb_num_buffers != 2) {
+        return 0;
+    }
+    uint64_t elapsed = kmtime() - fb->fb_stats.last_flip;
+    return elapsed < RAMFB_REFRESH_TICKS ? RAMFB_REFRESH_TICKS - elapsed : 0;
+}
+
+void ramfb_print_stats(fb_info *fb) {
+    fb_flip_stats *stats = &fb->fb_stats;
+    uint64_t avg = stats->flips ? stats->latency_total / stats->flips : 0;
+    uint64_t interval = stats->flips > 1 ? stats->interval_total / (stats->flips - 1) : 0;
+    // mtime is 10MHz: 10 ticks per us
+    printf("ramfb: buffers [%d], flips [%d], flip latency avg [%d]us max [%d]us, "
+           "flip interval avg [%d]us min [%d]us max [%d]us (display refresh [%d]us)\n",
+           fb->fb_num_buffers, stats->flips, avg / 10, stats->latency_max / 10,
+           interval / 10, stats->interval_min / 10, stats->interval_max / 10,
+           RAMFB_REFRESH_TICKS / 10);
+}
+
 void write_xrgb256_pixel(fb_info *fb, uint16_t x, uint16_t y, uint8_t pixel[4]){
     memcpy_((void*)fb->fb_addr + ((y * fb->fb_stride) + (x * fb->fb_bpp)), pixel, 4);
 }
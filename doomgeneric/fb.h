@@ -14,18 +14,45 @@
 #define DRM_FORMAT_ARGB8888	    fourcc_code('A', 'R', '2', '4') /* [31:0] A:R:G:B 8:8:8:8 little endian */
 #define DRM_FORMAT_ABGR8888	    fourcc_code('A', 'B', '2', '4') /* [31:0] A:B:G:R 8:8:8:8 little endian */
 
+// max number of scanout buffers (triple buffering)
+#define RAMFB_MAX_BUFFERS   3
+
+// QEMU refreshes the display every 30ms (GUI_REFRESH_INTERVAL_DEFAULT), in mtime ticks
+#define RAMFB_REFRESH_TICKS (30 * 10000)
+
+typedef struct {
+    uint64_t flips;
+    uint64_t interval_total;    // time between consecutive flips (mtime ticks)
+    uint64_t interval_min;
+    uint64_t interval_max;
+    uint64_t latency_total;     // time spent registering buffers with fw_cfg (mtime ticks)
+    uint64_t latency_max;
+    uint64_t last_flip;         // mtime of last flip
+} fb_flip_stats;
+
 typedef struct {
-    uint64_t fb_addr;
+    uint64_t fb_addr;           // buffer currently scanned out
     uint32_t fb_width;
     uint32_t fb_height;
     uint32_t fb_bpp;
 
     uint32_t fb_stride;
     uint32_t fb_size;
+
+    uint64_t fb_buffers[RAMFB_MAX_BUFFERS];
+    uint32_t fb_num_buffers;
+    uint32_t fb_back;           // index of buffer to draw next frame into
+
+    fb_flip_stats fb_stats;
 } fb_info;
 
 int ramfb_setup(fb_info *fb);
 
+int ramfb_setup_buffers(fb_info *fb, uint32_t num_buffers);
+uint64_t ramfb_flip(fb_info *fb);
+uint64_t ramfb_back_busy_ticks(fb_info *fb);
+void ramfb_print_stats(fb_info *fb);
+
 void write_xrgb256_pixel(fb_info *fb, uint16_t x, uint16_t y, uint8_t pixel[4]);
 void write_rgb256_pixel(fb_info *fb, uint16_t x, uint16_t y, uint8_t pixel[3]);
 void draw_rgb256_map(fb_info *fb, uint32_t x_res, uint32_t y_res, uint8_t *rgb_map);
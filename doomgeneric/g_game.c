@@ -34,6 +34,7 @@
 #include "m_controls.h"
 #include "m_misc.h"
 #include "m_menu.h"
+#include "m_perf.h"
 #include "m_random.h"
 #include "i_system.h"
 #include "i_timer.h"
@@ -66,6 +67,8 @@
 
 // SKY handling - still the wrong place.
 #include "r_data.h"
+#include "r_main.h"
+#include "r_plane.h"
 #include "r_sky.h"
 
 
@@ -856,12 +859,20 @@ void G_Ticker (void)
     int		i;
     int		buf; 
     ticcmd_t*	cmd;
+    perfstamp_t	perfstart;
     
     // do player reborns if needed
     for (i=0 ; i<MAXPLAYERS ; i++) 
 	if (playeringame[i] && players[i].playerstate == PST_REBORN) 
 	    G_DoReborn (i);
     
+#ifdef RENDER_SMP
+    // Level data may be freed or reloaded: the view rendering
+    //  in the background must be done first (see D_Display).
+    if (gameaction != ga_nothing)
+	R_FinishPlayerView ();
+#endif
+
     // do things to change the game state
     while (gameaction != ga_nothing) 
     { 
@@ -1005,7 +1016,9 @@ void G_Ticker (void)
     switch (gamestate) 
     { 
       case GS_LEVEL: 
+	M_PerfStart (&perfstart);
 	P_Ticker (); 
+	M_PerfStop (perf_ticker, &perfstart);
 	ST_Ticker (); 
 	AM_Ticker (); 
 	HU_Ticker ();            
@@ -2149,6 +2162,22 @@ static char *DemoVersionDescription(int version)
     }
 }
 
+//
+// -timedemo results
+// The demos are timed back to back (see G_TimeDemoList): a line
+//  of key=value pairs is printed for each one, then a summary.
+//
+static char**		timedemos;
+static int		numtimedemos;
+static int		timedemonum;
+static int		timedemofailures;
+static boolean		timedemobadversion;
+static int		timedemostartgametic;
+static int		timedemostartms;
+static int		timedemogametics;
+static int		timedemoms;
+static perfcounter_t	timedemoperf[NUMPERFPHASES];
+
 void G_DoPlayDemo (void) 
 { 
     skill_t skill; 
@@ -2156,6 +2185,7 @@ void G_DoPlayDemo (void)
     int demoversion;
 	 
     gameaction = ga_nothing; 
+    timedemobadversion = false;
     demobuffer = demo_p = W_CacheLumpName (defdemoname, PU_STATIC); 
 
     demoversion = *demo_p++;
@@ -2183,6 +2213,7 @@ void G_DoPlayDemo (void)
         //I_Error(message, demoversion, G_VanillaVersionCode(),
         printf(message, demoversion, G_VanillaVersionCode(),
                          DemoVersionDescription(demoversion));
+        timedemobadversion = true;
     }
     
     skill = *demo_p++; 
@@ -2210,6 +2241,14 @@ void G_DoPlayDemo (void)
     precache = true; 
     starttime = I_GetTime (); 
 
+    if (timingdemo)
+    {
+        timedemostartgametic = gametic;
+        timedemostartms = I_GetTimeMS ();
+        M_PerfRead (timedemoperf);
+        memset (&planestats, 0, sizeof(planestats));
+    }
+
     usergame = false; 
     demoplayback = true; 
 } 
@@ -2233,6 +2272,133 @@ void G_TimeDemo (char* name)
     defdemoname = name; 
     gameaction = ga_playdemo; 
 } 
+
+//
+// G_TimeDemoList
+// Times several demos back to back, then quits.
+//
+void G_TimeDemoList (char** names, int count)
+{
+    timedemos = names;
+    numtimedemos = count;
+    timedemonum = 0;
+
+    G_TimeDemo (names[0]);
+}
+
+// Frames per second, in hundredths.
+static int G_TimeDemoFPS (int gametics, int ms)
+{
+    if (ms <= 0)
+        return 0;
+
+    return (int) ((int64_t) gametics * 100 * 1000 / ms);
+}
+
+//
+// G_TimeDemoReport
+// Prints the results of the demo that just ended.
+//
+static void G_TimeDemoReport (int realtics, boolean completed)
+{
+    perfcounter_t	perf[NUMPERFPHASES];
+    char		line[512];
+    char*		status;
+    int			gametics;
+    int			ms;
+    int			fps;
+    int			len;
+    int			i;
+
+    M_PerfRead (perf);
+    gametics = gametic - timedemostartgametic;
+    ms = I_GetTimeMS () - timedemostartms;
+    fps = G_TimeDemoFPS (gametics, ms);
+
+    if (!completed)
+        status = "abort";
+    else if (timedemobadversion)
+        status = "fail";
+    else
+        status = "pass";
+
+    if (!completed || timedemobadversion)
+        timedemofailures++;
+
+    timedemogametics += gametics;
+    timedemoms += ms;
+
+    len = M_snprintf (line, sizeof(line),
+                      "timedemo: demo=%s status=%s res=%dx%d gametics=%d "
+                      "realtics=%d ms=%d fps=%d.%d%d",
+                      defdemoname, status, SCREENWIDTH, SCREENHEIGHT,
+                      gametics, realtics, ms,
+                      fps / 100, fps / 10 % 10, fps % 10);
+
+    for (i = 0; i < NUMPERFPHASES; i++)
+    {
+        if (perf[i].count == timedemoperf[i].count)
+            continue;
+
+        len += M_snprintf (line + len, sizeof(line) - len, " %s_us=%d",
+                           M_PerfPhaseName (i),
+                           M_PerfAverageUS (timedemoperf, perf, i));
+    }
+
+    if (planestats.frames > 0)
+    {
+        len += M_snprintf (line + len, sizeof(line) - len,
+                           " visplanes_avg=%d visplanes_max=%d",
+                           (int) (planestats.visplanes / planestats.frames),
+                           planestats.maxvisplanes);
+    }
+
+    printf ("%s\n", line);
+}
+
+//
+// G_TimeDemoDone
+// Prints the summary of all timed demos and quits: the exit
+//  status is non zero if one of them failed.
+//
+static void G_TimeDemoDone (void)
+{
+    int		fps;
+
+    fps = G_TimeDemoFPS (timedemogametics, timedemoms);
+
+    printf ("timedemo: result=%s demos=%d failed=%d gametics=%d "
+            "ms=%d fps=%d.%d%d\n",
+            timedemofailures ? "fail" : "pass", timedemonum + 1,
+            timedemofailures, timedemogametics, timedemoms,
+            fps / 100, fps / 10 % 10, fps % 10);
+
+    if (timedemofailures)
+    {
+        I_Error ("timedemo: %d of %d demos failed",
+                 timedemofailures, timedemonum + 1);
+    }
+
+    I_Quit ();
+}
+
+//
+// G_StopDemoPlayback
+// Restores the game settings changed by the demo.
+//
+static void G_StopDemoPlayback (void)
+{
+    W_ReleaseLumpName(defdemoname);
+    demoplayback = false; 
+    netdemo = false;
+    netgame = false;
+    deathmatch = false;
+    playeringame[1] = playeringame[2] = playeringame[3] = 0;
+    respawnparm = false;
+    fastparm = false;
+    nomonsters = false;
+    consoleplayer = 0;
+}
  
  
 /* 
@@ -2251,33 +2417,41 @@ boolean G_CheckDemoStatus (void)
 	 
     if (timingdemo) 
     { 
-        float fps;
         int realtics;
+        boolean completed;
 
 	endtime = I_GetTime (); 
         realtics = endtime - starttime;
-        fps = ((float) gametic * TICRATE) / realtics;
+
+        // Also called on exit: the demo may not have ended.
+        completed = demoplayback && *demo_p == DEMOMARKER;
 
         // Prevent recursive calls
         timingdemo = false;
-        demoplayback = false;
 
-	I_Error ("timed %i gametics in %i realtics (%f fps)",
-                 gametic, realtics, fps);
+        G_TimeDemoReport (realtics, completed);
+
+        if (!completed)
+        {
+            demoplayback = false;
+            return false;
+        }
+
+        G_StopDemoPlayback ();
+
+        if (timedemonum + 1 < numtimedemos)
+        {
+            G_TimeDemo (timedemos[++timedemonum]);
+            return true;
+        }
+
+        G_TimeDemoDone ();
+        return false;
     } 
 	 
     if (demoplayback) 
     { 
-        W_ReleaseLumpName(defdemoname);
-	demoplayback = false; 
-	netdemo = false;
-	netgame = false;
-	deathmatch = false;
-	playeringame[1] = playeringame[2] = playeringame[3] = 0;
-	respawnparm = false;
-	fastparm = false;
-	nomonsters = false;
-	consoleplayer = 0;
+        G_StopDemoPlayback ();
         
         if (singledemo) 
             I_Quit (); 
@@ -29,8 +29,10 @@
 
 #include "hu_stuff.h"
 #include "hu_lib.h"
+#include "m_argv.h"
 #include "m_controls.h"
 #include "m_misc.h"
+#include "m_perf.h"
 #include "w_wad.h"
 
 #include "s_sound.h"
@@ -59,6 +61,10 @@
 #define HU_INPUTWIDTH	64
 #define HU_INPUTHEIGHT	1
 
+// Frame phase timings, below the chat line.
+#define HU_PERFX	0
+#define HU_PERFY	(HU_INPUTY + 2*(SHORT(hu_font[0]->height) +1))
+
 
 
 char *chat_macros[10] =
@@ -104,6 +110,11 @@ extern int		showMessages;
 
 static boolean		headsupactive = false;
 
+#ifdef PERF_PHASES
+static boolean		perfhud;
+static hu_textline_t	w_perf[NUMPERFPHASES];
+#endif
+
 //
 // Builtin map names.
 // The actual names can be found in DStrings.h.
@@ -305,6 +316,17 @@ void HU_Init(void)
         hu_font[i] = (patch_t *) W_CacheLumpName(buffer, PU_STATIC);
     }
 
+#ifdef PERF_PHASES
+    //!
+    // @category video
+    //
+    // Show the minimum, average and 99th percentile time of each
+    // phase of a frame over the view, in microseconds.
+    //
+
+    perfhud = M_CheckParm("-perfhud") > 0;
+#endif
+
 }
 
 void HU_Stop(void)
@@ -383,10 +405,53 @@ void HU_Start(void)
     for (i=0 ; i<MAXPLAYERS ; i++)
 	HUlib_initIText(&w_inputbuffer[i], 0, 0, 0, 0, &always_off);
 
+#ifdef PERF_PHASES
+    // create the frame phase widgets
+    for (i=0 ; i<NUMPERFPHASES ; i++)
+	HUlib_initTextLine(&w_perf[i],
+			   HU_PERFX,
+			   HU_PERFY + i*(SHORT(hu_font[0]->height) +1),
+			   hu_font,
+			   HU_FONTSTART);
+#endif
+
     headsupactive = true;
 
 }
 
+#ifdef PERF_PHASES
+
+//
+// HU_DrawPerf
+// Statistics of the last 128 runs, one line per phase that ran.
+//
+static void HU_DrawPerf(void)
+{
+    perfstats_t	stats;
+    char	buf[HU_MAXLINELENGTH+1];
+    char*	s;
+    int		i;
+
+    for (i=0 ; i<NUMPERFPHASES ; i++)
+    {
+	HUlib_clearTextLine(&w_perf[i]);
+
+	if (!M_PerfStats(i, &stats))
+	    continue;
+
+	M_snprintf(buf, sizeof(buf), "%s %d %d %d",
+		   M_PerfPhaseName(i),
+		   stats.min_us, stats.avg_us, stats.p99_us);
+
+	for (s = buf; *s; s++)
+	    HUlib_addCharToTextLine(&w_perf[i], *s);
+
+	HUlib_drawTextLine(&w_perf[i], false);
+    }
+}
+
+#endif
+
 void HU_Drawer(void)
 {
 
@@ -395,6 +460,11 @@ void HU_Drawer(void)
     if (automapactive)
 	HUlib_drawTextLine(&w_title, false);
 
+#ifdef PERF_PHASES
+    if (perfhud)
+	HU_DrawPerf();
+#endif
+
 }
 
 void HU_Erase(void)
@@ -404,6 +474,16 @@ void HU_Erase(void)
     HUlib_eraseIText(&w_chat);
     HUlib_eraseTextLine(&w_title);
 
+#ifdef PERF_PHASES
+    if (perfhud)
+    {
+	int i;
+
+	for (i=0 ; i<NUMPERFPHASES ; i++)
+	    HUlib_eraseTextLine(&w_perf[i]);
+    }
+#endif
+
 }
 
 void HU_Ticker(void)
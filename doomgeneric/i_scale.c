@@ -32,6 +32,14 @@
 #define inline __inline
 #endif
 
+// The scale modes work on the 320x200 screen: the -hires screen
+// is already the size of the frame buffer (see I_FinishUpdate).
+
+#undef SCREENWIDTH
+#undef SCREENHEIGHT
+#define SCREENWIDTH  ORIGWIDTH
+#define SCREENHEIGHT ORIGHEIGHT
+
 // Should be I_VideoBuffer
 
 static byte *src_buffer;
@@ -263,6 +263,8 @@ void I_Quit (void)
 #if ORIGCODE
     SDL_Quit();
 
+    exit(0);
+#else
     exit(0);
 #endif
 }
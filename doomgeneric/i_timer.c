@@ -20,6 +20,7 @@
 #include "doomtype.h"
 
 #include "doomgeneric.h"
+#include "m_perf.h"
 
 #include <stdarg.h>
 
@@ -32,7 +33,10 @@
 // returns time in 1/35th second tics
 //
 
-static uint32_t basetime = 0;
+static uint64_t basetime = 0;
+
+// time spent in I_Sleep and I_SleepUntilUS, in microseconds
+static uint64_t sleeptime = 0;
 
 
 int I_GetTicks(void)
@@ -40,18 +44,21 @@ int I_GetTicks(void)
 	return DG_GetTicksMs();
 }
 
-int  I_GetTime (void)
+uint64_t I_GetTimeUS(void)
 {
-    uint32_t ticks;
+    uint64_t ticks;
 
-    ticks = I_GetTicks();
+    ticks = DG_GetTicksUs();
 
     if (basetime == 0)
         basetime = ticks;
 
-    ticks -= basetime;
+    return ticks - basetime;
+}
 
-    return (ticks * TICRATE) / 1000;
+int  I_GetTime (void)
+{
+    return (I_GetTimeUS() * TICRATE) / 1000000;
 }
 
 
@@ -61,24 +68,57 @@ int  I_GetTime (void)
 
 int I_GetTimeMS(void)
 {
-    uint32_t ticks;
-
-    ticks = I_GetTicks();
+    return I_GetTimeUS() / 1000;
+}
 
-    if (basetime == 0)
-        basetime = ticks;
+//
+// I_GetTicTimeUS
+// First microsecond of I_GetTimeUS at which I_GetTime returns tic.
+//
 
-    return ticks - basetime;
+uint64_t I_GetTicTimeUS(int tic)
+{
+    return ((uint64_t) tic * 1000000 + TICRATE - 1) / TICRATE;
 }
 
 // Sleep for a specified number of ms
 
 void I_Sleep(int ms)
 {
+	perfstamp_t perfstart;
+
     //SDL_Delay(ms);
     //usleep (ms * 1000);
+	uint64_t start;
 
+	M_PerfStart(&perfstart);
+	start = I_GetTimeUS();
 	DG_SleepMs(ms);
+	sleeptime += I_GetTimeUS() - start;
+	M_PerfStop(perf_sleep, &perfstart);
+}
+
+//
+// I_SleepUntilUS
+// Sleep until I_GetTimeUS reaches deadline: a single timer wakeup,
+// earlier if an input event arrives.
+//
+
+void I_SleepUntilUS(uint64_t deadline)
+{
+	perfstamp_t perfstart;
+	uint64_t start;
+
+	M_PerfStart(&perfstart);
+	start = I_GetTimeUS();
+	DG_SleepUntilUs(basetime + deadline);
+	sleeptime += I_GetTimeUS() - start;
+	M_PerfStop(perf_sleep, &perfstart);
+}
+
+uint64_t I_GetSleepTimeUS(void)
+{
+	return sleeptime;
 }
 
 void I_WaitVBL(int count)
@@ -20,6 +20,8 @@
 #ifndef __I_TIMER__
 #define __I_TIMER__
 
+#include "doomtype.h"
+
 #define TICRATE 35
 
 // Called by D_DoomLoop,
@@ -29,9 +31,21 @@ int I_GetTime (void);
 // returns current time in ms
 int I_GetTimeMS (void);
 
+// returns current time in microseconds, same origin as I_GetTime
+uint64_t I_GetTimeUS (void);
+
+// returns the time in microseconds at which a tic starts
+uint64_t I_GetTicTimeUS (int tic);
+
 // Pause for a specified number of ms
 void I_Sleep(int ms);
 
+// Pause until I_GetTimeUS reaches deadline, or an input event arrives
+void I_SleepUntilUS(uint64_t deadline);
+
+// Total time paused by I_Sleep and I_SleepUntilUS, in microseconds
+uint64_t I_GetSleepTimeUS(void);
+
 // Initialize timer
 void I_InitTimer(void);
 
@@ -28,6 +28,7 @@ rcsid[] = "$Id: i_x.c,v 1.6 1997/02/03 22:45:10 b1 Exp $";
 #include "config.h"
 #include "v_video.h"
 #include "m_argv.h"
+#include "m_perf.h"
 #include "d_event.h"
 #include "d_main.h"
 #include "i_video.h"
@@ -39,6 +40,10 @@ rcsid[] = "$Id: i_x.c,v 1.6 1997/02/03 22:45:10 b1 Exp $";
 
 #include "doomgeneric.h"
 
+#ifdef RENDER_SMP
+#include "smp.h"
+#endif
+
 #include <stdbool.h>
 #include <stdlib.h>
 
@@ -96,6 +101,14 @@ void I_GetEvent(void);
 
 byte *I_VideoBuffer = NULL;
 
+// Screen size shift: 1 for the 640x400 screen of -hires (see V_Init)
+
+int hires = 0;
+
+// Screen layout: 1 when screens are stored column by column (-colmajor)
+
+int colmajor = 0;
+
 // If true, game is running as a screensaver
 
 boolean screensaver_mode = false;
@@ -153,7 +166,23 @@ void cmap_to_rgb565(uint16_t * out, uint8_t * in, int in_pixels)
     }
 }
 
-void cmap_to_fb(uint8_t *out, uint8_t *in, int in_pixels)
+// 32 bpp frame buffer pixel of a palette color
+static inline uint32_t fb_pixel32(struct color c)
+{
+    uint32_t pix;
+
+    // Assuming RGBA8888
+    pix = (c.r << s_Fb.red.offset) |
+          (c.g << s_Fb.green.offset) |
+          (c.b << s_Fb.blue.offset);
+
+#ifdef SYS_BIG_ENDIAN
+    pix = swapLE32(pix);
+#endif
+    return pix;
+}
+
+void cmap_to_fb(uint8_t *out, uint8_t *in, int in_pixels, struct color *palette)
 {
     int i, k;
     struct color c;
@@ -161,7 +190,7 @@ void cmap_to_fb(uint8_t *out, uint8_t *in, int in_pixels)
 
     for (i = 0; i < in_pixels; i++)
     {
-        c = colors[*in];  // R:8 G:8 B:8
+        c = palette[*in];  // R:8 G:8 B:8
 
         if (s_Fb.bits_per_pixel == 16)
         {
@@ -180,14 +209,8 @@ void cmap_to_fb(uint8_t *out, uint8_t *in, int in_pixels)
         }
         else if (s_Fb.bits_per_pixel == 32)
         {
-            // Assuming RGBA8888
-            pix = (c.r << s_Fb.red.offset) |
-                  (c.g << s_Fb.green.offset) |
-                  (c.b << s_Fb.blue.offset);
+            pix = fb_pixel32(c);
 
-#ifdef SYS_BIG_ENDIAN
-            pix = swapLE32(pix);
-#endif
             for (k = 0; k < fb_scaling; k++) {
                 *(uint32_t *)out = pix;
                 out += 4;
@@ -202,6 +225,71 @@ void cmap_to_fb(uint8_t *out, uint8_t *in, int in_pixels)
     }
 }
 
+#ifndef DG_NATIVE
+
+//
+// RISC-V Vector palette expansion
+// cmap_to_fb_rvv (i_video_rvv.s) looks up a whole vector of screen
+// pixels at once in a table of frame buffer pixels, built from the
+// palette for each frame. Only used for 32 bpp frame buffers, once
+// I_CheckVectorExpansion has found it writes the same pixels as
+// cmap_to_fb.
+//
+
+int libc_has_rvv();
+void cmap_to_fb_rvv(uint32_t *out, uint8_t *in, int in_pixels,
+                    uint32_t *pixels, int scaling);
+
+static boolean fb_vector;
+static uint32_t fb_pixels[256];
+
+#define FB_CHECK_SCALING 4
+
+static boolean I_CheckVectorExpansion(void)
+{
+    static struct color palette[256];
+    static uint8_t line[MAXWIDTH];
+    static uint32_t scalar[MAXWIDTH * FB_CHECK_SCALING + 16];
+    static uint32_t vector[MAXWIDTH * FB_CHECK_SCALING + 16];
+    unsigned int seed = 1;
+    int scaling, saved_scaling;
+    int i;
+    boolean same = true;
+
+    for (i = 0; i < 256; i++) {
+        seed = seed * 1103515245 + 12345;
+        palette[i].r = seed >> 8;
+        palette[i].g = seed >> 16;
+        palette[i].b = seed >> 24;
+        palette[i].a = 0;
+        fb_pixels[i] = fb_pixel32(palette[i]);
+    }
+    for (i = 0; i < MAXWIDTH; i++) {
+        seed = seed * 1103515245 + 12345;
+        line[i] = seed >> 16;
+    }
+
+    // cmap_to_fb scales by fb_scaling
+    saved_scaling = fb_scaling;
+
+    for (scaling = 1; scaling <= FB_CHECK_SCALING && same; scaling++) {
+        for (i = 1; i <= MAXWIDTH && same; i += 61) {
+            memset(scalar, 0, sizeof(scalar));
+            memset(vector, 0, sizeof(vector));
+            fb_scaling = scaling;
+            cmap_to_fb((uint8_t *)scalar, line, i, palette);
+            cmap_to_fb_rvv(vector, line, i, fb_pixels, scaling);
+            same = memcmp(scalar, vector, sizeof(scalar)) == 0;
+        }
+    }
+
+    fb_scaling = saved_scaling;
+
+    return same;
+}
+
+#endif
+
 void I_InitGraphics (void)
 {
     int i, gfxmodeparm;
@@ -286,6 +374,15 @@ void I_InitGraphics (void)
     }
 
 
+#ifndef DG_NATIVE
+    // -vector: see R_InitSpans
+    if (s_Fb.bits_per_pixel == 32 && libc_has_rvv() && M_CheckParm("-vector")) {
+        fb_vector = I_CheckVectorExpansion();
+        printf("I_InitGraphics: %s\n", fb_vector ? "vector palette expansion"
+                : "vector palette expansion differs from the scalar one, not used");
+    }
+#endif
+
     /* Allocate screen to draw to */
 	I_VideoBuffer = (byte*)Z_Malloc (SCREENWIDTH * SCREENHEIGHT, PU_STATIC, NULL);  // For DOOM to draw on
 
@@ -315,14 +412,23 @@ void I_UpdateNoBlit (void)
 }
 
 //
-// I_FinishUpdate
+// I_PresentScreen
+// Expands a screen with a palette into the frame buffer and shows it.
 //
 
-void I_FinishUpdate (void)
+static void I_PresentScreen (byte *screen, struct color *palette)
 {
     int y;
+#ifndef DG_NATIVE
+    int c;
+#endif
     int x_offset, y_offset, x_offset_end;
     unsigned char *line_in, *line_out;
+    static byte row[MAXWIDTH];
+    perfstamp_t perfstart;
+    perfstamp_t perfdraw;
+
+    M_PerfStart(&perfstart);
 
     /* Offsets in case FB is bigger than DOOM */
     /* 600 = s_Fb heigt, 200 screenheight */
@@ -333,15 +439,28 @@ void I_FinishUpdate (void)
     //x_offset     = 0;
     x_offset_end = ((s_Fb.xres - (SCREENWIDTH  * fb_scaling)) * s_Fb.bits_per_pixel/8) - x_offset;
 
+#ifndef DG_NATIVE
+    if (fb_vector) {
+        for (c = 0; c < 256; c++)
+            fb_pixels[c] = fb_pixel32(palette[c]);
+    }
+#endif
+
     /* DRAW SCREEN */
-    line_in  = (unsigned char *) I_VideoBuffer;
     line_out = (unsigned char *) DG_ScreenBuffer;
 
-    y = SCREENHEIGHT;
-
-    while (y--)
+    for (y = 0; y < SCREENHEIGHT; y++)
     {
         int i;
+
+        // Column-major screens are transposed one row at a time.
+        if (colmajor) {
+            I_ReadScreenRow(screen, y, row);
+            line_in = row;
+        } else {
+            line_in = screen + y * SCREENWIDTH;
+        }
+
         for (i = 0; i < fb_scaling; i++) {
             line_out += x_offset;
 #ifdef CMAP256
@@ -359,14 +478,87 @@ void I_FinishUpdate (void)
             }
 #else
             //cmap_to_rgb565((void*)line_out, (void*)line_in, SCREENWIDTH);
-            cmap_to_fb((void*)line_out, (void*)line_in, SCREENWIDTH);
+#ifndef DG_NATIVE
+            if (fb_vector)
+                cmap_to_fb_rvv((void*)line_out, (void*)line_in, SCREENWIDTH, fb_pixels, fb_scaling);
+            else
+#endif
+            cmap_to_fb((void*)line_out, (void*)line_in, SCREENWIDTH, palette);
 #endif
             line_out += (SCREENWIDTH * fb_scaling * (s_Fb.bits_per_pixel/8)) + x_offset_end;
         }
-        line_in += SCREENWIDTH;
     }
 
+    M_PerfStart(&perfdraw);
 	DG_DrawFrame();
+    M_PerfStop(perf_drawframe, &perfdraw);
+
+    M_PerfStop(perf_present, &perfstart);
+}
+
+#ifdef RENDER_SMP
+
+//
+// Background presentation
+// Palette expansion and page flip of the last frame run on another
+//  hart while the next one is simulated and drawn: the screen and
+//  palette are copied, so the game may draw and change palette.
+//
+
+static boolean present_async;
+static smp_task_t present_task;
+static byte *present_screen;
+static struct color present_colors[256];
+
+static void I_PresentJob(void *arg, int index)
+{
+    I_PresentScreen(present_screen, present_colors);
+}
+
+void I_StartPresentStage (void)
+{
+    present_screen = Z_Malloc(SCREENWIDTH * SCREENHEIGHT, PU_STATIC, NULL);
+    present_async = true;
+}
+
+//
+// I_PresentStageTimes
+// Time spent presenting in the background and waiting for it,
+// in mtime ticks.
+//
+
+void I_PresentStageTimes (uint64_t *busy, uint64_t *stall)
+{
+    *busy = present_task.busy;
+    *stall = present_task.stall;
+}
+
+#endif
+
+//
+// I_FinishUpdate
+//
+
+void I_FinishUpdate (void)
+{
+    perfstamp_t perfstart;
+
+    M_PerfStart(&perfstart);
+
+#ifdef RENDER_SMP
+    if (present_async)
+    {
+        smp_wait(&present_task);
+        memcpy(present_screen, I_VideoBuffer, SCREENWIDTH * SCREENHEIGHT);
+        memcpy(present_colors, colors, sizeof(colors));
+        smp_submit(&present_task, I_PresentJob, NULL);
+        M_PerfStop(perf_finishupdate, &perfstart);
+        return;
+    }
+#endif
+
+    I_PresentScreen(I_VideoBuffer, colors);
+    M_PerfStop(perf_finishupdate, &perfstart);
 }
 
 //
@@ -377,6 +569,26 @@ void I_ReadScreen (byte* scr)
     memcpy (scr, I_VideoBuffer, SCREENWIDTH * SCREENHEIGHT);
 }
 
+//
+// I_ReadScreenRow
+// Copies row y of a screen, stored by rows or by columns.
+//
+void I_ReadScreenRow (byte* screen, int y, byte* row)
+{
+    int x;
+
+    if (!colmajor)
+    {
+        memcpy (row, screen + y * SCREENWIDTH, SCREENWIDTH);
+        return;
+    }
+
+    screen += y;
+
+    for (x = 0; x < SCREENWIDTH; x++, screen += SCREENHEIGHT)
+        row[x] = *screen;
+}
+
 //
 // I_SetPalette
 //
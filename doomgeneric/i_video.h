@@ -22,10 +22,38 @@
 
 #include "doomtype.h"
 
-// Screen width and height.
+// Size of the original screen: the coordinates in which patches,
+//  menus and the status bar are laid out.
 
-#define SCREENWIDTH  320
-#define SCREENHEIGHT 200
+#define ORIGWIDTH  320
+#define ORIGHEIGHT 200
+
+// Screen width and height: doubled with -hires, where the 3D view
+//  is rendered at the size of the 640x400 frame buffer and the 2D
+//  graphics are drawn with each pixel doubled.
+
+extern int hires;
+
+#define SCREENWIDTH  (ORIGWIDTH << hires)
+#define SCREENHEIGHT (ORIGHEIGHT << hires)
+
+// Screens are stored row by row, or column by column with -colmajor
+//  (see V_Init), so that the column drawers of the 3D view write
+//  contiguous bytes. The frame is transposed when it is presented.
+
+extern int colmajor;
+
+// Distance between horizontally (SCREENXSTEP) and vertically
+//  (SCREENYSTEP) adjacent pixels of a screen, and offset of a pixel.
+
+#define SCREENXSTEP  (colmajor ? SCREENHEIGHT : 1)
+#define SCREENYSTEP  (colmajor ? 1 : SCREENWIDTH)
+#define SCREENOFS(x, y) ((x) * SCREENXSTEP + (y) * SCREENYSTEP)
+
+// Largest screen size, for arrays indexed by screen column or row.
+
+#define MAXWIDTH  (ORIGWIDTH << 1)
+#define MAXHEIGHT (ORIGHEIGHT << 1)
 
 // Screen width used for "squash" scale functions
 
@@ -107,8 +135,17 @@ int I_GetPaletteIndex(int r, int g, int b);
 void I_UpdateNoBlit (void);
 void I_FinishUpdate (void);
 
+#ifdef RENDER_SMP
+// Pipelined display: frames are presented in the background.
+void I_StartPresentStage (void);
+void I_PresentStageTimes (uint64_t *busy, uint64_t *stall);
+#endif
+
 void I_ReadScreen (byte* scr);
 
+// Copies row y of a screen, also when screens are column-major.
+void I_ReadScreenRow (byte* screen, int y, byte* row);
+
 void I_BeginRead (void);
 
 void I_SetWindowTitle(char *title);
@@ -0,0 +1,43 @@
+# RISC-V Vector (RVV 1.0) palette expansion of i_video.c, selected by
+# I_InitGraphics when 'misa' reports the V extension.
+# Each iteration widens as many screen pixels as fit in a group of 8 vector
+# registers of 32-bit elements into offsets in the table of frame buffer
+# pixels, and looks them up with an indexed load.
+
+.option arch, +v
+
+# void cmap_to_fb_rvv(uint32_t *out, uint8_t *in, int in_pixels,
+#                     uint32_t *pixels, int scaling)
+# 32 bpp frame buffers: each pixel is written scaling times
+.global cmap_to_fb_rvv
+cmap_to_fb_rvv:
+    blez    a2, 9f
+    blez    a4, 9f
+    slli    t2, a4, 2               # bytes from one screen pixel to the next
+    li      t3, 1
+1:
+    vsetvli t0, a2, e8, m2, ta, ma
+    vle8.v  v4, (a1)
+    vsetvli zero, zero, e32, m8, ta, ma
+    vzext.vf4 v8, v4
+    vsll.vi v8, v8, 2
+    vluxei32.v v16, (a3), v8        # pixels[*in]
+    bne     a4, t3, 2f
+    vse32.v v16, (a0)
+    j       4f
+2:
+    mv      t4, a0                  # one strided store per copy
+    mv      t5, a4
+3:
+    vsse32.v v16, (t4), t2
+    addi    t4, t4, 4
+    addi    t5, t5, -1
+    bnez    t5, 3b
+4:
+    mul     t1, t0, t2
+    add     a0, a0, t1
+    add     a1, a1, t0
+    sub     a2, a2, t0
+    bnez    a2, 1b
+9:
+    ret
@@ -32,9 +32,11 @@ int toupper(int c) {
 
 #include <stdio.h>
 #include "uart_serial.h"
+#include <stdlib.h>
 
-FILE * stderr;
-FILE * stdout;
+// streams are only told apart: stdout is buffered, stderr is not (see uart_serial.c)
+FILE * stderr = (FILE *) 2;
+FILE * stdout = (FILE *) 1;
 
 int fprintf(FILE *stream, const char *format, ...) {
     if (stream!=stderr && stream!=stdout ) {
@@ -48,7 +50,7 @@ int fprintf(FILE *stream, const char *format, ...) {
     /* Initialise the va_list variable with the ... after fmt */
     va_start(myargs, format);
     /* Forward the '...' to vprintf */
-    ret = kvprintf(format, myargs);
+    ret = vfprintf(stream, format, myargs);
     /* Clean up the va_list */
     va_end(myargs);
     return ret;
@@ -77,6 +79,8 @@ int vfprintf(FILE *stream, const char *format, va_list argptr) {
         return -1;
     }
 
+    if (stream == stderr)
+        return kvprintf_unbuffered(format, argptr);
     return kvprintf(format, argptr);
 }
 
@@ -86,7 +90,7 @@ int vsnprintf(char *buffer, size_t buf_size, const char *format, va_list argptr)
 
 int sscanf(const char *buffer, const char *format, ...) {
     printf("sscanf: ERROR unimplemented function\n");
-    poweroff();
+    abort();
     return 0;
 }
 
@@ -105,6 +109,7 @@ long ftell(FILE *stream) {
 }
 
 int fflush(FILE *stream) {
+    kconsole_flush();
     return 0;
 }
 
@@ -120,7 +125,7 @@ size_t fwrite(const void *buffer, size_t size, size_t count, FILE *stream) {
 
 size_t fread(void *buffer, size_t size, size_t count, FILE *stream) {
     printf("fread: ERROR unimplemented function\n");
-    poweroff();
+    abort();
     return 0;
 }
 
@@ -188,24 +193,216 @@ int strncmp(const char *s1, const char *s2, size_t count) {
 
 #include <stdlib.h>
 #include <string.h>
+#include <malloc.h>
+
+/* Heap allocator
+
+Boundary-tag allocator with segregated free lists. Each block starts with a
+16 bytes header storing its own size (low bit set when in use) and the size of
+the physically previous block: free() coalesces with both neighbours and
+realloc() knows how many bytes the caller owns, so it can grow in place.
+
+Free blocks are kept in power-of-two size classes: bin N holds blocks of
+[2^(N+MIN_SHIFT), 2^(N+MIN_SHIFT+1)) bytes.
+The heap grows upward from _stack_top (see riscv64-virt.ld) to the end of
+guest RAM (native build: a static array as large as guest RAM). Memory above 'heap_start' is the "top" chunk: a block freed next to
+it is given back, so the heap shrinks again after transient peaks.
+*/
 
+#ifdef DG_NATIVE
+static uint8_t native_heap[128 << 20] __attribute__((aligned(16)));
+uint64_t heap_start = (uint64_t)native_heap;    // current top of heap
+static const uint64_t heap_base = (uint64_t)native_heap;
+
+#define HEAP_END        (heap_base + sizeof(native_heap))
+#else
 // init heap memory address
 extern uint64_t _stack_top;
-uint64_t heap_start = (uint64_t)&_stack_top;
+uint64_t heap_start = (uint64_t)&_stack_top;    // current top of heap
+static const uint64_t heap_base = (uint64_t)&_stack_top;
+
+// end of guest RAM: 0x80000000 + 128MB (see '-m 128M' in qemu-run.sh)
+#define HEAP_END        0x88000000UL
+#endif
+
+#define HDR_SIZE        16
+#define MIN_SHIFT       5
+#define MIN_BLOCK       (1UL << MIN_SHIFT)  // header + free list links
+#define NUM_BINS        32
+#define INUSE           1UL
+
+typedef struct block_s {
+    size_t size;            // block size (header included) | INUSE
+    size_t prev_size;       // size of previous block, 0 for the first one
+    struct block_s *next;   // free list links (valid only for free blocks)
+    struct block_s *prev;
+} block_t;
+
+#define block_size(b)       ((b)->size & ~INUSE)
+#define block_inuse(b)      ((b)->size & INUSE)
+#define block_next(b)       ((block_t *)((uint8_t *)(b) + block_size(b)))
+#define block_prev(b)       ((block_t *)((uint8_t *)(b) - (b)->prev_size))
+#define block_payload(b)    ((void *)((uint8_t *)(b) + HDR_SIZE))
+#define payload_block(p)    ((block_t *)((uint8_t *)(p) - HDR_SIZE))
+#define is_top(b)           ((uint64_t)(b) == heap_start)
+
+static block_t *bins[NUM_BINS];
+static size_t top_prev_size = 0;    // size of the block right below top
+static struct mallinfo stats;
+
+static int size_to_bin(size_t size) {
+    int bin = (63 - __builtin_clzl(size)) - MIN_SHIFT;
+    return bin < NUM_BINS ? bin : NUM_BINS - 1;
+}
+
+static size_t request_to_size(size_t size) {
+    if (size > HEAP_END - heap_base)
+        return 0;
+    size = (size + HDR_SIZE + 15) & ~15UL;
+    return size < MIN_BLOCK ? MIN_BLOCK : size;
+}
+
+static void bin_insert(block_t *b) {
+    int bin = size_to_bin(block_size(b));
+    b->prev = NULL;
+    b->next = bins[bin];
+    if (b->next)
+        b->next->prev = b;
+    bins[bin] = b;
+    stats.ordblks++;
+    stats.fordblks += block_size(b);
+}
+
+static void bin_remove(block_t *b) {
+    if (b->prev)
+        b->prev->next = b->next;
+    else
+        bins[size_to_bin(block_size(b))] = b->next;
+    if (b->next)
+        b->next->prev = b->prev;
+    stats.ordblks--;
+    stats.fordblks -= block_size(b);
+}
+
+// propagate size of 'b' to the 'prev_size' field of the following block
+static void set_next_prev_size(block_t *b) {
+    block_t *n = block_next(b);
+    if (is_top(n))
+        top_prev_size = block_size(b);
+    else
+        n->prev_size = block_size(b);
+}
+
+// Put a free (already coalesced) block back to top chunk or to its bin.
+static void release_block(block_t *b) {
+    if (is_top(block_next(b))) {
+        heap_start = (uint64_t)b;
+        top_prev_size = b->prev_size;
+    } else {
+        set_next_prev_size(b);
+        bin_insert(b);
+    }
+}
+
+// Shrink in-use block 'b' to 'size' bytes, giving back the remainder.
+static void split_block(block_t *b, size_t size) {
+    size_t total = block_size(b);
+    if (total - size < MIN_BLOCK)
+        return;
+
+    b->size = size | INUSE;
+    stats.uordblks -= total - size;
+
+    block_t *rest = block_next(b);
+    rest->size = total - size;
+    rest->prev_size = size;
+
+    block_t *n = block_next(rest);
+    if (!is_top(n) && !block_inuse(n)) {
+        bin_remove(n);
+        rest->size += block_size(n);
+    }
+    release_block(rest);
+}
+
+static void update_watermark() {
+    if (heap_start - heap_base > stats.usmblks)
+        stats.usmblks = heap_start - heap_base;
+}
+
+static block_t *carve_top(size_t size) {
+    if (HEAP_END - heap_start < size)
+        return NULL;
+
+    block_t *b = (block_t *)heap_start;
+    b->size = size | INUSE;
+    b->prev_size = top_prev_size;
+    heap_start += size;
+    top_prev_size = size;
+    stats.uordblks += size;
+    update_watermark();
+    return b;
+}
+
+static block_t *find_free_block(size_t size) {
+    for (int bin = size_to_bin(size); bin < NUM_BINS; bin++) {
+        // first fit: any block of an upper bin is big enough
+        for (block_t *b = bins[bin]; b != NULL; b = b->next) {
+            if (block_size(b) >= size) {
+                bin_remove(b);
+                b->size |= INUSE;
+                stats.uordblks += block_size(b);
+                split_block(b, size);
+                return b;
+            }
+        }
+    }
+    return NULL;
+}
 
 void free(void *ptr) {
-    printf("free() ignored!\n");
+    if (ptr == NULL)
+        return;
+
+    block_t *b = payload_block(ptr);
+    if (!block_inuse(b)) {
+        printf("free: ERROR double free of [%p]\n", ptr);
+        return;
+    }
+    b->size &= ~INUSE;
+    stats.uordblks -= block_size(b);
+
+    // coalesce with previous and next free blocks
+    if (b->prev_size != 0 && !block_inuse(block_prev(b))) {
+        block_t *p = block_prev(b);
+        bin_remove(p);
+        p->size += block_size(b);
+        b = p;
+    }
+    block_t *n = block_next(b);
+    if (!is_top(n) && !block_inuse(n)) {
+        bin_remove(n);
+        b->size += block_size(n);
+    }
+    release_block(b);
 }
 
 void *malloc(size_t size) {
-    void *addr = (void*) heap_start;
-    heap_start += size;
-    printf("malloc: addr [%p], size [%d]\n", addr, size);
-    return addr;
+    size_t bsize = request_to_size(size);
+    if (bsize == 0)
+        return NULL;
+
+    block_t *b = find_free_block(bsize);
+    if (b == NULL)
+        b = carve_top(bsize);
+    if (b == NULL) {
+        printf("malloc: ERROR out of memory, size [%d]\n", size);
+        return NULL;
+    }
+    return block_payload(b);
 }
 
 void *realloc(void *memblock, size_t size) {
-    printf("realloc\n");
     if (memblock == NULL) {
         // Equivalent to malloc
         return malloc(size);
@@ -217,21 +414,45 @@ void *realloc(void *memblock, size_t size) {
         return NULL;
     }
 
-    // Allocate new block
+    size_t bsize = request_to_size(size);
+    if (bsize == 0)
+        return NULL;
+
+    block_t *b = payload_block(memblock);
+    size_t cur = block_size(b);
+
+    // shrink in place
+    if (cur >= bsize) {
+        split_block(b, bsize);
+        return memblock;
+    }
+
+    // grow in place: last block extends into top, otherwise absorb next free block
+    block_t *n = block_next(b);
+    if (is_top(n)) {
+        if (HEAP_END - heap_start >= bsize - cur) {
+            heap_start += bsize - cur;
+            b->size = bsize | INUSE;
+            top_prev_size = bsize;
+            stats.uordblks += bsize - cur;
+            update_watermark();
+            return memblock;
+        }
+    } else if (!block_inuse(n) && cur + block_size(n) >= bsize) {
+        bin_remove(n);
+        b->size += block_size(n);
+        stats.uordblks += block_size(n);
+        set_next_prev_size(b);
+        split_block(b, bsize);
+        return memblock;
+    }
+
+    // Allocate new block and move data
     void *new_block = malloc(size);
     if (!new_block) {
         return NULL;
     }
-
-    // Copy old data to new block
-    // NOTE: In a freestanding environment, we don't know the original size,
-    // so this assumes the caller tracks it or uses a fixed-size allocation.
-    // For demonstration, we assume a safe minimum copy size.
-    // You should replace this with actual size tracking if available.
-    size_t copy_size = size; // Replace with actual old size if known
-    memcpy(new_block, memblock, copy_size);
-
-    // Free old block
+    memcpy(new_block, memblock, cur - HDR_SIZE);
     free(memblock);
 
     return new_block;
@@ -239,8 +460,10 @@ void *realloc(void *memblock, size_t size) {
 
 
 void *calloc(size_t number, size_t size) {
-    printf("calloc\n");
     size_t total = number * size;
+    if (size != 0 && total / size != number) {
+        return NULL;
+    }
     void *ptr = malloc(total);
     if (!ptr) {
         return NULL;
@@ -248,12 +471,25 @@ void *calloc(size_t number, size_t size) {
     return memset(ptr, 0, total);
 }
 
+struct mallinfo mallinfo(void) {
+    struct mallinfo mi = stats;
+    mi.arena = heap_start - heap_base;
+    mi.keepcost = HEAP_END - heap_start;
+    return mi;
+}
+
+void malloc_stats(void) {
+    struct mallinfo mi = mallinfo();
+    printf("malloc_stats: heap [%d], high-watermark [%d], allocated [%d], free [%d] in [%d] blocks, top [%d]\n",
+           mi.arena, mi.usmblks, mi.uordblks, mi.fordblks, mi.ordblks, mi.keepcost);
+}
+
 void exit(int status) {
-    poweroff();
+    poweroff_exit(status);
 }
 
 void abort(void) {
-    poweroff();
+    poweroff_exit(1);
 }
 
 int atoi(const char *str) {
@@ -327,7 +563,7 @@ double atof(const char *str) {
 
 int system(const char *command) {
     printf("system: command [%s]. ERROR unimplemented system function\n", command);
-    poweroff();
+    abort();
     return 0;
 }
 
@@ -340,55 +576,197 @@ int abs(int n) {
 
 #include <string.h>
 
-void *memset(void *dest, int c, size_t count) {
+/* Memory block functions
+
+Scalar versions move 64-bit words once the destination is aligned (and the
+source shares the same alignment), falling back to bytes for head, tail and
+mutually misaligned buffers.
+When the hart implements the V extension (see 'misa') memcpy/memset/memmove
+are routed to the RVV versions in libc_rvv.s. The implementation is resolved
+on first use, which happens early during startup.
+*/
+
+#define WORD_SIZE       sizeof(uint64_t)
+#define WORD_MASK       (WORD_SIZE - 1)
+
+#define MISA_V          (1UL << ('V' - 'A'))
+#define MSTATUS_VS_INIT 0x200   // Vector extension state: initial
+
+// no loop idiom recognition here: it would turn these loops into calls to themselves
+#define NO_LIBCALL __attribute__((optimize("no-tree-loop-distribute-patterns")))
+
+void *memcpy_rvv(void *dest, const void *src, size_t count);
+void *memset_rvv(void *dest, int c, size_t count);
+void *memmove_rvv(void *dest, const void *src, size_t count);  // backward copy only
+
+NO_LIBCALL
+static void *memset_scalar(void *dest, int c, size_t count) {
     unsigned char *d = (unsigned char *)dest;
     unsigned char value = (unsigned char)c;
 
-    for (size_t i = 0; i < count; i++) {
-        d[i] = value;
+    if (count >= 2 * WORD_SIZE) {
+        uint64_t pattern = value * 0x0101010101010101UL;
+
+        while ((uintptr_t)d & WORD_MASK) {
+            *d++ = value;
+            count--;
+        }
+        uint64_t *dw = (uint64_t *)d;
+        for (; count >= 4 * WORD_SIZE; count -= 4 * WORD_SIZE) {
+            dw[0] = pattern;
+            dw[1] = pattern;
+            dw[2] = pattern;
+            dw[3] = pattern;
+            dw += 4;
+        }
+        for (; count >= WORD_SIZE; count -= WORD_SIZE) {
+            *dw++ = pattern;
+        }
+        d = (unsigned char *)dw;
+    }
+
+    while (count--) {
+        *d++ = value;
     }
 
     return dest;
 }
 
-
-void *memcpy(void *dest, const void *src, size_t count) {
+// forward copy, also safe for overlapping buffers when dest < src
+NO_LIBCALL
+static void *memcpy_scalar(void *dest, const void *src, size_t count) {
     unsigned char *d = (unsigned char *)dest;
     const unsigned char *s = (const unsigned char *)src;
 
-    for (size_t i = 0; i < count; i++) {
-        d[i] = s[i];
+    if (count >= 2 * WORD_SIZE && (((uintptr_t)d ^ (uintptr_t)s) & WORD_MASK) == 0) {
+        while ((uintptr_t)d & WORD_MASK) {
+            *d++ = *s++;
+            count--;
+        }
+        uint64_t *dw = (uint64_t *)d;
+        const uint64_t *sw = (const uint64_t *)s;
+        for (; count >= 4 * WORD_SIZE; count -= 4 * WORD_SIZE) {
+            uint64_t w0 = sw[0], w1 = sw[1], w2 = sw[2], w3 = sw[3];
+            dw[0] = w0;
+            dw[1] = w1;
+            dw[2] = w2;
+            dw[3] = w3;
+            dw += 4;
+            sw += 4;
+        }
+        for (; count >= WORD_SIZE; count -= WORD_SIZE) {
+            *dw++ = *sw++;
+        }
+        d = (unsigned char *)dw;
+        s = (const unsigned char *)sw;
+    }
+
+    while (count--) {
+        *d++ = *s++;
     }
 
     return dest;
 }
 
+// backward copy, for overlapping buffers when dest > src
+NO_LIBCALL
+static void *memmove_scalar(void *dest, const void *src, size_t count) {
+    unsigned char *d = (unsigned char *)dest + count;
+    const unsigned char *s = (const unsigned char *)src + count;
 
-void *memmove(void *dest, const void *src, size_t count) {
-    unsigned char *d = (unsigned char *)dest;
-    const unsigned char *s = (const unsigned char *)src;
+    if (count >= 2 * WORD_SIZE && (((uintptr_t)d ^ (uintptr_t)s) & WORD_MASK) == 0) {
+        while ((uintptr_t)d & WORD_MASK) {
+            *--d = *--s;
+            count--;
+        }
+        uint64_t *dw = (uint64_t *)d;
+        const uint64_t *sw = (const uint64_t *)s;
+        for (; count >= WORD_SIZE; count -= WORD_SIZE) {
+            *--dw = *--sw;
+        }
+        d = (unsigned char *)dw;
+        s = (const unsigned char *)sw;
+    }
+
+    while (count--) {
+        *--d = *--s;
+    }
+
+    return dest;
+}
+
+static void *memcpy_resolve(void *dest, const void *src, size_t count);
+static void *memset_resolve(void *dest, int c, size_t count);
+static void *memmove_resolve(void *dest, const void *src, size_t count);
+
+static void *(*memcpy_impl)(void *, const void *, size_t) = memcpy_resolve;
+static void *(*memset_impl)(void *, int, size_t) = memset_resolve;
+static void *(*memmove_impl)(void *, const void *, size_t) = memmove_resolve;
+
+int libc_has_rvv() {
+#ifdef DG_NATIVE
+    return 0;   // misa is not readable from user space
+#else
+    uint64_t misa;
+    asm volatile("csrr %0, misa" : "=r"(misa));
+    return (misa & MISA_V) != 0;
+#endif
+}
+
+static void memops_resolve() {
+    memcpy_impl = memcpy_scalar;
+    memset_impl = memset_scalar;
+    memmove_impl = memmove_scalar;
 
-    if (d == s || count == 0) {
+#ifndef DG_NATIVE
+    if (libc_has_rvv()) {
+        // vector unit is off at reset: enable it before first use
+        asm volatile("csrs mstatus, %0" :: "r"(MSTATUS_VS_INIT));
+        memcpy_impl = memcpy_rvv;
+        memset_impl = memset_rvv;
+        memmove_impl = memmove_rvv;
+    }
+#endif
+}
+
+static void *memcpy_resolve(void *dest, const void *src, size_t count) {
+    memops_resolve();
+    return memcpy_impl(dest, src, count);
+}
+
+static void *memset_resolve(void *dest, int c, size_t count) {
+    memops_resolve();
+    return memset_impl(dest, c, count);
+}
+
+static void *memmove_resolve(void *dest, const void *src, size_t count) {
+    memops_resolve();
+    return memmove_impl(dest, src, count);
+}
+
+void *memset(void *dest, int c, size_t count) {
+    return memset_impl(dest, c, count);
+}
+
+void *memcpy(void *dest, const void *src, size_t count) {
+    return memcpy_impl(dest, src, count);
+}
+
+void *memmove(void *dest, const void *src, size_t count) {
+    if (dest == src || count == 0) {
         return dest;
     }
 
-    if (d < s) {
+    if ((uintptr_t)dest < (uintptr_t)src || (uintptr_t)dest >= (uintptr_t)src + count) {
         // Copy forward
-        for (size_t i = 0; i < count; i++) {
-            d[i] = s[i];
-        }
-    } else {
-        // Copy backward
-        for (size_t i = count; i > 0; i--) {
-            d[i - 1] = s[i - 1];
-        }
+        return memcpy_impl(dest, src, count);
     }
 
-    return dest;
+    // Copy backward
+    return memmove_impl(dest, src, count);
 }
 
 
-
 size_t strlen(const char *str) {
     size_t len = 0;
     while (str[len] != '\0') {
@@ -447,6 +825,18 @@ char *strdup(const char *string) {
     return copy;
 }
 
+int memcmp(const void *s1, const void *s2, size_t count) {
+    const unsigned char *p1 = s1;
+    const unsigned char *p2 = s2;
+
+    for (size_t i = 0; i < count; i++) {
+        if (p1[i] != p2[i]) {
+            return p1[i] - p2[i];
+        }
+    }
+    return 0;
+}
+
 int strcmp(const char *s1, const char *s2) {
     while (*s1 && (*s1 == *s2)) {
         s1++;
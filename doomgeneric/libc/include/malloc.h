@@ -0,0 +1,19 @@
+#ifndef __MALLOC_H__
+#define __MALLOC_H__
+
+#include <stddef.h>
+
+// Heap counters (subset of glibc 'struct mallinfo', sizes in bytes)
+struct mallinfo {
+    size_t arena;       // heap size currently carved from RAM
+    size_t ordblks;     // number of free blocks
+    size_t usmblks;     // high-watermark of 'arena'
+    size_t uordblks;    // allocated bytes
+    size_t fordblks;    // bytes in free blocks
+    size_t keepcost;    // bytes still available above heap top
+};
+
+struct mallinfo mallinfo(void);
+void malloc_stats(void);
+
+#endif
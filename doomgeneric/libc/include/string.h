@@ -6,6 +6,7 @@
 void *memset(void *dest, int c, size_t count);
 void *memcpy(void *dest, const void *src, size_t count);
 void *memmove(void *dest, const void *src, size_t count);
+int memcmp(const void *s1, const void *s2, size_t count);
 
 size_t strlen(const char *str);
 int strcasecmp(const char *s1, const char *s2);
@@ -0,0 +1,50 @@
+# RISC-V Vector (RVV 1.0) versions of memcpy/memset/memmove,
+# selected by libc.c when 'misa' reports the V extension.
+# Each iteration moves as many bytes as fit in a group of 8 vector registers.
+
+.option arch, +v
+
+# void *memcpy_rvv(void *dest, const void *src, size_t count)
+# forward copy: also used by memmove() when dest < src
+.global memcpy_rvv
+memcpy_rvv:
+    mv      a3, a0
+1:
+    vsetvli t0, a2, e8, m8, ta, ma
+    vle8.v  v0, (a1)
+    vse8.v  v0, (a3)
+    add     a1, a1, t0
+    add     a3, a3, t0
+    sub     a2, a2, t0
+    bnez    a2, 1b
+    ret
+
+# void *memset_rvv(void *dest, int c, size_t count)
+.global memset_rvv
+memset_rvv:
+    mv      a3, a0
+    vsetvli t0, a2, e8, m8, ta, ma
+    vmv.v.x v0, a1
+1:
+    vsetvli t0, a2, e8, m8, ta, ma
+    vse8.v  v0, (a3)
+    add     a3, a3, t0
+    sub     a2, a2, t0
+    bnez    a2, 1b
+    ret
+
+# void *memmove_rvv(void *dest, const void *src, size_t count)
+# backward copy, for overlapping buffers when dest > src
+.global memmove_rvv
+memmove_rvv:
+    add     a3, a0, a2
+    add     a1, a1, a2
+1:
+    vsetvli t0, a2, e8, m8, ta, ma
+    sub     a1, a1, t0
+    sub     a3, a3, t0
+    vle8.v  v0, (a1)
+    vse8.v  v0, (a3)
+    sub     a2, a2, t0
+    bnez    a2, 1b
+    ret
@@ -26,6 +26,8 @@
 #include "m_misc.h"
 #include "m_argv.h"  // haleyjd 20110212: warning fix
 
+#include "qemu_dma.h"
+
 int		myargc;
 char**		myargv;
 
@@ -76,6 +78,9 @@ static void LoadResponseFile(int argv_index)
 {
 #if ORIGCODE
     FILE *handle;
+#else
+    const fw_cfg_file_t *handle;
+#endif
     int size;
     char *infile;
     char *file;
@@ -87,7 +92,13 @@ static void LoadResponseFile(int argv_index)
     response_filename = myargv[argv_index] + 1;
 
     // Read the response file into memory
+#if ORIGCODE
     handle = fopen(response_filename, "rb");
+#else
+    // There is no file system: response files are supplied by the
+    // host, eg. -fw_cfg name=opt/doom/args,file=args.txt
+    handle = fw_cfg_find(response_filename);
+#endif
 
     if (handle == NULL)
     {
@@ -95,11 +106,16 @@ static void LoadResponseFile(int argv_index)
 #if ORIGCODE
         exit(1);
 #endif
+        return;
     }
 
     printf("Found response file %s!\n", response_filename);
 
+#if ORIGCODE
     size = M_FileLength(handle);
+#else
+    size = handle->size;
+#endif
 
     // Read in the entire file
     // Allocate one byte extra - this is in case there is an argument
@@ -108,6 +124,7 @@ static void LoadResponseFile(int argv_index)
 
     file = malloc(size + 1);
 
+#if ORIGCODE
     i = 0;
 
     while (i < size)
@@ -123,6 +140,12 @@ static void LoadResponseFile(int argv_index)
     }
 
     fclose(handle);
+#else
+    if (fw_cfg_read_file(handle, 0, file, size) != size)
+    {
+        I_Error("Failed to read full contents of '%s'", response_filename);
+    }
+#endif
 
     // Create new arguments list array
 
@@ -155,6 +178,12 @@ static void LoadResponseFile(int argv_index)
             break;
         }
 
+        if (newargc + myargc - argv_index > MAXARGVS)
+        {
+            I_Error("Too many arguments in response file '%s'",
+                    response_filename);
+        }
+
         // If the next argument is enclosed in quote marks, treat
         // the contents as a single argument.  This allows long filenames
         // to be specified.
@@ -225,7 +254,6 @@ static void LoadResponseFile(int argv_index)
         printf("'%s'\n", myargv[k]);
     }
 #endif
-#endif
 }
 
 //
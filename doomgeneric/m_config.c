@@ -516,6 +516,21 @@ static default_t	doom_defaults_list[] =
 
     CONFIG_VARIABLE_INT(detaillevel),
 
+    //!
+    // If non-zero, the detail and then the screen size are lowered
+    // while frames take longer than frame_budget, and restored when
+    // they are well under it. The detail and size set from the menu
+    // are the best ones used.
+    //
+
+    CONFIG_VARIABLE_INT(frame_governor),
+
+    //!
+    // Frame time budget of frame_governor, in microseconds.
+    //
+
+    CONFIG_VARIABLE_INT(frame_budget),
+
     //!
     // Number of sounds that will be played simultaneously.
     //
@@ -48,6 +48,8 @@
 #include "w_wad.h"
 #include "z_zone.h"
 
+#include "qemu_dma.h"
+
 //
 // Create a directory
 //
@@ -68,6 +70,10 @@ boolean M_FileExists(char *filename)
     if ( strcmp(filename, "doom1.wad") == 0)
         return true;
 
+    // file supplied by the host with -fw_cfg name=...
+    if (fw_cfg_find(filename) != NULL)
+        return true;
+
     FILE *fstream;
 
     fstream = fopen(filename, "r");
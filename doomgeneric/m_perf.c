@@ -0,0 +1,308 @@
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	Time spent in each phase of a frame, read from the CLINT
+//	 mtime counter (10 MHz), with the cycles and instructions
+//	 retired by the hart that ran it (mcycle, minstret).
+//
+
+
+#include <stdio.h>
+#include <string.h>
+
+#include "m_argv.h"
+#include "m_perf.h"
+#include "i_system.h"
+#include "rtc.h"
+
+#define PERF_TICKS_PER_US	10
+
+// Runs of each phase kept for the rolling statistics.
+#define PERF_WINDOW		128
+
+// The statistics are refreshed once per second, and printed
+//  every 10 seconds with -perf.
+#define PERF_STATS_TICKS	(1000 * 1000 * PERF_TICKS_PER_US)
+#define PERF_PRINT_TICKS	(10 * PERF_STATS_TICKS)
+
+typedef struct
+{
+    uint32_t	time[PERF_WINDOW];
+    uint32_t	cycles[PERF_WINDOW];
+    uint32_t	instret[PERF_WINDOW];
+    uint64_t	next;		// runs recorded, slot is next % PERF_WINDOW
+
+} perfwindow_t;
+
+static perfcounter_t	perfcounters[NUMPERFPHASES];
+
+static char*		perfnames[NUMPERFPHASES] =
+{
+    "frame",
+    "tic",
+    "ticker",
+    "render",
+    "bsp",
+    "planes",
+    "masked",
+    "statusbar",
+    "hud",
+    "finishupdate",
+    "present",
+    "drawframe",
+    "sleep",
+};
+
+#ifdef PERF_PHASES
+
+static perfwindow_t	perfwindows[NUMPERFPHASES];
+static perfstats_t	perfstats[NUMPERFPHASES];
+
+static boolean		perfprint;
+static uint64_t		perfstatstime;
+static uint64_t		perfprinttime;
+
+
+#ifdef DG_NATIVE
+
+// Machine mode counters are not readable from user space: run the
+//  native build under perf stat for cycles and instructions.
+static inline uint64_t M_ReadCycles (void)
+{
+    return 0;
+}
+
+static inline uint64_t M_ReadInstret (void)
+{
+    return 0;
+}
+
+#else
+
+static inline uint64_t M_ReadCycles (void)
+{
+    uint64_t	x;
+
+    asm volatile ("csrr %0, mcycle" : "=r" (x));
+    return x;
+}
+
+static inline uint64_t M_ReadInstret (void)
+{
+    uint64_t	x;
+
+    asm volatile ("csrr %0, minstret" : "=r" (x));
+    return x;
+}
+
+#endif
+
+void M_PerfStart (perfstamp_t* stamp)
+{
+    stamp->time = kmtime ();
+    stamp->cycles = M_ReadCycles ();
+    stamp->instret = M_ReadInstret ();
+}
+
+void M_PerfLap (perfstamp_t* stamp)
+{
+    stamp->instret = M_ReadInstret () - stamp->instret;
+    stamp->cycles = M_ReadCycles () - stamp->cycles;
+    stamp->time = kmtime () - stamp->time;
+}
+
+void M_PerfRecord (perfphase_t phase, perfstamp_t* run)
+{
+    perfcounter_t*	counter;
+    perfwindow_t*	window;
+    int			slot;
+
+    // The view rendered in the background stops its phases on
+    //  another hart than the game loop.
+
+    counter = &perfcounters[phase];
+    __atomic_fetch_add (&counter->count, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add (&counter->time, run->time, __ATOMIC_RELAXED);
+    __atomic_fetch_add (&counter->cycles, run->cycles, __ATOMIC_RELAXED);
+    __atomic_fetch_add (&counter->instret, run->instret, __ATOMIC_RELAXED);
+
+    window = &perfwindows[phase];
+    slot = __atomic_fetch_add (&window->next, 1, __ATOMIC_RELAXED)
+	 % PERF_WINDOW;
+    window->time[slot] = run->time;
+    window->cycles[slot] = run->cycles;
+    window->instret[slot] = run->instret;
+}
+
+void M_PerfStop (perfphase_t phase, perfstamp_t* stamp)
+{
+    M_PerfLap (stamp);
+    M_PerfRecord (phase, stamp);
+}
+
+//
+// M_PerfUpdateStats
+// Min, average and 99th percentile of the runs in the window.
+//
+static void M_PerfUpdateStats (perfphase_t phase)
+{
+    perfwindow_t*	window;
+    perfstats_t*	stats;
+    uint32_t		sorted[PERF_WINDOW];
+    uint64_t		time;
+    uint64_t		cycles;
+    uint64_t		instret;
+    uint32_t		t;
+    int			samples;
+    int			i;
+    int			j;
+
+    window = &perfwindows[phase];
+    stats = &perfstats[phase];
+
+    samples = window->next < PERF_WINDOW ? window->next : PERF_WINDOW;
+    stats->samples = samples;
+
+    if (samples == 0)
+	return;
+
+    time = cycles = instret = 0;
+
+    // Insertion sort: the window is small and mostly in order.
+
+    for (i = 0; i < samples; i++)
+    {
+	t = window->time[i];
+	time += t;
+	cycles += window->cycles[i];
+	instret += window->instret[i];
+
+	for (j = i; j > 0 && sorted[j - 1] > t; j--)
+	    sorted[j] = sorted[j - 1];
+	sorted[j] = t;
+    }
+
+    stats->min_us = sorted[0] / PERF_TICKS_PER_US;
+    stats->avg_us = time / samples / PERF_TICKS_PER_US;
+    stats->p99_us = sorted[samples * 99 / 100] / PERF_TICKS_PER_US;
+    stats->avg_cycles = cycles / samples;
+    stats->avg_instret = instret / samples;
+}
+
+static void M_PerfPrint (void)
+{
+    perfstats_t*	stats;
+    int			i;
+
+    for (i = 0; i < NUMPERFPHASES; i++)
+    {
+	stats = &perfstats[i];
+
+	if (stats->samples == 0)
+	    continue;
+
+	printf ("perf: phase=%s samples=%d min_us=%d avg_us=%d p99_us=%d "
+		"avg_cycles=%d avg_instret=%d\n",
+		perfnames[i], stats->samples, stats->min_us, stats->avg_us,
+		stats->p99_us, stats->avg_cycles, stats->avg_instret);
+    }
+}
+
+static void M_PerfAtExit (void)
+{
+    int		i;
+
+    for (i = 0; i < NUMPERFPHASES; i++)
+	M_PerfUpdateStats (i);
+
+    M_PerfPrint ();
+}
+
+void M_PerfInit (void)
+{
+    //!
+    // @category obscure
+    //
+    // Print the minimum, average and 99th percentile time of each
+    // phase of a frame, with the cycles and instructions it takes,
+    // every 10 seconds and at exit.
+    //
+
+    perfprint = M_CheckParm ("-perf") > 0;
+
+    if (perfprint)
+	I_AtExit (M_PerfAtExit, true);
+
+    perfstatstime = perfprinttime = kmtime ();
+}
+
+void M_PerfFrame (void)
+{
+    uint64_t	now;
+    int		i;
+
+    now = kmtime ();
+
+    if (now - perfstatstime < PERF_STATS_TICKS)
+	return;
+
+    perfstatstime = now;
+
+    for (i = 0; i < NUMPERFPHASES; i++)
+	M_PerfUpdateStats (i);
+
+    if (perfprint && now - perfprinttime >= PERF_PRINT_TICKS)
+    {
+	perfprinttime = now;
+	M_PerfPrint ();
+    }
+}
+
+boolean M_PerfStats (perfphase_t phase, perfstats_t* stats)
+{
+    *stats = perfstats[phase];
+
+    return stats->samples > 0;
+}
+
+#else
+
+boolean M_PerfStats (perfphase_t phase, perfstats_t* stats)
+{
+    return false;
+}
+
+#endif
+
+void M_PerfRead (perfcounter_t* counters)
+{
+    memcpy (counters, perfcounters, sizeof(perfcounters));
+}
+
+int M_PerfAverageUS (perfcounter_t* start, perfcounter_t* end,
+		     perfphase_t phase)
+{
+    uint64_t	count;
+
+    count = end[phase].count - start[phase].count;
+
+    if (count == 0)
+	return 0;
+
+    return (int) ((end[phase].time - start[phase].time)
+		  / count / PERF_TICKS_PER_US);
+}
+
+char* M_PerfPhaseName (perfphase_t phase)
+{
+    return perfnames[phase];
+}
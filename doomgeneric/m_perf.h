@@ -0,0 +1,117 @@
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	Time, cycles and instructions spent in each phase of a frame.
+//	Built only with PERF_PHASES defined: otherwise the
+//	 instrumentation points compile to nothing.
+//
+
+
+#ifndef __M_PERF__
+#define __M_PERF__
+
+#include "doomtype.h"
+
+
+typedef enum
+{
+    perf_frame,		// one pass of the game loop
+    perf_tic,		// running the game tics (TryRunTics)
+    perf_ticker,	// play simulation (P_Ticker)
+    perf_render,	// player view (R_RenderPlayerView)
+    perf_bsp,		// walls, BSP traversal (R_RenderBSPNode)
+    perf_planes,	// floors and ceilings (R_DrawPlanes)
+    perf_masked,	// sprites and masked walls (R_DrawMasked)
+    perf_statusbar,	// ST_Drawer
+    perf_hud,		// HU_Drawer
+    perf_finishupdate,	// I_FinishUpdate
+    perf_present,	// palette expansion and page flip
+    perf_drawframe,	// DG_DrawFrame
+    perf_sleep,		// DG_SleepMs
+    NUMPERFPHASES
+
+} perfphase_t;
+
+// Counters at the start of a phase, or spent in one run of it
+//  (M_PerfLap).
+typedef struct
+{
+    uint64_t	time;		// mtime
+    uint64_t	cycles;
+    uint64_t	instret;
+
+} perfstamp_t;
+
+// Totals of a phase since startup.
+typedef struct
+{
+    uint64_t	count;		// number of times the phase ran
+    uint64_t	time;		// in timer ticks
+    uint64_t	cycles;
+    uint64_t	instret;
+
+} perfcounter_t;
+
+// Rolling statistics over the last runs of a phase.
+typedef struct
+{
+    int		samples;
+    int		min_us;
+    int		avg_us;
+    int		p99_us;
+    int		avg_cycles;
+    int		avg_instret;
+
+} perfstats_t;
+
+#ifdef PERF_PHASES
+
+// A phase may run on any hart: every stop is one sample.
+void M_PerfStart (perfstamp_t* stamp);
+void M_PerfStop (perfphase_t phase, perfstamp_t* stamp);
+
+// For a phase run in parts at once (view strips): M_PerfLap turns
+//  the stamp of each part into what it spent, and the caller records
+//  the one sample of the phase with M_PerfRecord.
+void M_PerfLap (perfstamp_t* stamp);
+void M_PerfRecord (perfphase_t phase, perfstamp_t* run);
+
+// Reads -perf.
+void M_PerfInit (void);
+
+// At the end of every frame: updates the statistics.
+void M_PerfFrame (void);
+
+#else
+
+#define M_PerfStart(stamp)		((void) (stamp))
+#define M_PerfStop(phase, stamp)	((void) (stamp))
+#define M_PerfLap(stamp)		((void) (stamp))
+#define M_PerfRecord(phase, run)	((void) (run))
+#define M_PerfInit()
+#define M_PerfFrame()
+
+#endif
+
+// Copies the counters of all phases.
+void M_PerfRead (perfcounter_t* counters);
+
+// Average duration of a phase between two readings, in microseconds.
+int M_PerfAverageUS (perfcounter_t* start, perfcounter_t* end,
+		     perfphase_t phase);
+
+// Statistics of the last 128 runs of a phase; false if it did not run.
+boolean M_PerfStats (perfphase_t phase, perfstats_t* stats);
+
+char* M_PerfPhaseName (perfphase_t phase);
+
+#endif
@@ -0,0 +1,6 @@
+#ifndef MEMBENCH
+#define MEMBENCH
+
+void membench();
+
+#endif
@@ -0,0 +1,676 @@
+/*
+ * Stand-ins of the QEMU virt devices for the native build (make native).
+ *
+ * The engine, doomgeneric_virt.c, fb.c, uart_serial.c and the project libc
+ * run as a static Linux user-space program (x86-64 or riscv64), so that they
+ * can be profiled with perf, valgrind or the undefined behaviour sanitizer.
+ * The devices below them are emulated on top of raw system calls:
+ *
+ * - syscon: exit status of the process
+ * - CLINT: monotonic clock (10 MHz mtime), sleeps, single hart
+ * - PLIC: UART handler only, run when its interrupt is raised
+ * - UART: transmit register written to stdout
+ * - fw_cfg: host files (any path), "etc/ramfb" is the emulated display
+ * - ramfb: scanout buffer written to a PPM file on request
+ * - virtio keyboard: events replayed from a script (-keyscript)
+ *
+ * The profiler and the memory benchmark are not available: use perf.
+ */
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "syscon.h"
+#include "rtc.h"
+#include "virt_clint.h"
+#include "plic.h"
+#include "smp.h"
+#include "qemu_dma.h"
+#include "fb.h"
+#include "virtio_keyboard.h"
+#include "uart_serial.h"
+#include "membench.h"
+#include "prof.h"
+#include "m_argv.h"
+#include "i_system.h"
+
+//
+// System calls
+//
+
+#if defined(__x86_64__)
+
+#define SYS_read            0
+#define SYS_write           1
+#define SYS_close           3
+#define SYS_lseek           8
+#define SYS_pread64         17
+#define SYS_nanosleep       35
+#define SYS_clock_gettime   228
+#define SYS_clock_nanosleep 230
+#define SYS_exit_group      231
+#define SYS_openat          257
+
+static long native_syscall(long n, long a0, long a1, long a2, long a3) {
+    register long r10 asm("r10") = a3;
+    long ret;
+    asm volatile("syscall"
+                 : "=a"(ret)
+                 : "a"(n), "D"(a0), "S"(a1), "d"(a2), "r"(r10)
+                 : "rcx", "r11", "memory");
+    return ret;
+}
+
+// process entry: argc, then argv on the stack
+asm(".globl _start\n"
+    "_start:\n"
+    "    xor %rbp, %rbp\n"
+    "    mov (%rsp), %rdi\n"
+    "    lea 8(%rsp), %rsi\n"
+    "    and $-16, %rsp\n"
+    "    call native_start\n"
+    "    hlt\n");
+
+#elif defined(__riscv)
+
+#define SYS_openat          56
+#define SYS_close           57
+#define SYS_lseek           62
+#define SYS_read            63
+#define SYS_write           64
+#define SYS_pread64         67
+#define SYS_exit_group      94
+#define SYS_nanosleep       101
+#define SYS_clock_gettime   113
+#define SYS_clock_nanosleep 115
+
+static long native_syscall(long n, long a0, long a1, long a2, long a3) {
+    register long r_a7 asm("a7") = n;
+    register long r_a0 asm("a0") = a0;
+    register long r_a1 asm("a1") = a1;
+    register long r_a2 asm("a2") = a2;
+    register long r_a3 asm("a3") = a3;
+    asm volatile("ecall"
+                 : "+r"(r_a0)
+                 : "r"(r_a7), "r"(r_a1), "r"(r_a2), "r"(r_a3)
+                 : "memory");
+    return r_a0;
+}
+
+// process entry: argc, then argv on the stack (gp for linker relaxation)
+asm(".globl _start\n"
+    "_start:\n"
+    "    .option push\n"
+    "    .option norelax\n"
+    "    lla gp, __global_pointer$\n"
+    "    .option pop\n"
+    "    ld a0, 0(sp)\n"
+    "    addi a1, sp, 8\n"
+    "    andi sp, sp, -16\n"
+    "    call native_start\n"
+    "1:  j 1b\n");
+
+#else
+#error "native build: x86-64 or riscv64 Linux only"
+#endif
+
+#define AT_FDCWD            -100
+#define O_RDONLY            0
+#define O_WRONLY            01
+#define O_CREAT             0100
+#define O_TRUNC             01000
+#define SEEK_END            2
+#define CLOCK_MONOTONIC     1
+#define TIMER_ABSTIME       1
+
+struct native_timespec {
+    long tv_sec;
+    long tv_nsec;
+};
+
+int main(int argc, char **argv);
+
+void native_start(long argc, char **argv) {
+    exit(main(argc, argv));
+}
+
+static int native_open(const char *path, int flags) {
+    return native_syscall(SYS_openat, AT_FDCWD, (long) path, flags, 0644);
+}
+
+static void native_write_all(int fd, const char *buf, size_t len) {
+    while (len > 0) {
+        long n = native_syscall(SYS_write, fd, (long) buf, len, 0);
+        if (n <= 0)
+            return;
+        buf += n;
+        len -= n;
+    }
+}
+
+//
+// UART: transmit register to stdout (uart_serial.c reads and writes the
+// registers through native_uart_read() and native_uart_write())
+//
+
+#define UART_THR        0x00
+#define UART_IER        0x01
+#define UART_IIR        0x02
+#define UART_LSR        0x05
+
+#define UART_LSR_THRE   0x20
+#define UART_IER_THRI   0x02
+
+static char uart_out[4096];
+static size_t uart_out_len;
+static uint8_t uart_ier;
+static plic_handler_t uart_handler;
+static void *uart_handler_arg;
+static int uart_in_irq;
+
+static void native_uart_flush(void) {
+    native_write_all(1, uart_out, uart_out_len);
+    uart_out_len = 0;
+}
+
+uint8_t native_uart_read(uint64_t addr) {
+    switch (addr & 0x7) {
+    case UART_LSR:
+        return UART_LSR_THRE;   // always ready to send, never data to read
+    case UART_IER:
+        return uart_ier;
+    default:
+        return 0;
+    }
+}
+
+void native_uart_write(uint64_t addr, uint8_t value) {
+    switch (addr & 0x7) {
+    case UART_THR:
+        uart_out[uart_out_len++] = value;
+        if (value == '\n' || uart_out_len == sizeof(uart_out))
+            native_uart_flush();
+        break;
+    case UART_IER:
+        uart_ier = value;
+        // THR is always empty: the interrupt is raised until the handler masks it
+        if (uart_handler != NULL && !uart_in_irq) {
+            uart_in_irq = 1;
+            while (uart_ier & UART_IER_THRI)
+                uart_handler(uart_handler_arg);
+            uart_in_irq = 0;
+        }
+        break;
+    }
+}
+
+//
+// syscon
+//
+
+void poweroff(void) {
+    poweroff_exit(0);
+}
+
+void poweroff_exit(int status) {
+    kconsole_flush();
+    native_uart_flush();
+    native_syscall(SYS_exit_group, status, 0, 0, 0);
+}
+
+void reboot(void) {
+    poweroff_exit(0);
+}
+
+//
+// CLINT: mtime at 10 MHz from the monotonic clock, a single hart
+//
+
+uint64_t kmtime() {
+    struct native_timespec ts;
+
+    native_syscall(SYS_clock_gettime, CLOCK_MONOTONIC, (long) &ts, 0, 0);
+    return (uint64_t) ts.tv_sec * 10000000 + ts.tv_nsec / 100;
+}
+
+void kusleep(uint64_t useconds) {
+    struct native_timespec ts = {
+        .tv_sec = useconds / 1000000,
+        .tv_nsec = (useconds % 1000000) * 1000,
+    };
+    native_syscall(SYS_nanosleep, (long) &ts, 0, 0, 0);
+}
+
+uint64_t read_mhartid() {
+    return 0;
+}
+
+int init_interrupts() {
+    return 0;
+}
+
+// sleep statistics, as printed by the kernel
+static struct {
+    uint64_t start;
+    uint64_t sleeps;
+    uint64_t late_total;
+    uint64_t late_max;
+} sleep_stats;
+
+void sleep_until(uint64_t deadline) {
+    struct native_timespec ts = {
+        .tv_sec = deadline / 10000000,
+        .tv_nsec = (deadline % 10000000) * 100,
+    };
+
+    if (sleep_stats.start == 0)
+        sleep_stats.start = kmtime();
+    if (kmtime() >= deadline)
+        return;
+    native_syscall(SYS_clock_nanosleep, CLOCK_MONOTONIC, TIMER_ABSTIME, (long) &ts, 0);
+
+    uint64_t late = kmtime() - deadline;
+    sleep_stats.sleeps++;
+    sleep_stats.late_total += late;
+    if (late > sleep_stats.late_max)
+        sleep_stats.late_max = late;
+}
+
+void sleep_us(uint64_t us) {
+    sleep_until(kmtime() + us * 10);
+}
+
+void clint_print_stats(void) {
+    uint64_t seconds = (kmtime() - sleep_stats.start) / 10000000;
+    uint64_t avg = sleep_stats.sleeps ? sleep_stats.late_total / sleep_stats.sleeps : 0;
+
+    printf("clint: native, sleeps [%d] ([%d] per second), wakeup delay avg [%d]us max [%d]us\n",
+           sleep_stats.sleeps, seconds ? sleep_stats.sleeps / seconds : sleep_stats.sleeps,
+           avg / 10, sleep_stats.late_max / 10);
+}
+
+void set_profile_timer(uint64_t period) {
+}
+
+//
+// PLIC: only the UART interrupt is emulated
+//
+
+void plic_init() {
+}
+
+int plic_register(uint32_t irq, plic_handler_t handler, void *arg, int flags) {
+    if (irq != PLIC_IRQ_UART)
+        return -1;
+    uart_handler = handler;
+    uart_handler_arg = arg;
+    return 0;
+}
+
+int plic_dispatch() {
+    return 0;
+}
+
+//
+// Job system: jobs run on the calling thread
+//
+
+void spin_lock(spinlock_t *lock) {
+    lock->locked = 1;
+}
+
+void spin_unlock(spinlock_t *lock) {
+    lock->locked = 0;
+}
+
+void smp_tls_setup(uint64_t hartid) {
+}
+
+int smp_init() {
+    kprintf("smp_init(): native build, using [1] hart\n");
+    return 1;
+}
+
+int smp_num_harts() {
+    return 1;
+}
+
+void smp_set_active_harts(int num_harts) {
+}
+
+void smp_parallel_for(smp_job_func_t func, void *arg, int count) {
+    for (int i = 0; i < count; i++)
+        func(arg, i);
+}
+
+void smp_submit(smp_task_t *task, smp_job_func_t func, void *arg) {
+    uint64_t start = kmtime();
+
+    func(arg, 0);
+    task->busy += kmtime() - start;
+    task->pending = 0;
+}
+
+void smp_wait(smp_task_t *task) {
+}
+
+int smp_selftest() {
+    kprintf("smp_selftest(): not available in the native build\n");
+    return 0;
+}
+
+void smp_bench() {
+}
+
+//
+// fw_cfg: files are host files, named by their path
+//
+
+#define NATIVE_RAMFB_SELECT     0x100
+#define NATIVE_PATH_MAX         256
+
+typedef struct {
+    fw_cfg_file_t entry;
+    int fd;
+    char path[NATIVE_PATH_MAX];
+} native_file_t;
+
+static native_file_t native_files[FW_CFG_MAX_FILES];
+static int native_num_files;
+
+int check_fw_cfg_dma() {
+    return 1;
+}
+
+int fw_cfg_file_count(void) {
+    return native_num_files;
+}
+
+const fw_cfg_file_t *fw_cfg_file_entry(int index) {
+    if (index < 0 || index >= native_num_files)
+        return NULL;
+    return &native_files[index].entry;
+}
+
+/**
+ * @brief Opens a host file the first time it is looked up.
+ */
+const fw_cfg_file_t *fw_cfg_find(const char *name) {
+    native_file_t *file;
+    long size;
+    int fd;
+
+    for (int i = 0; i < native_num_files; i++) {
+        if (strcmp(native_files[i].path, name) == 0)
+            return &native_files[i].entry;
+    }
+    if (native_num_files == FW_CFG_MAX_FILES || strlen(name) >= NATIVE_PATH_MAX)
+        return NULL;
+
+    fd = native_open(name, O_RDONLY);
+    if (fd < 0)
+        return NULL;
+    size = native_syscall(SYS_lseek, fd, 0, SEEK_END, 0);
+    if (size < 0) {
+        native_syscall(SYS_close, fd, 0, 0, 0);
+        return NULL;
+    }
+
+    file = &native_files[native_num_files++];
+    file->fd = fd;
+    strncpy(file->path, name, NATIVE_PATH_MAX);
+    strncpy(file->entry.name, name, sizeof(file->entry.name) - 1);
+    file->entry.size = size;
+    file->entry.select = native_num_files;
+    return &file->entry;
+}
+
+uint32_t fw_cfg_read_file(const fw_cfg_file_t *file, uint32_t offset, void *buf, uint32_t len) {
+    native_file_t *f = (native_file_t *) file;
+    uint32_t done = 0;
+
+    while (done < len) {
+        long n = native_syscall(SYS_pread64, f->fd, (long) buf + done, len - done, offset + done);
+        if (n <= 0)
+            break;
+        done += n;
+    }
+    return done;
+}
+
+void fw_cfg_list_files(void) {
+    for (int i = 0; i < native_num_files; i++)
+        kprintf("fw_cfg: %u bytes, %s\n", native_files[i].entry.size, native_files[i].path);
+}
+
+//
+// ramfb: the registered scanout buffer, written to a PPM file on request
+//
+
+static struct QemuRAMFBCfg ramfb_cfg;   // host byte order
+static uint32_t ramfb_flips;            // registrations: frames shown
+
+int qemu_cfg_find_file() {
+    return NATIVE_RAMFB_SELECT;
+}
+
+void qemu_cfg_write_entry(void *buf, uint32_t e, uint32_t len) {
+    struct QemuRAMFBCfg *cfg = buf;
+
+    if (e != NATIVE_RAMFB_SELECT || len != sizeof(*cfg))
+        return;
+    ramfb_cfg.addr = __builtin_bswap64(cfg->addr);
+    ramfb_cfg.fourcc = __builtin_bswap32(cfg->fourcc);
+    ramfb_cfg.width = __builtin_bswap32(cfg->width);
+    ramfb_cfg.height = __builtin_bswap32(cfg->height);
+    ramfb_cfg.stride = __builtin_bswap32(cfg->stride);
+    ramfb_flips++;
+}
+
+/**
+ * @brief Writes the displayed buffer (XRGB8888) as a binary PPM image.
+ */
+static void native_write_ppm(const char *path) {
+    char line[64];
+    int fd = native_open(path, O_WRONLY | O_CREAT | O_TRUNC);
+
+    if (fd < 0 || ramfb_cfg.addr == 0) {
+        kprintf("native: cannot write %s\n", path);
+        return;
+    }
+
+    int len = snprintf(line, sizeof(line), "P6\n%u %u\n255\n", ramfb_cfg.width, ramfb_cfg.height);
+    native_write_all(fd, line, len);
+
+    uint8_t *rgb = malloc(ramfb_cfg.width * 3);
+    for (uint32_t y = 0; y < ramfb_cfg.height; y++) {
+        uint32_t *pixel = (uint32_t *) (ramfb_cfg.addr + y * ramfb_cfg.stride);
+        for (uint32_t x = 0; x < ramfb_cfg.width; x++) {
+            rgb[3 * x] = pixel[x] >> 16;
+            rgb[3 * x + 1] = pixel[x] >> 8;
+            rgb[3 * x + 2] = pixel[x];
+        }
+        native_write_all(fd, (char *) rgb, ramfb_cfg.width * 3);
+    }
+    free(rgb);
+    native_syscall(SYS_close, fd, 0, 0, 0);
+    kprintf("native: frame [%u] written to %s\n", ramfb_flips, path);
+}
+
+//
+// virtio keyboard: scripted events
+//
+// One event per line, at a frame number (ramfb flips since the start):
+//   <frame> down <AT scan code>
+//   <frame> up <AT scan code>
+//   <frame> ppm <file>     write the displayed frame
+//   <frame> quit           exit with status 0
+// Lines starting with '#' are comments.
+//
+
+enum {
+    SCRIPT_KEY,
+    SCRIPT_PPM,
+    SCRIPT_QUIT,
+};
+
+typedef struct {
+    uint32_t frame;
+    int action;
+    struct virtio_input_event event;
+    char *path;
+} script_event_t;
+
+static script_event_t *script;
+static int script_len;
+static int script_next;
+static uint64_t script_keys;
+
+static char *script_token(char **s) {
+    char *token;
+
+    while (**s == ' ' || **s == '\t')
+        (*s)++;
+    token = *s;
+    while (**s != 0 && **s != ' ' && **s != '\t')
+        (*s)++;
+    if (**s != 0)
+        *(*s)++ = 0;
+    return token;
+}
+
+static uint32_t script_number(const char *s) {
+    uint32_t n = 0;
+    int base = 10;
+
+    if (s[0] == '0' && (s[1] == 'x' || s[1] == 'X')) {
+        base = 16;
+        s += 2;
+    }
+    for (; *s; s++) {
+        int digit = *s >= 'a' ? *s - 'a' + 10 : *s >= 'A' ? *s - 'A' + 10 : *s - '0';
+        if (digit < 0 || digit >= base)
+            break;
+        n = n * base + digit;
+    }
+    return n;
+}
+
+static void script_load(const char *path) {
+    const fw_cfg_file_t *file = fw_cfg_find(path);
+    char *text, *line, *next;
+
+    if (file == NULL) {
+        kprintf("native: key script %s not found\n", path);
+        return;
+    }
+    text = malloc(file->size + 1);
+    fw_cfg_read_file(file, 0, text, file->size);
+    text[file->size] = 0;
+
+    // at most one event per line
+    script = calloc(file->size / 2 + 1, sizeof(script_event_t));
+
+    for (line = text; *line; line = next) {
+        next = strchr(line, '\n');
+        if (next != NULL)
+            *next++ = 0;
+        else
+            next = line + strlen(line);
+        if (strchr(line, '\r'))
+            *strchr(line, '\r') = 0;
+
+        char *frame = script_token(&line);
+        char *action = script_token(&line);
+        char *arg = script_token(&line);
+        script_event_t *e = &script[script_len];
+
+        if (*frame == 0 || *frame == '#')
+            continue;
+        e->frame = script_number(frame);
+        if (strcmp(action, "down") == 0 || strcmp(action, "up") == 0) {
+            e->action = SCRIPT_KEY;
+            e->event.type = VirtioInputEvKey;
+            e->event.code = script_number(arg);
+            e->event.value = strcmp(action, "down") == 0;
+        } else if (strcmp(action, "ppm") == 0) {
+            e->action = SCRIPT_PPM;
+            e->path = arg;
+        } else if (strcmp(action, "quit") == 0) {
+            e->action = SCRIPT_QUIT;
+        } else {
+            kprintf("native: %s: unknown action [%s]\n", path, action);
+            continue;
+        }
+        script_len++;
+    }
+    kprintf("native: %d scripted events from %s\n", script_len, path);
+}
+
+int virtio_keyboard_init(void) {
+    //!
+    // @arg <file>
+    //
+    // Native build: replay the keyboard events, screenshots (PPM) and exit
+    // of a script, at given frame numbers (see native.c).
+    //
+    int p = M_CheckParmWithArgs("-keyscript", 1);
+    if (p > 0)
+        script_load(myargv[p + 1]);
+    return 0;
+}
+
+int virtio_keyboard_enable_irq(void) {
+    return 0;
+}
+
+void virtio_keyboard_print_stats(void) {
+    kprintf("virtio_keyboard: native, scripted key events [%d]\n", script_keys);
+}
+
+struct virtio_input_event virtio_keyboard_read_event(void) {
+    struct virtio_input_event nokey = {.type = VirtioInputEvNone};
+
+    while (script_next < script_len && script[script_next].frame <= ramfb_flips) {
+        script_event_t *e = &script[script_next++];
+
+        switch (e->action) {
+        case SCRIPT_KEY:
+            script_keys++;
+            return e->event;
+        case SCRIPT_PPM:
+            native_write_ppm(e->path);
+            break;
+        case SCRIPT_QUIT:
+            I_Quit();
+        }
+    }
+    return nokey;
+}
+
+//
+// Not available natively
+//
+
+void membench() {
+    kprintf("membench(): not available in the native build\n");
+}
+
+int prof_init(uint32_t rate, uint32_t max_samples) {
+    kprintf("prof_init(): not available in the native build, use perf record\n");
+    return -1;
+}
+
+void prof_start() {
+}
+
+void prof_stop() {
+}
+
+void prof_sample(uint64_t pc, uint64_t fp) {
+}
+
+void prof_dump() {
+}
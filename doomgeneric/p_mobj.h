@@ -276,6 +276,13 @@ typedef struct mobj_s
 
     // Thing being chased/attacked for tracers.
     struct mobj_s*	tracer;	
+
+    // Position before the last tic: the view drawn between
+    //  tics is interpolated from it (-uncapped).
+    fixed_t		oldx;
+    fixed_t		oldy;
+    fixed_t		oldz;
+    angle_t		oldangle;
     
 } mobj_t;
 
@@ -22,6 +22,7 @@
 #include "p_local.h"
 
 #include "doomstat.h"
+#include "d_golden.h"
 
 
 int	leveltime;
@@ -116,6 +117,48 @@ void P_RunThinkers (void)
 
 
 
+//
+// P_StoreOldPositions
+// Positions before the tic, from which the view drawn
+//  between tics is interpolated (-uncapped).
+//
+
+int	oldpositionstic = -1;
+
+static void P_StoreOldPositions (void)
+{
+    thinker_t*	th;
+    mobj_t*	mo;
+    sector_t*	sec;
+    int		i;
+
+    for (th = thinkercap.next; th != &thinkercap; th = th->next)
+    {
+	if (th->function.acp1 != (actionf_p1) P_MobjThinker)
+	    continue;
+
+	mo = (mobj_t *) th;
+	mo->oldx = mo->x;
+	mo->oldy = mo->y;
+	mo->oldz = mo->z;
+	mo->oldangle = mo->angle;
+    }
+
+    for (i = 0, sec = sectors; i < numsectors; i++, sec++)
+    {
+	sec->oldfloorheight = sec->floorheight;
+	sec->oldceilingheight = sec->ceilingheight;
+    }
+
+    for (i = 0; i < MAXPLAYERS; i++)
+	if (playeringame[i])
+	    players[i].oldviewz = players[i].viewz;
+
+    oldpositionstic = gametic;
+}
+
+
+
 //
 // P_Ticker
 //
@@ -136,7 +179,8 @@ void P_Ticker (void)
     {
 	return;
     }
-    
+
+    P_StoreOldPositions ();
 		
     for (i=0 ; i<MAXPLAYERS ; i++)
 	if (playeringame[i])
@@ -148,4 +192,6 @@ void P_Ticker (void)
 
     // for par times
     leveltime++;	
+
+    D_GoldenTic ();
 }
@@ -28,6 +28,10 @@
 // Carries out all thinking of monsters and players.
 void P_Ticker (void);
 
+// gametic of the last P_Ticker that ran the play simulation:
+//  the old positions are those before it.
+extern int oldpositionstic;
+
 
 
 #endif
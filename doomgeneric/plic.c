@@ -0,0 +1,92 @@
+/*
+ * PLIC (Platform-Level Interrupt Controller) driver for QEMU virt.
+ *
+ * Device interrupts are routed to hart 0 machine mode (PLIC context 0) only:
+ * the trap handler (virt_clint.c) calls plic_dispatch() on machine external
+ * interrupts, which claims the pending sources and runs their handlers.
+ *
+ * See https://github.com/riscv/riscv-plic-spec/blob/master/riscv-plic.adoc
+ */
+#include <stdint.h>
+#include <stddef.h>
+#include "uart_serial.h"
+#include "plic.h"
+
+// base address of the PLIC (see Device Tree)
+#define PLIC_BASE           0x0c000000UL
+#define PLIC_PRIORITY(irq)  ((volatile uint32_t *)(PLIC_BASE + 4 * (irq)))
+#define PLIC_ENABLE(ctx)    ((volatile uint32_t *)(PLIC_BASE + 0x2000 + 0x80 * (ctx)))
+#define PLIC_THRESHOLD(ctx) ((volatile uint32_t *)(PLIC_BASE + 0x200000 + 0x1000 * (ctx)))
+#define PLIC_CLAIM(ctx)     ((volatile uint32_t *)(PLIC_BASE + 0x200004 + 0x1000 * (ctx)))
+
+// QEMU virt: context 2 * hart is machine mode, 2 * hart + 1 supervisor mode
+#define PLIC_CONTEXT_HART0_M    0
+
+#define MIE_MEIE        (1 << 11)   // Machine-mode External Interrupt Enable Flag
+#define MSTATUS_MIE     (1 << 3)    // Machine-mode Interrupt Enable Flag
+
+typedef struct {
+    plic_handler_t handler;
+    void *arg;
+    int flags;
+} plic_source_t;
+
+static plic_source_t sources[PLIC_MAX_IRQ];
+
+/**
+ * @brief Masks all sources then enables machine external interrupts on hart 0.
+ */
+void plic_init() {
+    for (int irq = 1; irq < PLIC_MAX_IRQ; irq++)
+        *PLIC_PRIORITY(irq) = 0;
+    for (int w = 0; w < PLIC_MAX_IRQ / 32; w++)
+        PLIC_ENABLE(PLIC_CONTEXT_HART0_M)[w] = 0;
+
+    // any source with a priority above 0 interrupts
+    *PLIC_THRESHOLD(PLIC_CONTEXT_HART0_M) = 0;
+
+    asm volatile("csrs mie, %0" :: "r"(MIE_MEIE));
+    asm volatile("csrs mstatus, %0" :: "r"(MSTATUS_MIE));
+    kprintf("plic_init(): external interrupts enabled on hart 0\n");
+}
+
+/**
+ * @brief Installs the handler of an interrupt source and unmasks it.
+ *
+ * @param flags PLIC_WAKE if the source wakes the game loop from 'wfi'
+ * @return 0 on success, -1 if irq is out of range
+ */
+int plic_register(uint32_t irq, plic_handler_t handler, void *arg, int flags) {
+    if (irq == 0 || irq >= PLIC_MAX_IRQ)
+        return -1;
+
+    sources[irq].handler = handler;
+    sources[irq].arg = arg;
+    sources[irq].flags = flags;
+
+    *PLIC_PRIORITY(irq) = 1;
+    PLIC_ENABLE(PLIC_CONTEXT_HART0_M)[irq / 32] |= 1U << (irq % 32);
+    return 0;
+}
+
+/**
+ * @brief Runs the handlers of all pending sources (called from the trap handler).
+ *
+ * @return 1 if one of them was registered with PLIC_WAKE, 0 otherwise
+ */
+int plic_dispatch() {
+    uint32_t irq;
+    int wake = 0;
+
+    // claim returns the highest priority pending source, 0 when none is left
+    while ((irq = *PLIC_CLAIM(PLIC_CONTEXT_HART0_M)) != 0) {
+        if (irq < PLIC_MAX_IRQ && sources[irq].handler) {
+            sources[irq].handler(sources[irq].arg);
+            if (sources[irq].flags & PLIC_WAKE)
+                wake = 1;
+        }
+        // completion re-arms the source
+        *PLIC_CLAIM(PLIC_CONTEXT_HART0_M) = irq;
+    }
+    return wake;
+}
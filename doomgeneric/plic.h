@@ -0,0 +1,23 @@
+#ifndef PLIC
+#define PLIC
+
+#include <stdint.h>
+
+// QEMU virt interrupt sources (see Device Tree)
+#define PLIC_IRQ_VIRTIO(n)  (1 + (n))   // virtio-mmio slot n (0..7)
+#define PLIC_IRQ_UART       10
+
+#define PLIC_MAX_IRQ        64
+
+// Interrupt handler: runs in trap context on hart 0 with interrupts disabled.
+// Vector registers are not saved: no libc memory functions (RVV) in there.
+typedef void (*plic_handler_t)(void *arg);
+
+// plic_register() flags
+#define PLIC_WAKE           1   // input source: ends sleep_until() early
+
+void plic_init();
+int plic_register(uint32_t irq, plic_handler_t handler, void *arg, int flags);
+int plic_dispatch();
+
+#endif
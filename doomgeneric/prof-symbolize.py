@@ -0,0 +1,137 @@
+#!/usr/bin/env python3
+#
+# Symbolize the sampling profile printed by the kernel (-profile, see prof.c)
+# into a flat profile or folded stacks for flamegraph.pl / speedscope.
+#
+#   $ bash qemu-run.sh -fw_cfg name=opt/doom/args,string="-profile 1000" | tee run.log
+#   $ python3 prof-symbolize.py run.log doomgeneric            # flat profile
+#   $ python3 prof-symbolize.py --folded run.log doomgeneric.map > doom.folded
+#   $ flamegraph.pl doom.folded > doom.svg
+#
+# Symbols are read from the ELF with nm ($NM, default riscv64-elf-nm) or from
+# the linker map file (doomgeneric.map), which lacks the static functions:
+# their samples go to the global function before them. When the log holds
+# several dumps the last one is used: each dump covers all the samples since
+# the start.
+
+import argparse
+import bisect
+import os
+import re
+import subprocess
+import sys
+
+
+def load_symbols_elf(path):
+    nm = os.environ.get("NM", "riscv64-elf-nm")
+    out = subprocess.run([nm, "-n", "--defined-only", path],
+                         check=True, capture_output=True, text=True).stdout
+    symbols = []
+    for line in out.splitlines():
+        fields = line.split()
+        if len(fields) == 3 and fields[1] in "tTwW":
+            symbols.append((int(fields[0], 16), fields[2]))
+    return symbols
+
+
+def load_symbols_map(path):
+    # symbol lines of the .text output section in the GNU ld map:
+    #                 0x0000000080001234                name
+    symbol = re.compile(r"^\s+0x([0-9a-f]+)\s+([A-Za-z_.$][\w.$]*)\s*$")
+    symbols = []
+    in_text = False
+    with open(path) as f:
+        for line in f:
+            if line.startswith("."):
+                in_text = line.startswith(".text")
+                continue
+            m = symbol.match(line)
+            if in_text and m:
+                symbols.append((int(m.group(1), 16), m.group(2)))
+    symbols.sort()
+    return symbols
+
+
+def load_dump(path):
+    dump = None
+    with open(path, errors="replace") as f:
+        for line in f:
+            line = line.strip()
+            if not line.startswith("prof: "):
+                continue
+            fields = line.split()[1:]
+            if fields[0] == "begin":
+                dump = []
+            elif fields[0] == "end":
+                pass
+            elif dump is not None:
+                dump.append((int(fields[0]), [int(pc, 16) for pc in fields[1:]]))
+    if dump is None:
+        sys.exit("%s: no profile found (run with -profile)" % path)
+    return dump
+
+
+class Symbolizer:
+    def __init__(self, symbols):
+        self.addrs = [addr for addr, _ in symbols]
+        self.names = [name for _, name in symbols]
+
+    def name(self, pc, return_address):
+        # a return address points past the call: look up the call itself
+        if return_address:
+            pc -= 1
+        i = bisect.bisect_right(self.addrs, pc) - 1
+        if i < 0:
+            return "0x%x" % pc
+        return self.names[i]
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description="Symbolize a -profile dump of the kernel.")
+    parser.add_argument("--folded", action="store_true",
+                        help="print folded stacks instead of the flat profile")
+    parser.add_argument("--top", type=int, default=40,
+                        help="functions in the flat profile (default 40)")
+    parser.add_argument("log", help="console output holding a prof: dump")
+    parser.add_argument("image", help="kernel ELF or linker map file")
+    args = parser.parse_args()
+
+    if args.image.endswith(".map"):
+        symbols = load_symbols_map(args.image)
+    else:
+        symbols = load_symbols_elf(args.image)
+    sym = Symbolizer(symbols)
+    dump = load_dump(args.log)
+
+    if args.folded:
+        folded = {}
+        for count, pcs in dump:
+            frames = [sym.name(pc, i > 0) for i, pc in enumerate(pcs)]
+            key = ";".join(reversed(frames))
+            folded[key] = folded.get(key, 0) + count
+        for key, count in sorted(folded.items()):
+            print("%s %d" % (key, count))
+        return
+
+    total = sum(count for count, _ in dump)
+    self_counts = {}
+    total_counts = {}
+    for count, pcs in dump:
+        frames = [sym.name(pc, i > 0) for i, pc in enumerate(pcs)]
+        self_counts[frames[0]] = self_counts.get(frames[0], 0) + count
+        # recursive functions count once per sample
+        for name in set(frames):
+            total_counts[name] = total_counts.get(name, 0) + count
+
+    print("%d samples" % total)
+    print("%7s %6s %7s %6s  %s" % ("self", "%", "total", "%", "function"))
+    ranked = sorted(total_counts, key=lambda n: (-self_counts.get(n, 0), -total_counts[n]))
+    for name in ranked[:args.top]:
+        s = self_counts.get(name, 0)
+        t = total_counts[name]
+        print("%7d %5.1f%% %7d %5.1f%%  %s" % (s, 100.0 * s / total, t, 100.0 * t / total, name))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,198 @@
+/*
+ * Statistical profiler.
+ *
+ * The CLINT timer interrupt of hart 0 (virt_clint.c) samples the interrupted
+ * pc (mepc) at a fixed rate, between sleep_us() wakeups. When the kernel is
+ * built with -fno-omit-frame-pointer the return addresses of the callers are
+ * walked from the frame pointer (s0) too. Samples are stored into a buffer
+ * allocated by prof_init(): nothing is allocated in the interrupt handler,
+ * samples past the end of the buffer are counted as dropped.
+ *
+ * prof_dump() prints the histogram of the sampled stacks on the UART:
+ *
+ *   prof: begin rate=1000 samples=5230 stacks=812 dropped=0
+ *   prof: 37 0x80012a4c 0x80013f10 0x8001c2e8 ...   (count, leaf first)
+ *   prof: end
+ *
+ * prof-symbolize.py turns it into flat and folded stack (flamegraph) profiles.
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include "uart_serial.h"
+#include "virt_clint.h"
+#include "prof.h"
+
+#define MTIME_FREQ      10000000UL  // QEMU default: 10 MHz
+
+// hart 0 stack (see riscv64-virt.ld): frame pointers outside are not followed
+#define STACK_SIZE      0x1000000
+extern char _stack_top[];
+
+typedef struct {
+    uint32_t count;                 // identical stacks are merged by prof_dump()
+    uint32_t depth;
+    uint64_t pc[PROF_MAX_DEPTH];    // pc[0] is mepc, then the return addresses
+} prof_sample_t;
+
+static prof_sample_t *samples;
+static uint32_t samples_max;
+static volatile uint32_t samples_num;
+static volatile uint32_t samples_dropped;
+static uint32_t sample_rate;
+static volatile bool sampling;
+
+/**
+ * @brief Allocates the sample buffer.
+ *
+ * @param rate samples per second
+ * @param max_samples buffer size, in samples
+ * @return 0 on success, -1 if out of memory
+ */
+int prof_init(uint32_t rate, uint32_t max_samples) {
+    samples = malloc(max_samples * sizeof(prof_sample_t));
+    if (samples == NULL) {
+        kprintf("prof_init(): no memory for %u samples\n", max_samples);
+        return -1;
+    }
+    samples_max = max_samples;
+    sample_rate = rate;
+    kprintf("prof_init(): %u samples/s, %u samples (%u Kb)\n",
+            rate, max_samples, (uint32_t) (max_samples * sizeof(prof_sample_t) / 1024));
+    return 0;
+}
+
+void prof_start() {
+    sampling = true;
+    set_profile_timer(MTIME_FREQ / sample_rate);
+}
+
+void prof_stop() {
+    set_profile_timer(0);
+    sampling = false;
+}
+
+/**
+ * @brief Records a sample (called from the timer interrupt handler).
+ *        No libc memory functions here: vector registers are not saved.
+ *
+ * @param pc interrupted pc
+ * @param fp interrupted frame pointer (s0)
+ */
+void prof_sample(uint64_t pc, uint64_t fp) {
+    uint64_t stack_lo = (uint64_t) _stack_top - STACK_SIZE;
+    uint64_t stack_hi = (uint64_t) _stack_top;
+
+    if (!sampling)
+        return;
+    if (samples_num == samples_max) {
+        samples_dropped++;
+        return;
+    }
+
+    prof_sample_t *s = &samples[samples_num];
+    uint32_t depth = 0;
+    s->count = 1;
+    s->pc[depth++] = pc;
+
+    // frame record below the frame pointer: return address at fp - 8,
+    // frame pointer of the caller at fp - 16 (higher up the stack)
+    while (depth < PROF_MAX_DEPTH && fp >= stack_lo + 16 && fp <= stack_hi && (fp & 7) == 0) {
+        uint64_t *frame = (uint64_t *) fp;
+        uint64_t ra = frame[-1];
+        uint64_t caller_fp = frame[-2];
+
+        if (ra == 0)
+            break;
+        s->pc[depth++] = ra;
+        if (caller_fp <= fp)
+            break;
+        fp = caller_fp;
+    }
+
+    s->depth = depth;
+    samples_num++;
+}
+
+static uint32_t prof_hash(const prof_sample_t *s) {
+    uint64_t h = s->depth;
+    for (uint32_t i = 0; i < s->depth; i++)
+        h = (h ^ s->pc[i]) * 0x100000001b3UL;
+    return (uint32_t) (h ^ (h >> 32));
+}
+
+static bool prof_same_stack(const prof_sample_t *a, const prof_sample_t *b) {
+    if (a->depth != b->depth)
+        return false;
+    for (uint32_t i = 0; i < a->depth; i++)
+        if (a->pc[i] != b->pc[i])
+            return false;
+    return true;
+}
+
+/**
+ * @brief Merges identical stacks in place, adding up their counts.
+ * @return number of distinct stacks
+ */
+static uint32_t prof_merge() {
+    uint32_t size = 1;
+    while (size < 2 * samples_num)
+        size <<= 1;
+
+    // open addressing, slot holds sample index + 1 (0: empty)
+    uint32_t *table = calloc(size, sizeof(uint32_t));
+    if (table == NULL)
+        return samples_num;
+
+    uint32_t stacks = 0;
+    for (uint32_t i = 0; i < samples_num; i++) {
+        uint32_t slot = prof_hash(&samples[i]) & (size - 1);
+        while (table[slot] != 0 && !prof_same_stack(&samples[table[slot] - 1], &samples[i]))
+            slot = (slot + 1) & (size - 1);
+
+        if (table[slot] != 0) {
+            samples[table[slot] - 1].count += samples[i].count;
+        } else {
+            if (stacks != i)
+                samples[stacks] = samples[i];
+            table[slot] = ++stacks;
+        }
+    }
+
+    free(table);
+    return stacks;
+}
+
+/**
+ * @brief Prints the histogram of the stacks sampled since the start, synchronously
+ *        (the console ring would drop most of it). Sampling is paused meanwhile.
+ */
+void prof_dump() {
+    bool was_sampling = sampling;
+    char line[32 + PROF_MAX_DEPTH * 20];
+    uint32_t total = 0;
+
+    if (samples == NULL)
+        return;
+
+    sampling = false;
+    samples_num = prof_merge();
+
+    for (uint32_t i = 0; i < samples_num; i++)
+        total += samples[i].count;
+
+    fprintf(stderr, "prof: begin rate=%u samples=%u stacks=%u dropped=%u\n",
+            sample_rate, total, samples_num, samples_dropped);
+
+    for (uint32_t i = 0; i < samples_num; i++) {
+        int len = snprintf(line, sizeof(line), "prof: %u", samples[i].count);
+        for (uint32_t j = 0; j < samples[i].depth; j++)
+            len += snprintf(line + len, sizeof(line) - len, " %p", (void *) samples[i].pc[j]);
+        fprintf(stderr, "%s\n", line);
+    }
+
+    fprintf(stderr, "prof: end\n");
+
+    sampling = was_sampling;
+}
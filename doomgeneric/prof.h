@@ -0,0 +1,15 @@
+#ifndef PROF
+#define PROF
+
+#include <stdint.h>
+
+// return addresses kept per sample, mepc included
+#define PROF_MAX_DEPTH      16
+
+int prof_init(uint32_t rate, uint32_t max_samples);
+void prof_start();
+void prof_stop();
+void prof_sample(uint64_t pc, uint64_t fp);
+void prof_dump();
+
+#endif
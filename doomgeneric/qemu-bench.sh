@@ -0,0 +1,13 @@
+# Headless benchmark: the demos given as arguments are timed back to back
+# (-timedemo), one "timedemo:" line of results is printed for each, then a
+# summary, and QEMU exits with status 0 only if all of them played.
+# e.g. bash qemu-bench.sh demo1 demo2 demo3
+# Other kernel options can be given in DOOM_ARGS, e.g. DOOM_ARGS=-nodraw
+# and the CPU model in QEMU_CPU, e.g. QEMU_CPU=rv64,v=true
+qemu-system-riscv64 -global virtio-mmio.force-legacy=false -machine virt -m 128M -smp 4 \
+ -cpu ${QEMU_CPU:-rv64} \
+ -device virtio-keyboard-device,id=vkbd \
+ -device ramfb -display none \
+ -bios none -serial stdio \
+ -fw_cfg name=opt/doom/args,string="-timedemo $* $DOOM_ARGS" \
+ -kernel doomgeneric
@@ -1,6 +1,8 @@
 #include "qemu_dma.h"
 #include "uart_serial.h"
 
+#include <string.h>
+
 /* see https://github.com/qemu/qemu/blob/master/docs/specs/fw_cfg.rst#guest-side-dma-interface
 */
 
@@ -60,11 +62,11 @@ static uint16_t mmio_read32(uint64_t addr) {
     return *((volatile uint32_t*)addr);
 }
 
-static void qemu_cfg_dma_transfer(void *address, uint32_t length, uint32_t control) {
+static int qemu_cfg_dma_transfer(void *address, uint32_t length, uint32_t control) {
     volatile QemuCfgDmaAccess access = { .address = __builtin_bswap64((uint64_t)address), .length = __builtin_bswap32(length), .control = __builtin_bswap32(control) };
 
     if (length == 0) {
-        return;
+        return 0;
     }
 
 //    __asm__("ISB");
@@ -72,6 +74,8 @@ static void qemu_cfg_dma_transfer(void *address, uint32_t length, uint32_t contr
     mmio_write_bsw64(BASE_ADDR_ADDR, (uint64_t)&access);
 
     while(__builtin_bswap32(access.control) & ~QEMU_CFG_DMA_CTL_ERROR) {}
+
+    return (__builtin_bswap32(access.control) & QEMU_CFG_DMA_CTL_ERROR) ? -1 : 0;
 }
 
 static void qemu_cfg_read(void *buf, int len) {
@@ -88,25 +92,132 @@ void qemu_cfg_write_entry(void *buf, uint32_t e, uint32_t len) {
     qemu_cfg_dma_transfer(buf, len, control);
 }
 
-int qemu_cfg_find_file() {
-    /* see https://github.com/qemu/qemu/blob/master/docs/specs/fw_cfg.rst#file-directory-key-0x0019-fw_cfg_file_dir
-    */
+/* fw_cfg file directory, read once on first use
+   (see https://github.com/qemu/qemu/blob/master/docs/specs/fw_cfg.rst#file-directory-key-0x0019-fw_cfg_file_dir)
+*/
+static fw_cfg_file_t fw_cfg_files[FW_CFG_MAX_FILES];
+static int fw_cfg_num_files = -1;
+
+static void fw_cfg_dir_load(void) {
+    uint32_t count, e;
+
+    if (fw_cfg_num_files >= 0)
+        return;
+    fw_cfg_num_files = 0;
+
+    if (!check_fw_cfg_dma()) {
+        kprintf("fw_cfg_dir_load: fw_cfg dma-interface not available\n");
+        return;
+    }
 
-    uint32_t count, e, select;
     qemu_cfg_read_entry(&count, QEMU_CFG_FILE_DIR, sizeof(count));
-    if (count == 0)
-        kprintf("Error in getting QEMU_CFG_FILE_DIR count");
     count = __builtin_bswap32(count);
+    if (count == 0)
+        kprintf("Error in getting QEMU_CFG_FILE_DIR count\n");
 
-    for (select = 0, e = 0; e < count; e++) {
+    // entries are read in sequence, the directory item stays selected
+    for (e = 0; e < count && e < FW_CFG_MAX_FILES; e++) {
         struct QemuCfgFile qfile;
+        fw_cfg_file_t *file = &fw_cfg_files[e];
+
         qemu_cfg_read(&qfile, sizeof(qfile));
-        if (memcmp_str(qfile.name, "etc/ramfb", 10) == 0) {
-            select = __builtin_bswap16(qfile.select);
+        file->size = __builtin_bswap32(qfile.size);
+        file->select = __builtin_bswap16(qfile.select);
+        memcpy(file->name, qfile.name, sizeof(file->name));
+        file->name[sizeof(file->name) - 1] = '\0';
+    }
+    fw_cfg_num_files = e;
+
+    if (count > FW_CFG_MAX_FILES)
+        kprintf("fw_cfg_dir_load: %u files, only the first %d are visible\n", count, FW_CFG_MAX_FILES);
+}
+
+/**
+ * @brief Returns the number of files in the fw_cfg directory.
+ */
+int fw_cfg_file_count(void) {
+    fw_cfg_dir_load();
+    return fw_cfg_num_files;
+}
+
+/**
+ * @brief Returns the directory entry at 'index' (in directory order), or NULL.
+ */
+const fw_cfg_file_t *fw_cfg_file_entry(int index) {
+    fw_cfg_dir_load();
+    if (index < 0 || index >= fw_cfg_num_files)
+        return NULL;
+    return &fw_cfg_files[index];
+}
+
+/**
+ * @brief Looks up a fw_cfg file by its full name (e.g. "opt/doom/iwad").
+ * @return The directory entry, or NULL if the host did not provide the file.
+ */
+const fw_cfg_file_t *fw_cfg_find(const char *name) {
+    int i;
+
+    fw_cfg_dir_load();
+    for (i = 0; i < fw_cfg_num_files; i++) {
+        if (strcmp(fw_cfg_files[i].name, name) == 0)
+            return &fw_cfg_files[i];
+    }
+    return NULL;
+}
+
+/**
+ * @brief Reads up to 'len' bytes of 'file' starting at 'offset' into 'buf'.
+ *        The device skips to 'offset' itself, then the data is transferred
+ *        in FW_CFG_DMA_CHUNK sized DMA requests straight into 'buf'.
+ *        Not reentrant: the fw_cfg selector is shared with ramfb updates.
+ * @return The number of bytes read (short at end of file or on DMA error).
+ */
+uint32_t fw_cfg_read_file(const fw_cfg_file_t *file, uint32_t offset, void *buf, uint32_t len) {
+    uint32_t control = ((uint32_t)file->select << 16) | QEMU_CFG_DMA_CTL_SELECT;
+    uint32_t done = 0;
+
+    if (offset >= file->size)
+        return 0;
+    if (len > file->size - offset)
+        len = file->size - offset;
+
+    if (offset > 0) {
+        if (qemu_cfg_dma_transfer(NULL, offset, control | QEMU_CFG_DMA_CTL_SKIP) < 0)
+            return 0;
+        control = 0;
+    }
+
+    while (done < len) {
+        uint32_t chunk = len - done;
+
+        if (chunk > FW_CFG_DMA_CHUNK)
+            chunk = FW_CFG_DMA_CHUNK;
+        if (qemu_cfg_dma_transfer((uint8_t *)buf + done, chunk, control | QEMU_CFG_DMA_CTL_READ) < 0) {
+            kprintf("fw_cfg_read_file: DMA error reading %s at offset %u\n", file->name, offset + done);
+            break;
         }
+        control = 0;
+        done += chunk;
     }
-    //kprintf("qemu_cfg_find_file(): select = [%d]\n", select);
-    return select;
+    return done;
+}
+
+/**
+ * @brief Prints the fw_cfg directory (selector, size and name of each file).
+ */
+void fw_cfg_list_files(void) {
+    int i;
+
+    fw_cfg_dir_load();
+    for (i = 0; i < fw_cfg_num_files; i++)
+        kprintf("fw_cfg: select 0x%x, %u bytes, %s\n", fw_cfg_files[i].select, fw_cfg_files[i].size, fw_cfg_files[i].name);
+}
+
+int qemu_cfg_find_file() {
+    const fw_cfg_file_t *file = fw_cfg_find("etc/ramfb");
+
+    //kprintf("qemu_cfg_find_file(): select = [%d]\n", file ? file->select : 0);
+    return file ? file->select : 0;
 }
 
 int check_fw_cfg_dma() {
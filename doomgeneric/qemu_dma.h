@@ -45,9 +45,28 @@ struct QemuCfgFile {
     char name[56];
 };
 
+// fw_cfg file directory entry, in host byte order
+typedef struct {
+    uint32_t size;          /* file size */
+    uint16_t select;        /* selector key of the file item */
+    char name[56];          /* NUL terminated, e.g. "opt/doom/iwad" */
+} fw_cfg_file_t;
+
+// maximum number of directory entries kept by fw_cfg_dir_load()
+#define FW_CFG_MAX_FILES        128
+
+// largest single DMA transfer issued by fw_cfg_read_file()
+#define FW_CFG_DMA_CHUNK        (1 << 20)
+
 int check_fw_cfg_dma();
 
 void qemu_cfg_write_entry(void *buf, uint32_t e, uint32_t len);
 int qemu_cfg_find_file();
 
+int fw_cfg_file_count(void);
+const fw_cfg_file_t *fw_cfg_file_entry(int index);
+const fw_cfg_file_t *fw_cfg_find(const char *name);
+uint32_t fw_cfg_read_file(const fw_cfg_file_t *file, uint32_t offset, void *buf, uint32_t len);
+void fw_cfg_list_files(void);
+
 #endif
\ No newline at end of file
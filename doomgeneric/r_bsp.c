@@ -24,27 +24,33 @@
 #include "m_bbox.h"
 
 #include "i_system.h"
+#include "z_zone.h"
 
 #include "r_main.h"
 #include "r_plane.h"
 #include "r_things.h"
+#include "r_draw.h"
 
 // State.
 #include "doomstat.h"
 #include "r_state.h"
+#include "r_snap.h"
 
 //#include "r_local.h"
 
 
 
-seg_t*		curline;
-side_t*		sidedef;
-line_t*		linedef;
-sector_t*	frontsector;
-sector_t*	backsector;
+R_THREAD seg_t*		curline;
+R_THREAD side_t*		sidedef;
+R_THREAD line_t*		linedef;
+R_THREAD sector_t*	frontsector;
+R_THREAD sector_t*	backsector;
 
-drawseg_t	drawsegs[MAXDRAWSEGS];
-drawseg_t*	ds_p;
+R_THREAD drawseg_t*	drawsegs;
+R_THREAD drawseg_t*	ds_p;
+
+// room in drawsegs, kept from frame to frame
+R_THREAD int		maxdrawsegs = MAXDRAWSEGS;
 
 
 void
@@ -60,10 +66,33 @@ R_StoreWallRange
 //
 void R_ClearDrawSegs (void)
 {
+    R_FramePeak (framepeaks.drawsegs, ds_p - drawsegs);
+    R_FramePeak (framepeaks.drawsegbytes, framearenas->drawsegs.peak);
+
+    Z_ArenaReset (&framearenas->drawsegs);
+    drawsegs = Z_ArenaAlloc (&framearenas->drawsegs,
+			     maxdrawsegs * sizeof(*drawsegs));
     ds_p = drawsegs;
 }
 
 
+//
+// R_GrowDrawSegs
+//
+void R_GrowDrawSegs (void)
+{
+    drawseg_t*	grown;
+
+    grown = Z_ArenaAlloc (&framearenas->drawsegs,
+			  2 * maxdrawsegs * sizeof(*drawsegs));
+    memcpy (grown, drawsegs, maxdrawsegs * sizeof(*drawsegs));
+
+    ds_p = grown + (ds_p - drawsegs);
+    drawsegs = grown;
+    maxdrawsegs *= 2;
+}
+
+
 
 //
 // ClipWallSegment
@@ -78,11 +107,15 @@ typedef	struct
 } cliprange_t;
 
 
-#define MAXSEGS		32
-
 // newend is one past the last valid seg
-cliprange_t*	newend;
-cliprange_t	solidsegs[MAXSEGS];
+// Ranges are at least one column apart: besides the two outside
+//  the view, there are at most half as many as view columns
+//  (rounded up).
+R_THREAD cliprange_t*	newend;
+R_THREAD cliprange_t*	solidsegs;
+
+// most ranges at once this frame
+static R_THREAD int	maxclipranges;
 
 
 
@@ -116,6 +149,9 @@ R_ClipSolidWallSegment
 	    R_StoreWallRange (first, last);
 	    next = newend;
 	    newend++;
+
+	    if (newend - solidsegs > maxclipranges)
+		maxclipranges = newend - solidsegs;
 	    
 	    while (next != start)
 	    {
@@ -237,6 +273,14 @@ R_ClipPassWallSegment
 //
 void R_ClearClipSegs (void)
 {
+    R_FramePeak (framepeaks.clipranges, maxclipranges);
+    R_FramePeak (framepeaks.clipbytes, framearenas->clipranges.peak);
+
+    Z_ArenaReset (&framearenas->clipranges);
+    solidsegs = Z_ArenaAlloc (&framearenas->clipranges,
+			      (viewwidth / 2 + 3) * sizeof(*solidsegs));
+    maxclipranges = 2;
+
     solidsegs[0].first = -0x7fffffff;
     solidsegs[0].last = -1;
     solidsegs[1].first = viewwidth;
@@ -310,7 +354,7 @@ void R_AddLine (seg_t*	line)
     if (x1 == x2)
 	return;				
 	
-    backsector = line->backsector;
+    backsector = R_RenderSector (line->backsector);
 
     // Single sided line?
     if (!backsector)
@@ -334,7 +378,7 @@ void R_AddLine (seg_t*	line)
     if (backsector->ceilingpic == frontsector->ceilingpic
 	&& backsector->floorpic == frontsector->floorpic
 	&& backsector->lightlevel == frontsector->lightlevel
-	&& curline->sidedef->midtexture == 0)
+	&& R_RenderSide (curline->sidedef)->midtexture == 0)
     {
 	return;
     }
@@ -502,7 +546,7 @@ void R_Subsector (int num)
 
     sscount++;
     sub = &subsectors[num];
-    frontsector = sub->sector;
+    frontsector = R_RenderSector (sub->sector);
     count = sub->numlines;
     line = &segs[sub->firstline];
 
@@ -22,25 +22,26 @@
 
 
 
-extern seg_t*		curline;
-extern side_t*		sidedef;
-extern line_t*		linedef;
-extern sector_t*	frontsector;
-extern sector_t*	backsector;
+extern R_THREAD seg_t*		curline;
+extern R_THREAD side_t*		sidedef;
+extern R_THREAD line_t*		linedef;
+extern R_THREAD sector_t*	frontsector;
+extern R_THREAD sector_t*	backsector;
 
-extern int		rw_x;
-extern int		rw_stopx;
+extern R_THREAD int		rw_x;
+extern R_THREAD int		rw_stopx;
 
-extern boolean		segtextured;
+extern R_THREAD boolean		segtextured;
 
 // false if the back side is the same plane
-extern boolean		markfloor;		
-extern boolean		markceiling;
+extern R_THREAD boolean		markfloor;		
+extern R_THREAD boolean		markceiling;
 
 extern boolean		skymap;
 
-extern drawseg_t	drawsegs[MAXDRAWSEGS];
-extern drawseg_t*	ds_p;
+extern R_THREAD drawseg_t*	drawsegs;
+extern R_THREAD drawseg_t*	ds_p;
+extern R_THREAD int		maxdrawsegs;
 
 extern lighttable_t**	hscalelight;
 extern lighttable_t**	vscalelight;
@@ -54,6 +55,9 @@ typedef void (*drawfunc_t) (int start, int stop);
 void R_ClearClipSegs (void);
 void R_ClearDrawSegs (void);
 
+// Called when drawsegs is full: moves them to twice the room.
+void R_GrowDrawSegs (void);
+
 
 void R_RenderBSPNode (int bspnum);
 
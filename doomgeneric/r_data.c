@@ -38,6 +38,19 @@
 
 #include "r_data.h"
 
+#ifdef RENDER_SMP
+#include "smp.h"
+
+// Composite textures are built on demand: harts rendering
+//  strips serialize their generation with this lock.
+static spinlock_t	cachelock;
+#define R_LockCache()	spin_lock (&cachelock)
+#define R_UnlockCache()	spin_unlock (&cachelock)
+#else
+#define R_LockCache()
+#define R_UnlockCache()
+#endif
+
 //
 // Graphics.
 // DOOM graphics for walls and sprites
@@ -239,9 +252,11 @@ void R_GenerateComposite (int texnum)
 	
     texture = textures[texnum];
 
+    // Other harts may look at texturecomposite[texnum] without
+    //  locking: it is only set once the columns are built.
     block = Z_Malloc (texturecompositesize[texnum],
 		      PU_STATIC, 
-		      &texturecomposite[texnum]);	
+		      &block);	
 
     collump = texturecolumnlump[texnum];
     colofs = texturecolumnofs[texnum];
@@ -281,6 +296,9 @@ void R_GenerateComposite (int texnum)
 						
     }
 
+    __atomic_thread_fence (__ATOMIC_RELEASE);
+    Z_ChangeUser (block, (void **) &texturecomposite[texnum]);
+
     // Now that the texture has been built in column cache,
     //  it is purgable from zone memory.
     Z_ChangeTag (block, PU_CACHE);
@@ -392,10 +410,21 @@ R_GetColumn
     ofs = texturecolumnofs[tex][col];
     
     if (lump > 0)
+    {
+	// loading the patch may purge those of queued wall columns
+	if (!W_LumpInMemory (lump))
+	    R_FlushWallBatches ();
 	return (byte *)W_CacheLumpNum(lump,PU_CACHE)+ofs;
+    }
 
     if (!texturecomposite[tex])
-	R_GenerateComposite (tex);
+    {
+	R_FlushWallBatches ();
+	R_LockCache ();
+	if (!texturecomposite[tex])
+	    R_GenerateComposite (tex);
+	R_UnlockCache ();
+    }
 
     return texturecomposite[tex] + ofs;
 }
@@ -39,6 +39,15 @@
 #include "v_patch.h"
 
 
+// Renderer working state (BSP clipping, planes, sprites, drawer
+// parameters) is private to each hart when the player view is
+// rendered in column strips on several harts (see R_RenderPlayerView).
+#ifdef RENDER_SMP
+#define R_THREAD		__thread
+#else
+#define R_THREAD
+#endif
+
 
 
 // Silhouette, needed for clipping Segs (mainly)
@@ -48,6 +57,7 @@
 #define SIL_TOP			2
 #define SIL_BOTH		3
 
+// Room for drawsegs at startup, doubled when a frame needs more.
 #define MAXDRAWSEGS		256
 
 
@@ -127,6 +137,10 @@ typedef	struct
 
     int			linecount;
     struct line_s**	lines;	// [linecount] size
+
+    // Heights before the last tic (-uncapped).
+    fixed_t	oldfloorheight;
+    fixed_t	oldceilingheight;
     
 } sector_t;
 
@@ -420,25 +434,24 @@ typedef struct
 //
 // Now what is a visplane, anyway?
 // 
-typedef struct
+typedef struct visplane_s
 {
   fixed_t		height;
   int			picnum;
   int			lightlevel;
   int			minx;
   int			maxx;
-  
-  // leave pads for [minx-1]/[maxx+1]
-  
-  byte		pad1;
-  // Here lies the rub for all
-  //  dynamic resize/change of resolution.
-  byte		top[SCREENWIDTH];
-  byte		pad2;
-  byte		pad3;
-  // See above.
-  byte		bottom[SCREENWIDTH];
-  byte		pad4;
+
+  // next plane with the same hash, next plane of the frame
+  struct visplane_s*	hashnext;
+  struct visplane_s*	next;
+
+  // Rows are shorts: a -hires view is 400 rows high, and 0xffff
+  //  marks the columns the plane does not cover.
+  // Allocated after the plane for the width of the view,
+  //  with pads for [minx-1]/[maxx+1].
+  unsigned short*	top;
+  unsigned short*	bottom;
 
 } visplane_t;
 
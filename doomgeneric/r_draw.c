@@ -25,6 +25,7 @@
 #include "deh_main.h"
 
 #include "i_system.h"
+#include "m_argv.h"
 #include "z_zone.h"
 #include "w_wad.h"
 
@@ -37,12 +38,8 @@
 #include "doomstat.h"
 
 
-// ?
-#define MAXWIDTH			1120
-#define MAXHEIGHT			832
-
 // status bar height at bottom of screen
-#define SBARHEIGHT		32
+#define SBARHEIGHT		(32 << hires)
 
 //
 // All drawing to the view buffer is accomplished in this file.
@@ -79,18 +76,23 @@ static byte *background_buffer = NULL;
 // R_DrawColumn
 // Source is the top of the column to scale.
 //
-lighttable_t*		dc_colormap; 
-int			dc_x; 
-int			dc_yl; 
-int			dc_yh; 
-fixed_t			dc_iscale; 
-fixed_t			dc_texturemid;
+R_THREAD lighttable_t*		dc_colormap; 
+R_THREAD int			dc_x; 
+R_THREAD int			dc_yl; 
+R_THREAD int			dc_yh; 
+R_THREAD fixed_t			dc_iscale; 
+R_THREAD fixed_t			dc_texturemid;
 
 // first pixel in a column (possibly virtual) 
-byte*			dc_source;		
+R_THREAD byte*			dc_source;		
 
 // just for profiling 
-int			dccount;
+R_THREAD int			dccount;
+
+// View columns [dc_stripx1, dc_stripx2] drawn by this hart: the
+// drawers skip pixels outside (see R_RenderPlayerView).
+R_THREAD int			dc_stripx1;
+R_THREAD int			dc_stripx2 = MAXWIDTH - 1;
 
 //
 // A column is a vertical slice/span from a wall texture that,
@@ -105,12 +107,17 @@ void R_DrawColumn (void)
     byte*		dest; 
     fixed_t		frac;
     fixed_t		fracstep;	 
+    int			pitch;
  
     count = dc_yh - dc_yl; 
 
     // Zero length, column does not exceed a pixel.
     if (count < 0) 
 	return; 
+
+    // Not in the strip drawn by this hart.
+    if (dc_x < dc_stripx1 || dc_x > dc_stripx2)
+	return;
 				 
 #ifdef RANGECHECK 
     if ((unsigned)dc_x >= SCREENWIDTH
@@ -123,6 +130,7 @@ void R_DrawColumn (void)
     // Use ylookup LUT to avoid multiply with ScreenWidth.
     // Use columnofs LUT for subwindows? 
     dest = ylookup[dc_yl] + columnofs[dc_x];  
+    pitch = SCREENYSTEP;
 
     // Determine scaling,
     //  which is the only mapping to be done.
@@ -138,7 +146,7 @@ void R_DrawColumn (void)
 	//  using a lighting/special effects LUT.
 	*dest = dc_colormap[dc_source[(frac>>FRACBITS)&127]];
 	
-	dest += SCREENWIDTH; 
+	dest += pitch; 
 	frac += fracstep;
 	
     } while (count--); 
@@ -212,6 +220,7 @@ void R_DrawColumnLow (void)
     byte*		dest2;
     fixed_t		frac;
     fixed_t		fracstep;	 
+    int			pitch;
     int                 x;
  
     count = dc_yh - dc_yl; 
@@ -219,6 +228,10 @@ void R_DrawColumnLow (void)
     // Zero length.
     if (count < 0) 
 	return; 
+
+    // Not in the strip drawn by this hart.
+    if (dc_x < dc_stripx1 || dc_x > dc_stripx2)
+	return;
 				 
 #ifdef RANGECHECK 
     if ((unsigned)dc_x >= SCREENWIDTH
@@ -235,6 +248,7 @@ void R_DrawColumnLow (void)
     
     dest = ylookup[dc_yl] + columnofs[x];
     dest2 = ylookup[dc_yl] + columnofs[x+1];
+    pitch = SCREENYSTEP;
     
     fracstep = dc_iscale; 
     frac = dc_texturemid + (dc_yl-centery)*fracstep;
@@ -243,19 +257,281 @@ void R_DrawColumnLow (void)
     {
 	// Hack. Does not work corretly.
 	*dest2 = *dest = dc_colormap[dc_source[(frac>>FRACBITS)&127]];
-	dest += SCREENWIDTH;
-	dest2 += SCREENWIDTH;
+	dest += pitch;
+	dest2 += pitch;
 	frac += fracstep; 
 
     } while (count--);
 }
 
 
+//
+// Wall columns drawn in groups (R_RenderSegLoop).
+// WALLBATCH adjacent columns of a wall tier with the same light
+//  level are drawn row by row: the rows all of them cover with one
+//  32-bit store per row (two in low detail), the rows above and
+//  below that column by column.
+// Every pixel gets the texel and colormap of R_DrawColumn, so the
+//  picture is the same. Row-major screens only: on column-major
+//  ones the columns are already contiguous.
+//
+boolean			wallbatching = true;
+
+// The pixels of a group in one row.
+typedef union
+{
+    uint32_t		word[2];
+    byte		pixel[8];
+} wallrow_t;
+
+//
+// R_DrawWallRows
+// Rows y1 to y2 of column x, one at a time.
+// Returns the texture position of the next row.
+//
+static fixed_t
+R_DrawWallRows
+( int		x,
+  int		y1,
+  int		y2,
+  fixed_t	frac,
+  fixed_t	fracstep,
+  byte*		source,
+  lighttable_t*	colormap )
+{
+    byte*	dest;
+    int		y;
+
+    if (y1 > y2)
+	return frac;
+
+    dest = ylookup[y1] + columnofs[x << detailshift];
+
+    for (y = y1; y <= y2; y++)
+    {
+	if (detailshift)
+	    dest[1] = dest[0] = colormap[source[(frac>>FRACBITS)&127]];
+	else
+	    dest[0] = colormap[source[(frac>>FRACBITS)&127]];
+
+	dest += SCREENWIDTH;
+	frac += fracstep;
+    }
+
+    return frac;
+}
+
+//
+// R_DrawWallGroup
+// A full group whose columns share rows top to bottom,
+//  and whose first pixel is aligned for 32-bit stores.
+//
+static void
+R_DrawWallGroup
+( wallbatch_t*	batch,
+  int		top,
+  int		bottom )
+{
+    fixed_t		frac[WALLBATCH];
+    fixed_t		frac0, frac1, frac2, frac3;
+    fixed_t		step0, step1, step2, step3;
+    byte		*source0, *source1, *source2, *source3;
+    lighttable_t*	colormap;
+    uint32_t*		dest;
+    wallrow_t		row;
+    int			count;
+    int			i;
+
+    colormap = batch->colormap;
+
+    // rows above the shared ones
+    for (i = 0; i < WALLBATCH; i++)
+    {
+	frac[i] = batch->texturemid
+		+ (batch->yl[i]-centery)*batch->iscale[i];
+	frac[i] = R_DrawWallRows (batch->x + i, batch->yl[i], top - 1,
+				  frac[i], batch->iscale[i],
+				  batch->source[i], colormap);
+    }
+
+    frac0 = frac[0];
+    frac1 = frac[1];
+    frac2 = frac[2];
+    frac3 = frac[3];
+    step0 = batch->iscale[0];
+    step1 = batch->iscale[1];
+    step2 = batch->iscale[2];
+    step3 = batch->iscale[3];
+    source0 = batch->source[0];
+    source1 = batch->source[1];
+    source2 = batch->source[2];
+    source3 = batch->source[3];
+
+    dest = (uint32_t *) (ylookup[top] + columnofs[batch->x << detailshift]);
+    count = bottom - top;
+
+    if (detailshift)
+    {
+	do
+	{
+	    row.pixel[1] = row.pixel[0]
+		= colormap[source0[(frac0>>FRACBITS)&127]];
+	    row.pixel[3] = row.pixel[2]
+		= colormap[source1[(frac1>>FRACBITS)&127]];
+	    row.pixel[5] = row.pixel[4]
+		= colormap[source2[(frac2>>FRACBITS)&127]];
+	    row.pixel[7] = row.pixel[6]
+		= colormap[source3[(frac3>>FRACBITS)&127]];
+	    dest[0] = row.word[0];
+	    dest[1] = row.word[1];
+
+	    dest += SCREENWIDTH / 4;
+	    frac0 += step0;
+	    frac1 += step1;
+	    frac2 += step2;
+	    frac3 += step3;
+	} while (count--);
+    }
+    else
+    {
+	do
+	{
+	    row.pixel[0] = colormap[source0[(frac0>>FRACBITS)&127]];
+	    row.pixel[1] = colormap[source1[(frac1>>FRACBITS)&127]];
+	    row.pixel[2] = colormap[source2[(frac2>>FRACBITS)&127]];
+	    row.pixel[3] = colormap[source3[(frac3>>FRACBITS)&127]];
+	    dest[0] = row.word[0];
+
+	    dest += SCREENWIDTH / 4;
+	    frac0 += step0;
+	    frac1 += step1;
+	    frac2 += step2;
+	    frac3 += step3;
+	} while (count--);
+    }
+
+    frac[0] = frac0;
+    frac[1] = frac1;
+    frac[2] = frac2;
+    frac[3] = frac3;
+
+    // rows below
+    for (i = 0; i < WALLBATCH; i++)
+    {
+	R_DrawWallRows (batch->x + i, bottom + 1, batch->yh[i],
+			frac[i], batch->iscale[i],
+			batch->source[i], colormap);
+    }
+}
+
+//
+// R_FlushWallColumns
+// Draws the columns queued, as a group when they make one.
+//
+void R_FlushWallColumns (wallbatch_t* batch)
+{
+    byte*	dest;
+    int		top;
+    int		bottom;
+    int		i;
+
+    if (batch->count == WALLBATCH)
+    {
+	top = batch->yl[0];
+	bottom = batch->yh[0];
+
+	for (i = 1; i < WALLBATCH; i++)
+	{
+	    if (batch->yl[i] > top)
+		top = batch->yl[i];
+	    if (batch->yh[i] < bottom)
+		bottom = batch->yh[i];
+	}
+
+	dest = ylookup[top] + columnofs[batch->x << detailshift];
+
+	if (top <= bottom && ((uintptr_t) dest & 3) == 0)
+	{
+	    R_DrawWallGroup (batch, top, bottom);
+	    batch->count = 0;
+	    return;
+	}
+    }
+
+    for (i = 0; i < batch->count; i++)
+    {
+	R_DrawWallRows (batch->x + i, batch->yl[i], batch->yh[i],
+			batch->texturemid
+			+ (batch->yl[i]-centery)*batch->iscale[i],
+			batch->iscale[i], batch->source[i],
+			batch->colormap);
+    }
+
+    batch->count = 0;
+}
+
+//
+// R_BatchWallColumn
+// Queues the column set up for colfunc: dc_x (in the strip drawn
+//  by this hart), dc_yl, dc_yh, dc_iscale, dc_texturemid, dc_source
+//  and dc_colormap.
+//
+void R_BatchWallColumn (wallbatch_t* batch)
+{
+    int		i;
+
+    // Zero length.
+    if (dc_yl > dc_yh)
+	return;
+
+    if (!wallbatching || colmajor)
+    {
+	colfunc ();
+	return;
+    }
+
+#ifdef RANGECHECK
+    if ((unsigned)(dc_x << detailshift) >= SCREENWIDTH
+	|| dc_yl < 0
+	|| dc_yh >= SCREENHEIGHT)
+	I_Error ("R_BatchWallColumn: %i to %i at %i", dc_yl, dc_yh, dc_x);
+#endif
+
+    if (batch->count > 0
+     && (dc_x != batch->x + batch->count
+      || dc_colormap != batch->colormap
+      || dc_texturemid != batch->texturemid))
+    {
+	R_FlushWallColumns (batch);
+    }
+
+    if (batch->count == 0)
+    {
+	batch->x = dc_x;
+	batch->colormap = dc_colormap;
+	batch->texturemid = dc_texturemid;
+    }
+
+    i = batch->count++;
+    batch->yl[i] = dc_yl;
+    batch->yh[i] = dc_yh;
+    batch->iscale[i] = dc_iscale;
+    batch->source[i] = dc_source;
+
+    // groups start on a multiple of WALLBATCH
+    if (((dc_x + 1) & (WALLBATCH - 1)) == 0)
+	R_FlushWallColumns (batch);
+}
+
+
 //
 // Spectre/Invisibility.
 //
 #define FUZZTABLE		50 
-#define FUZZOFF	(SCREENWIDTH)
+
+// One row up or down: multiplied by the distance between rows where
+//  it is used, which is only known at run time.
+#define FUZZOFF	1
 
 
 int	fuzzoffset[FUZZTABLE] =
@@ -269,7 +545,7 @@ int	fuzzoffset[FUZZTABLE] =
     FUZZOFF,FUZZOFF,-FUZZOFF,FUZZOFF,FUZZOFF,-FUZZOFF,FUZZOFF 
 }; 
 
-int	fuzzpos = 0; 
+R_THREAD int	fuzzpos = 0; 
 
 
 //
@@ -286,6 +562,7 @@ void R_DrawFuzzColumn (void)
     byte*		dest; 
     fixed_t		frac;
     fixed_t		fracstep;	 
+    int			pitch;
 
     // Adjust borders. Low... 
     if (!dc_yl) 
@@ -301,6 +578,14 @@ void R_DrawFuzzColumn (void)
     if (count < 0) 
 	return; 
 
+    // Not in the strip drawn by this hart: only keep the
+    //  fuzz pattern in step with the other strips.
+    if (dc_x < dc_stripx1 || dc_x > dc_stripx2)
+    {
+	fuzzpos = (fuzzpos + count + 1) % FUZZTABLE;
+	return;
+    }
+
 #ifdef RANGECHECK 
     if ((unsigned)dc_x >= SCREENWIDTH
 	|| dc_yl < 0 || dc_yh >= SCREENHEIGHT)
@@ -311,6 +596,7 @@ void R_DrawFuzzColumn (void)
 #endif
     
     dest = ylookup[dc_yl] + columnofs[dc_x];
+    pitch = SCREENYSTEP;
 
     // Looks familiar.
     fracstep = dc_iscale; 
@@ -325,13 +611,13 @@ void R_DrawFuzzColumn (void)
 	//  a pixel that is either one column
 	//  left or right of the current one.
 	// Add index from colormap to index.
-	*dest = colormaps[6*256+dest[fuzzoffset[fuzzpos]]]; 
+	*dest = colormaps[6*256+dest[fuzzoffset[fuzzpos] * pitch]]; 
 
 	// Clamp table lookup index.
 	if (++fuzzpos == FUZZTABLE) 
 	    fuzzpos = 0;
 	
-	dest += SCREENWIDTH;
+	dest += pitch;
 
 	frac += fracstep; 
     } while (count--); 
@@ -346,6 +632,7 @@ void R_DrawFuzzColumnLow (void)
     byte*		dest2; 
     fixed_t		frac;
     fixed_t		fracstep;	 
+    int			pitch;
     int x;
 
     // Adjust borders. Low... 
@@ -362,6 +649,14 @@ void R_DrawFuzzColumnLow (void)
     if (count < 0) 
 	return; 
 
+    // Not in the strip drawn by this hart: only keep the
+    //  fuzz pattern in step with the other strips.
+    if (dc_x < dc_stripx1 || dc_x > dc_stripx2)
+    {
+	fuzzpos = (fuzzpos + count + 1) % FUZZTABLE;
+	return;
+    }
+
     // low detail mode, need to multiply by 2
     
     x = dc_x << 1;
@@ -377,6 +672,7 @@ void R_DrawFuzzColumnLow (void)
     
     dest = ylookup[dc_yl] + columnofs[x];
     dest2 = ylookup[dc_yl] + columnofs[x+1];
+    pitch = SCREENYSTEP;
 
     // Looks familiar.
     fracstep = dc_iscale; 
@@ -391,15 +687,15 @@ void R_DrawFuzzColumnLow (void)
 	//  a pixel that is either one column
 	//  left or right of the current one.
 	// Add index from colormap to index.
-	*dest = colormaps[6*256+dest[fuzzoffset[fuzzpos]]]; 
-	*dest2 = colormaps[6*256+dest2[fuzzoffset[fuzzpos]]]; 
+	*dest = colormaps[6*256+dest[fuzzoffset[fuzzpos] * pitch]]; 
+	*dest2 = colormaps[6*256+dest2[fuzzoffset[fuzzpos] * pitch]]; 
 
 	// Clamp table lookup index.
 	if (++fuzzpos == FUZZTABLE) 
 	    fuzzpos = 0;
 	
-	dest += SCREENWIDTH;
-	dest2 += SCREENWIDTH;
+	dest += pitch;
+	dest2 += pitch;
 
 	frac += fracstep; 
     } while (count--); 
@@ -418,7 +714,7 @@ void R_DrawFuzzColumnLow (void)
 //  of the BaronOfHell, the HellKnight, uses
 //  identical sprites, kinda brightened up.
 //
-byte*	dc_translation;
+R_THREAD byte*	dc_translation;
 byte*	translationtables;
 
 void R_DrawTranslatedColumn (void) 
@@ -427,10 +723,15 @@ void R_DrawTranslatedColumn (void)
     byte*		dest; 
     fixed_t		frac;
     fixed_t		fracstep;	 
+    int			pitch;
  
     count = dc_yh - dc_yl; 
     if (count < 0) 
 	return; 
+
+    // Not in the strip drawn by this hart.
+    if (dc_x < dc_stripx1 || dc_x > dc_stripx2)
+	return;
 				 
 #ifdef RANGECHECK 
     if ((unsigned)dc_x >= SCREENWIDTH
@@ -445,6 +746,7 @@ void R_DrawTranslatedColumn (void)
 
 
     dest = ylookup[dc_yl] + columnofs[dc_x]; 
+    pitch = SCREENYSTEP;
 
     // Looks familiar.
     fracstep = dc_iscale; 
@@ -459,7 +761,7 @@ void R_DrawTranslatedColumn (void)
 	// Thus the "green" ramp of the player 0 sprite
 	//  is mapped to gray, red, black/indigo. 
 	*dest = dc_colormap[dc_translation[dc_source[frac>>FRACBITS]]];
-	dest += SCREENWIDTH;
+	dest += pitch;
 	
 	frac += fracstep; 
     } while (count--); 
@@ -472,12 +774,17 @@ void R_DrawTranslatedColumnLow (void)
     byte*		dest2; 
     fixed_t		frac;
     fixed_t		fracstep;	 
+    int			pitch;
     int                 x;
  
     count = dc_yh - dc_yl; 
     if (count < 0) 
 	return; 
 
+    // Not in the strip drawn by this hart.
+    if (dc_x < dc_stripx1 || dc_x > dc_stripx2)
+	return;
+
     // low detail, need to scale by 2
     x = dc_x << 1;
 				 
@@ -495,6 +802,7 @@ void R_DrawTranslatedColumnLow (void)
 
     dest = ylookup[dc_yl] + columnofs[x]; 
     dest2 = ylookup[dc_yl] + columnofs[x+1]; 
+    pitch = SCREENYSTEP;
 
     // Looks familiar.
     fracstep = dc_iscale; 
@@ -510,8 +818,8 @@ void R_DrawTranslatedColumnLow (void)
 	//  is mapped to gray, red, black/indigo. 
 	*dest = dc_colormap[dc_translation[dc_source[frac>>FRACBITS]]];
 	*dest2 = dc_colormap[dc_translation[dc_source[frac>>FRACBITS]]];
-	dest += SCREENWIDTH;
-	dest2 += SCREENWIDTH;
+	dest += pitch;
+	dest2 += pitch;
 	
 	frac += fracstep; 
     } while (count--); 
@@ -567,34 +875,41 @@ void R_InitTranslationTables (void)
 // In consequence, flats are not stored by column (like walls),
 //  and the inner loop has to step in texture space u and v.
 //
-int			ds_y; 
-int			ds_x1; 
-int			ds_x2;
+R_THREAD int			ds_y; 
+R_THREAD int			ds_x1; 
+R_THREAD int			ds_x2;
 
-lighttable_t*		ds_colormap; 
+R_THREAD lighttable_t*		ds_colormap; 
 
-fixed_t			ds_xfrac; 
-fixed_t			ds_yfrac; 
-fixed_t			ds_xstep; 
-fixed_t			ds_ystep;
+R_THREAD fixed_t			ds_xfrac; 
+R_THREAD fixed_t			ds_yfrac; 
+R_THREAD fixed_t			ds_xstep; 
+R_THREAD fixed_t			ds_ystep;
 
 // start of a 64*64 tile image 
-byte*			ds_source;	
+R_THREAD byte*			ds_source;	
 
 // just for profiling
-int			dscount;
+R_THREAD int			dscount;
 
+// Span drawers of the high and low detail levels (see R_InitSpans).
+void		(*drawspanfunc) (void);
+void		(*drawspanlowfunc) (void);
 
-//
-// Draws the actual span.
-void R_DrawSpan (void) 
-{ 
-    unsigned int position, step;
-    byte *dest;
-    int count;
-    int spot;
-    unsigned int xtemp, ytemp;
 
+//
+// R_ClipSpan
+// Packs the texture position and step of the span into 32-bit
+//  integers, and clips the span to the strip drawn by this hart.
+// Returns false when nothing is left to draw.
+//
+static boolean
+R_ClipSpan
+( unsigned int*	position,
+  unsigned int*	step,
+  int*		x1,
+  int*		x2 )
+{
 #ifdef RANGECHECK
     if (ds_x2 < ds_x1
 	|| ds_x1<0
@@ -612,15 +927,43 @@ void R_DrawSpan (void)
     // each 16-bit part, the top 6 bits are the integer part and the
     // bottom 10 bits are the fractional part of the pixel position.
 
-    position = ((ds_xfrac << 10) & 0xffff0000)
-             | ((ds_yfrac >> 6)  & 0x0000ffff);
-    step = ((ds_xstep << 10) & 0xffff0000)
-         | ((ds_ystep >> 6)  & 0x0000ffff);
+    *position = ((ds_xfrac << 10) & 0xffff0000)
+              | ((ds_yfrac >> 6)  & 0x0000ffff);
+    *step = ((ds_xstep << 10) & 0xffff0000)
+          | ((ds_ystep >> 6)  & 0x0000ffff);
 
-    dest = ylookup[ds_y] + columnofs[ds_x1];
+    // Clip to the strip drawn by this hart, stepping the texture
+    // position over the skipped pixels.
+    *x1 = ds_x1;
+    *x2 = ds_x2;
+    if (*x1 < dc_stripx1)
+    {
+	*position += *step * (dc_stripx1 - *x1);
+	*x1 = dc_stripx1;
+    }
+    if (*x2 > dc_stripx2)
+	*x2 = dc_stripx2;
+
+    return *x2 >= *x1;
+}
 
-    // We do not check for zero spans here?
-    count = ds_x2 - ds_x1;
+//
+// R_DrawSpanPixels
+// The inner loop: count pixels from the packed texture position,
+//  pitch bytes apart (1 unless the screen is column-major).
+//
+static inline void
+R_DrawSpanPixels
+( byte*		dest,
+  int		count,
+  int		pitch,
+  unsigned int	position,
+  unsigned int	step,
+  byte*		source,
+  lighttable_t*	colormap )
+{
+    unsigned int xtemp, ytemp;
+    int spot;
 
     do
     {
@@ -631,11 +974,26 @@ void R_DrawSpan (void)
 
 	// Lookup pixel from flat texture tile,
 	//  re-index using light/colormap.
-	*dest++ = ds_colormap[ds_source[spot]];
+	*dest = colormap[source[spot]];
+	dest += pitch;
 
         position += step;
 
-    } while (count--);
+    } while (--count);
+}
+
+//
+// Draws the actual span.
+void R_DrawSpan (void) 
+{ 
+    unsigned int position, step;
+    int x1, x2;
+
+    if (!R_ClipSpan (&position, &step, &x1, &x2))
+	return;
+
+    R_DrawSpanPixels (ylookup[ds_y] + columnofs[x1], x2 - x1 + 1,
+		      SCREENXSTEP, position, step, ds_source, ds_colormap);
 }
 
 
@@ -716,39 +1074,19 @@ void R_DrawSpan (void)
 //
 // Again..
 //
-void R_DrawSpanLow (void)
+static inline void
+R_DrawSpanPixelsLow
+( byte*		dest,
+  int		count,
+  int		pitch,
+  unsigned int	position,
+  unsigned int	step,
+  byte*		source,
+  lighttable_t*	colormap )
 {
-    unsigned int position, step;
     unsigned int xtemp, ytemp;
-    byte *dest;
-    int count;
     int spot;
 
-#ifdef RANGECHECK
-    if (ds_x2 < ds_x1
-	|| ds_x1<0
-	|| ds_x2>=SCREENWIDTH
-	|| (unsigned)ds_y>SCREENHEIGHT)
-    {
-	I_Error( "R_DrawSpan: %i to %i at %i",
-		 ds_x1,ds_x2,ds_y);
-    }
-//	dscount++; 
-#endif
-
-    position = ((ds_xfrac << 10) & 0xffff0000)
-             | ((ds_yfrac >> 6)  & 0x0000ffff);
-    step = ((ds_xstep << 10) & 0xffff0000)
-         | ((ds_ystep >> 6)  & 0x0000ffff);
-
-    count = (ds_x2 - ds_x1);
-
-    // Blocky mode, need to multiply by 2.
-    ds_x1 <<= 1;
-    ds_x2 <<= 1;
-
-    dest = ylookup[ds_y] + columnofs[ds_x1];
-
     do
     {
 	// Calculate current texture index in u,v.
@@ -758,12 +1096,194 @@ void R_DrawSpanLow (void)
 
 	// Lowres/blocky mode does it twice,
 	//  while scale is adjusted appropriately.
-	*dest++ = ds_colormap[ds_source[spot]];
-	*dest++ = ds_colormap[ds_source[spot]];
+	*dest = colormap[source[spot]];
+	dest += pitch;
+	*dest = colormap[source[spot]];
+	dest += pitch;
 
 	position += step;
 
-    } while (count--);
+    } while (--count);
+}
+
+void R_DrawSpanLow (void)
+{
+    unsigned int position, step;
+    int x1, x2;
+
+    if (!R_ClipSpan (&position, &step, &x1, &x2))
+	return;
+
+    // Blocky mode, need to multiply by 2.
+    R_DrawSpanPixelsLow (ylookup[ds_y] + columnofs[x1 << 1], x2 - x1 + 1,
+			 SCREENXSTEP, position, step, ds_source, ds_colormap);
+}
+
+
+#ifndef DG_NATIVE
+
+//
+// RISC-V Vector span drawers
+// The inner loops of r_draw_rvv.s step a whole vector of texture
+//  positions at once, and look up the flat and the colormap with
+//  indexed loads. They are only used once R_CheckSpans has found
+//  them to draw the same pixels as the loops above.
+//
+
+int libc_has_rvv ();
+
+void R_DrawSpanPixelsRVV (byte* dest, int count, int pitch,
+			  unsigned int position, unsigned int step,
+			  byte* source, lighttable_t* colormap);
+void R_DrawSpanPixelsLowRVV (byte* dest, int count, int pitch,
+			     unsigned int position, unsigned int step,
+			     byte* source, lighttable_t* colormap);
+
+static void R_DrawSpanVector (void)
+{
+    unsigned int position, step;
+    int x1, x2;
+
+    if (!R_ClipSpan (&position, &step, &x1, &x2))
+	return;
+
+    R_DrawSpanPixelsRVV (ylookup[ds_y] + columnofs[x1], x2 - x1 + 1,
+			 SCREENXSTEP, position, step, ds_source, ds_colormap);
+}
+
+static void R_DrawSpanLowVector (void)
+{
+    unsigned int position, step;
+    int x1, x2;
+
+    if (!R_ClipSpan (&position, &step, &x1, &x2))
+	return;
+
+    R_DrawSpanPixelsLowRVV (ylookup[ds_y] + columnofs[x1 << 1],
+			    x2 - x1 + 1, SCREENXSTEP,
+			    position, step, ds_source, ds_colormap);
+}
+
+// Pseudo-random test spans: not M_Random, demos depend on its sequence.
+static unsigned int	checkseed;
+
+static unsigned int R_CheckRandom (void)
+{
+    checkseed = checkseed * 1103515245 + 12345;
+
+    return checkseed;
+}
+
+// Distance between pixels of the column-major test spans.
+#define CHECKPITCH	3
+
+//
+// R_CheckSpans
+// Draws spans of every length with random positions and steps
+//  with both versions of the inner loops, and compares the rows,
+//  including the pixels after the span.
+//
+static boolean R_CheckSpans (void)
+{
+    static byte		source[64*64];
+    static lighttable_t	colormap[256];
+    static byte		scalar[(MAXWIDTH*2 + 16) * CHECKPITCH];
+    static byte		vector[(MAXWIDTH*2 + 16) * CHECKPITCH];
+    unsigned int	position;
+    unsigned int	step;
+    int			pitch;
+    int			count;
+    int			i;
+
+    checkseed = 1;
+
+    for (i = 0; i < 64*64; i++)
+	source[i] = R_CheckRandom () >> 16;
+    for (i = 0; i < 256; i++)
+	colormap[i] = R_CheckRandom () >> 16;
+
+    for (count = 1; count <= MAXWIDTH; count++)
+    {
+	position = R_CheckRandom ();
+	step = R_CheckRandom () >> (count & 15);
+
+	// Rows, and spans across the columns of a column-major screen.
+	pitch = (count & 1) ? 1 : CHECKPITCH;
+
+	memset (scalar, 0, sizeof(scalar));
+	memset (vector, 0, sizeof(vector));
+	R_DrawSpanPixels (scalar, count, pitch, position, step,
+			  source, colormap);
+	R_DrawSpanPixelsRVV (vector, count, pitch, position, step,
+			     source, colormap);
+
+	if (memcmp (scalar, vector, sizeof(scalar)))
+	    return false;
+
+	memset (scalar, 0, sizeof(scalar));
+	memset (vector, 0, sizeof(vector));
+	R_DrawSpanPixelsLow (scalar, count, pitch, position, step,
+			     source, colormap);
+	R_DrawSpanPixelsLowRVV (vector, count, pitch, position, step,
+				source, colormap);
+
+	if (memcmp (scalar, vector, sizeof(scalar)))
+	    return false;
+    }
+
+    return true;
+}
+
+#endif
+
+//
+// R_InitSpans
+// Picks the span drawers of both detail levels.
+//
+void R_InitSpans (void)
+{
+    drawspanfunc = R_DrawSpan;
+    drawspanlowfunc = R_DrawSpanLow;
+
+#ifndef DG_NATIVE
+    //!
+    // @category video
+    //
+    // Use the RISC-V Vector span drawers and palette expansion when
+    // the hart has the V extension. They have not been timed on
+    // the target yet, so the scalar ones are the default.
+    //
+
+    if (!libc_has_rvv () || !M_CheckParm ("-vector"))
+	return;
+
+    if (!R_CheckSpans ())
+    {
+	printf ("R_InitSpans: vector span drawers differ from the "
+		"scalar ones, not used\n");
+	return;
+    }
+
+    drawspanfunc = R_DrawSpanVector;
+    drawspanlowfunc = R_DrawSpanLowVector;
+
+    printf ("R_InitSpans: vector span drawers\n");
+#endif
+}
+
+//
+// R_InitWallBatch
+//
+void R_InitWallBatch (void)
+{
+    //!
+    // @category video
+    //
+    // Draw wall columns one at a time instead of in groups of four
+    // (to compare their speed).
+    //
+
+    wallbatching = !M_CheckParm ("-nowallbatch");
 }
 
 //
@@ -786,8 +1306,9 @@ R_InitBuffer
     viewwindowx = (SCREENWIDTH-width) >> 1; 
 
     // Column offset. For windows.
+    // With -colmajor, columns are contiguous and rows one byte apart.
     for (i=0 ; i<width ; i++) 
-	columnofs[i] = viewwindowx + i;
+	columnofs[i] = (viewwindowx + i) * SCREENXSTEP;
 
     // Samw with base row offset.
     if (width == SCREENWIDTH) 
@@ -797,7 +1318,7 @@ R_InitBuffer
 
     // Preclaculate all row offsets.
     for (i=0 ; i<height ; i++) 
-	ylookup[i] = I_VideoBuffer + (i+viewwindowy)*SCREENWIDTH; 
+	ylookup[i] = I_VideoBuffer + (i+viewwindowy)*SCREENYSTEP; 
 } 
  
  
@@ -815,6 +1336,10 @@ void R_FillBackScreen (void)
     byte*	dest; 
     int		x;
     int		y; 
+    int		winx;
+    int		winy;
+    int		winwidth;
+    int		winheight;
     patch_t*	patch;
 
     // DOOM border patch.
@@ -841,9 +1366,11 @@ void R_FillBackScreen (void)
 
     // Allocate the background buffer if necessary
 	
+    // Column-major screens have full height columns.
     if (background_buffer == NULL)
     {
-        background_buffer = Z_Malloc(SCREENWIDTH * (SCREENHEIGHT - SBARHEIGHT),
+        background_buffer = Z_Malloc(colmajor ? SCREENWIDTH * SCREENHEIGHT
+                                     : SCREENWIDTH * (SCREENHEIGHT - SBARHEIGHT),
                                      PU_STATIC, NULL);
     }
 
@@ -853,59 +1380,59 @@ void R_FillBackScreen (void)
 	name = name1;
     
     src = W_CacheLumpName(name, PU_CACHE); 
-    dest = background_buffer;
 	 
+    // The flat is tiled in the original 320x200 coordinates:
+    //  with -hires, each of its pixels covers two by two.
     for (y=0 ; y<SCREENHEIGHT-SBARHEIGHT ; y++) 
     { 
-	for (x=0 ; x<SCREENWIDTH/64 ; x++) 
-	{ 
-	    memcpy (dest, src+((y&63)<<6), 64); 
-	    dest += 64; 
-	} 
-
-	if (SCREENWIDTH&63) 
-	{ 
-	    memcpy (dest, src+((y&63)<<6), SCREENWIDTH&63); 
-	    dest += (SCREENWIDTH&63); 
-	} 
+	dest = background_buffer + SCREENOFS(0, y);
+
+	for (x=0 ; x<SCREENWIDTH ; x++, dest += SCREENXSTEP) 
+	    *dest = src[(((y >> hires) & 63) << 6) + ((x >> hires) & 63)];
     } 
      
     // Draw screen and bezel; this is done to a separate screen buffer.
 
     V_UseBuffer(background_buffer);
 
+    // Patches are placed in the original 320x200 coordinates.
+    winx = viewwindowx >> hires;
+    winy = viewwindowy >> hires;
+    winwidth = scaledviewwidth >> hires;
+    winheight = viewheight >> hires;
+
     patch = W_CacheLumpName(DEH_String("brdr_t"),PU_CACHE);
 
-    for (x=0 ; x<scaledviewwidth ; x+=8)
-	V_DrawPatch(viewwindowx+x, viewwindowy-8, patch);
+    for (x=0 ; x<winwidth ; x+=8)
+	V_DrawPatch(winx+x, winy-8, patch);
     patch = W_CacheLumpName(DEH_String("brdr_b"),PU_CACHE);
 
-    for (x=0 ; x<scaledviewwidth ; x+=8)
-	V_DrawPatch(viewwindowx+x, viewwindowy+viewheight, patch);
+    for (x=0 ; x<winwidth ; x+=8)
+	V_DrawPatch(winx+x, winy+winheight, patch);
     patch = W_CacheLumpName(DEH_String("brdr_l"),PU_CACHE);
 
-    for (y=0 ; y<viewheight ; y+=8)
-	V_DrawPatch(viewwindowx-8, viewwindowy+y, patch);
+    for (y=0 ; y<winheight ; y+=8)
+	V_DrawPatch(winx-8, winy+y, patch);
     patch = W_CacheLumpName(DEH_String("brdr_r"),PU_CACHE);
 
-    for (y=0 ; y<viewheight ; y+=8)
-	V_DrawPatch(viewwindowx+scaledviewwidth, viewwindowy+y, patch);
+    for (y=0 ; y<winheight ; y+=8)
+	V_DrawPatch(winx+winwidth, winy+y, patch);
 
     // Draw beveled edge. 
-    V_DrawPatch(viewwindowx-8,
-                viewwindowy-8,
+    V_DrawPatch(winx-8,
+                winy-8,
                 W_CacheLumpName(DEH_String("brdr_tl"),PU_CACHE));
     
-    V_DrawPatch(viewwindowx+scaledviewwidth,
-                viewwindowy-8,
+    V_DrawPatch(winx+winwidth,
+                winy-8,
                 W_CacheLumpName(DEH_String("brdr_tr"),PU_CACHE));
     
-    V_DrawPatch(viewwindowx-8,
-                viewwindowy+viewheight,
+    V_DrawPatch(winx-8,
+                winy+winheight,
                 W_CacheLumpName(DEH_String("brdr_bl"),PU_CACHE));
     
-    V_DrawPatch(viewwindowx+scaledviewwidth,
-                viewwindowy+viewheight,
+    V_DrawPatch(winx+winwidth,
+                winy+winheight,
                 W_CacheLumpName(DEH_String("brdr_br"),PU_CACHE));
 
     V_RestoreBuffer();
@@ -914,21 +1441,49 @@ void R_FillBackScreen (void)
 
 //
 // Copy a screen buffer.
+// A box in screen pixels, copied by rows, or by columns on
+//  column-major screens.
 //
 void
 R_VideoErase
-( unsigned	ofs,
-  int		count ) 
+( int		x,
+  int		y,
+  int		width,
+  int		height ) 
 { 
+    int		ofs;
+    int		lines;
+    int		count;
+    int		step;
+
   // LFB copy.
   // This might not be a good idea if memcpy
   //  is not optiomal, e.g. byte by byte on
   //  a 32bit CPU, as GNU GCC/Linux libc did
   //  at one point.
 
-    if (background_buffer != NULL)
+    if (background_buffer == NULL)
+	return;
+
+    ofs = SCREENOFS(x, y);
+
+    if (colmajor)
+    {
+	lines = width;
+	count = height;
+	step = SCREENHEIGHT;
+    }
+    else
+    {
+	lines = height;
+	count = width;
+	step = SCREENWIDTH;
+    }
+
+    while (lines-- > 0)
     {
         memcpy(I_VideoBuffer + ofs, background_buffer + ofs, count); 
+	ofs += step;
     }
 } 
 
@@ -942,8 +1497,6 @@ void R_DrawViewBorder (void)
 { 
     int		top;
     int		side;
-    int		ofs;
-    int		i; 
  
     if (scaledviewwidth == SCREENWIDTH) 
 	return; 
@@ -951,22 +1504,13 @@ void R_DrawViewBorder (void)
     top = ((SCREENHEIGHT-SBARHEIGHT)-viewheight)/2; 
     side = (SCREENWIDTH-scaledviewwidth)/2; 
  
-    // copy top and one line of left side 
-    R_VideoErase (0, top*SCREENWIDTH+side); 
- 
-    // copy one line of right side and bottom 
-    ofs = (viewheight+top)*SCREENWIDTH-side; 
-    R_VideoErase (ofs, top*SCREENWIDTH+side); 
+    // copy top and bottom
+    R_VideoErase (0, 0, SCREENWIDTH, top); 
+    R_VideoErase (0, top+viewheight, SCREENWIDTH, top); 
  
-    // copy sides using wraparound 
-    ofs = top*SCREENWIDTH + SCREENWIDTH-side; 
-    side <<= 1;
-    
-    for (i=1 ; i<viewheight ; i++) 
-    { 
-	R_VideoErase (ofs, side); 
-	ofs += SCREENWIDTH; 
-    } 
+    // copy sides
+    R_VideoErase (0, top, side, viewheight); 
+    R_VideoErase (SCREENWIDTH-side, top, side, viewheight); 
 
     // ? 
     V_MarkRect (0,0,SCREENWIDTH, SCREENHEIGHT-SBARHEIGHT); 
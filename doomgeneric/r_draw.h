@@ -23,15 +23,21 @@
 
 
 
-extern lighttable_t*	dc_colormap;
-extern int		dc_x;
-extern int		dc_yl;
-extern int		dc_yh;
-extern fixed_t		dc_iscale;
-extern fixed_t		dc_texturemid;
+extern R_THREAD lighttable_t*	dc_colormap;
+extern R_THREAD int		dc_x;
+extern R_THREAD int		dc_yl;
+extern R_THREAD int		dc_yh;
+extern R_THREAD fixed_t		dc_iscale;
+extern R_THREAD fixed_t		dc_texturemid;
 
 // first pixel in a column
-extern byte*		dc_source;		
+extern R_THREAD byte*		dc_source;		
+
+extern R_THREAD int		fuzzpos;
+
+// view columns drawn by this hart
+extern R_THREAD int		dc_stripx1;
+extern R_THREAD int		dc_stripx2;
 
 
 // The span blitting interface.
@@ -50,27 +56,57 @@ void 	R_DrawFuzzColumnLow (void);
 void	R_DrawTranslatedColumn (void);
 void	R_DrawTranslatedColumnLow (void);
 
+// Wall columns of one tier of a seg, queued by R_RenderSegLoop
+//  and drawn WALLBATCH at a time when they have the same light
+//  level (see R_DrawColumn).
+#define WALLBATCH		4
+
+typedef struct
+{
+    int			x;		// first column
+    int			count;		// columns queued
+    lighttable_t*	colormap;
+    fixed_t		texturemid;
+    int			yl[WALLBATCH];
+    int			yh[WALLBATCH];
+    fixed_t		iscale[WALLBATCH];
+    byte*		source[WALLBATCH];
+} wallbatch_t;
+
+extern boolean		wallbatching;
+
+// Queues the column set up for colfunc.
+void	R_BatchWallColumn (wallbatch_t* batch);
+
+// Draws the columns still queued.
+void	R_FlushWallColumns (wallbatch_t* batch);
+
+// Reads -nowallbatch.
+void	R_InitWallBatch (void);
+
 void
 R_VideoErase
-( unsigned	ofs,
-  int		count );
+( int		x,
+  int		y,
+  int		width,
+  int		height );
 
-extern int		ds_y;
-extern int		ds_x1;
-extern int		ds_x2;
+extern R_THREAD int		ds_y;
+extern R_THREAD int		ds_x1;
+extern R_THREAD int		ds_x2;
 
-extern lighttable_t*	ds_colormap;
+extern R_THREAD lighttable_t*	ds_colormap;
 
-extern fixed_t		ds_xfrac;
-extern fixed_t		ds_yfrac;
-extern fixed_t		ds_xstep;
-extern fixed_t		ds_ystep;
+extern R_THREAD fixed_t		ds_xfrac;
+extern R_THREAD fixed_t		ds_yfrac;
+extern R_THREAD fixed_t		ds_xstep;
+extern R_THREAD fixed_t		ds_ystep;
 
 // start of a 64*64 tile image
-extern byte*		ds_source;		
+extern R_THREAD byte*		ds_source;		
 
 extern byte*		translationtables;
-extern byte*		dc_translation;
+extern R_THREAD byte*		dc_translation;
 
 
 // Span blitting for rows, floor/ceiling.
@@ -80,6 +116,13 @@ void 	R_DrawSpan (void);
 // Low resolution mode, 160x200?
 void 	R_DrawSpanLow (void);
 
+// R_DrawSpan and R_DrawSpanLow, or their RISC-V Vector versions.
+extern void	(*drawspanfunc) (void);
+extern void	(*drawspanlowfunc) (void);
+
+// Selects the span drawers, before the view size is set.
+void	R_InitSpans (void);
+
 
 void
 R_InitBuffer
@@ -0,0 +1,89 @@
+# RISC-V Vector (RVV 1.0) versions of the span inner loops of r_draw.c,
+# selected by R_InitSpans when 'misa' reports the V extension.
+# Each iteration steps the packed texture position of as many pixels as fit
+# in a group of 8 vector registers of 32-bit elements, then looks up the flat
+# and the colormap with indexed loads of bytes.
+# Pixels are pitch bytes apart: 1 on row-major screens, the column height on
+# column-major ones (strided stores).
+
+.option arch, +v
+
+# void R_DrawSpanPixelsRVV(byte *dest, int count, int pitch,
+#                          unsigned int position, unsigned int step,
+#                          byte *source, lighttable_t *colormap)
+# count pixels (count > 0) from the packed position, see R_DrawSpan
+.global R_DrawSpanPixelsRVV
+R_DrawSpanPixelsRVV:
+    li      t2, 0x0fc0
+    li      t3, 1
+    vsetvli t0, zero, e32, m8, ta, ma
+    vid.v   v8
+    vmul.vx v8, v8, a4              # v8: step * pixel index
+1:
+    vsetvli t0, a1, e32, m8, ta, ma
+    vadd.vx v16, v8, a3             # position of each pixel
+    vsrl.vi v24, v16, 26            # xtemp
+    vsrl.vi v16, v16, 4
+    vand.vx v16, v16, t2            # ytemp
+    vor.vv  v16, v16, v24           # spot
+    vsetvli zero, zero, e8, m2, ta, ma
+    vluxei32.v v4, (a5), v16        # source[spot]
+    vluxei8.v v6, (a6), v4          # colormap[source[spot]]
+    bne     a2, t3, 2f
+    vse8.v  v6, (a0)
+    j       3f
+2:
+    vsse8.v v6, (a0), a2
+3:
+    mulw    t1, t0, a4
+    addw    a3, a3, t1
+    mul     t1, t0, a2
+    add     a0, a0, t1
+    sub     a1, a1, t0
+    bnez    a1, 1b
+    ret
+
+# void R_DrawSpanPixelsLowRVV(byte *dest, int count, int pitch,
+#                             unsigned int position, unsigned int step,
+#                             byte *source, lighttable_t *colormap)
+# same, each pixel written twice (low detail)
+.global R_DrawSpanPixelsLowRVV
+R_DrawSpanPixelsLowRVV:
+    li      t2, 0x0fc0
+    li      t3, 1
+    slli    t5, a2, 1               # from one pair of pixels to the next
+    add     t6, a0, a2              # second pixel of each pair
+    vsetvli t0, zero, e32, m8, ta, ma
+    vid.v   v8
+    vmul.vx v8, v8, a4
+1:
+    vsetvli t0, a1, e32, m8, ta, ma
+    vadd.vx v16, v8, a3
+    vsrl.vi v24, v16, 26
+    vsrl.vi v16, v16, 4
+    vand.vx v16, v16, t2
+    vor.vv  v16, v16, v24
+    vsetvli zero, zero, e8, m2, ta, ma
+    vluxei32.v v4, (a5), v16
+    vluxei8.v v6, (a6), v4
+    bne     a2, t3, 2f
+    vsetvli zero, zero, e16, m4, ta, ma
+    vzext.vf2 v24, v6
+    li      t4, 0x0101
+    vmul.vx v24, v24, t4            # each pixel twice, as 16-bit elements
+    slli    t1, t0, 1
+    vsetvli zero, t1, e8, m4, ta, ma
+    vse8.v  v24, (a0)
+    j       3f
+2:
+    vsse8.v v6, (a0), t5
+    vsse8.v v6, (t6), t5
+3:
+    mulw    t4, t0, a4
+    addw    a3, a3, t4
+    mul     t1, t0, t5
+    add     a0, a0, t1
+    add     t6, t6, t1
+    sub     a1, a1, t0
+    bnez    a1, 1b
+    ret
@@ -41,5 +41,6 @@
 #include "r_data.h"
 #include "r_things.h"
 #include "r_draw.h"
+#include "r_snap.h"
 
 #endif		// __R_LOCAL__
@@ -23,18 +23,29 @@
 
 
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
 
 
 #include "doomdef.h"
 #include "d_loop.h"
 
+#include "i_system.h"
+#include "i_video.h"
+#include "m_argv.h"
 #include "m_bbox.h"
 #include "m_menu.h"
+#include "m_perf.h"
+#include "sha1.h"
+#include "z_zone.h"
 
 #include "r_local.h"
 #include "r_sky.h"
 
+#ifdef RENDER_SMP
+#include "smp.h"
+#endif
+
 
 
 
@@ -50,8 +61,8 @@ int			viewangleoffset;
 int			validcount = 1;		
 
 
-lighttable_t*		fixedcolormap;
-extern lighttable_t**	walllights;
+R_THREAD lighttable_t*		fixedcolormap;
+extern R_THREAD lighttable_t**	walllights;
 
 int			centerx;
 int			centery;
@@ -63,20 +74,31 @@ fixed_t			projection;
 // just for profiling purposes
 int			framecount;	
 
-int			sscount;
-int			linecount;
-int			loopcount;
+framepeaks_t		framepeaks;
+
+static framearenas_t	striparenas[MAXRENDERSTRIPS];
+R_THREAD framearenas_t*	framearenas = &striparenas[0];
+
+boolean			interpolateview;
+fixed_t			fractionaltic;
 
-fixed_t			viewx;
-fixed_t			viewy;
-fixed_t			viewz;
+// Current sector heights while interpolated ones are drawn.
+static fixed_t*		sectorheights;
 
-angle_t			viewangle;
+R_THREAD int			sscount;
+R_THREAD int			linecount;
+R_THREAD int			loopcount;
 
-fixed_t			viewcos;
-fixed_t			viewsin;
+R_THREAD fixed_t			viewx;
+R_THREAD fixed_t			viewy;
+R_THREAD fixed_t			viewz;
 
-player_t*		viewplayer;
+R_THREAD angle_t			viewangle;
+
+R_THREAD fixed_t			viewcos;
+R_THREAD fixed_t			viewsin;
+
+R_THREAD player_t*		viewplayer;
 
 // 0 = high, 1 = low
 int			detailshift;	
@@ -95,18 +117,18 @@ int			viewangletox[FINEANGLES/2];
 // The xtoviewangleangle[] table maps a screen pixel
 // to the lowest viewangle that maps back to x ranges
 // from clipangle to -clipangle.
-angle_t			xtoviewangle[SCREENWIDTH+1];
+angle_t			xtoviewangle[MAXWIDTH+1];
 
 lighttable_t*		scalelight[LIGHTLEVELS][MAXLIGHTSCALE];
-lighttable_t*		scalelightfixed[MAXLIGHTSCALE];
+R_THREAD lighttable_t*		scalelightfixed[MAXLIGHTSCALE];
 lighttable_t*		zlight[LIGHTLEVELS][MAXLIGHTZ];
 
 // bumped light from gun blasts
-int			extralight;			
+R_THREAD int			extralight;			
 
 
 
-void (*colfunc) (void);
+R_THREAD void (*colfunc) (void);
 void (*basecolfunc) (void);
 void (*fuzzcolfunc) (void);
 void (*transcolfunc) (void);
@@ -622,7 +644,7 @@ void R_InitLightTables (void)
 	startmap = ((LIGHTLEVELS-1-i)*2)*NUMCOLORMAPS/LIGHTLEVELS;
 	for (j=0 ; j<MAXLIGHTZ ; j++)
 	{
-	    scale = FixedDiv ((SCREENWIDTH/2*FRACUNIT), (j+1)<<LIGHTZSHIFT);
+	    scale = FixedDiv ((ORIGWIDTH/2*FRACUNIT), (j+1)<<LIGHTZSHIFT);
 	    scale >>= LIGHTSCALESHIFT;
 	    level = startmap - scale/DISTMAP;
 	    
@@ -682,8 +704,8 @@ void R_ExecuteSetViewSize (void)
     }
     else
     {
-	scaledviewwidth = setblocks*32;
-	viewheight = (setblocks*168/10)&~7;
+	scaledviewwidth = (setblocks*32) << hires;
+	viewheight = ((setblocks*168/10)&~7) << hires;
     }
     
     detailshift = setdetail;
@@ -700,23 +722,24 @@ void R_ExecuteSetViewSize (void)
 	colfunc = basecolfunc = R_DrawColumn;
 	fuzzcolfunc = R_DrawFuzzColumn;
 	transcolfunc = R_DrawTranslatedColumn;
-	spanfunc = R_DrawSpan;
+	spanfunc = drawspanfunc;
     }
     else
     {
 	colfunc = basecolfunc = R_DrawColumnLow;
 	fuzzcolfunc = R_DrawFuzzColumnLow;
 	transcolfunc = R_DrawTranslatedColumnLow;
-	spanfunc = R_DrawSpanLow;
+	spanfunc = drawspanlowfunc;
     }
 
     R_InitBuffer (scaledviewwidth, viewheight);
 	
     R_InitTextureMapping ();
     
-    // psprite scales
-    pspritescale = FRACUNIT*viewwidth/SCREENWIDTH;
-    pspriteiscale = FRACUNIT*SCREENWIDTH/viewwidth;
+    // psprite scales: weapon sprites are laid out in the original
+    //  320x200 coordinates, and are scaled up with -hires.
+    pspritescale = FRACUNIT*viewwidth/ORIGWIDTH;
+    pspriteiscale = FRACUNIT*ORIGWIDTH/viewwidth;
     
     // thing clipping
     for (i=0 ; i<viewwidth ; i++)
@@ -758,6 +781,87 @@ void R_ExecuteSetViewSize (void)
 
 
 
+#ifdef RENDER_SMP
+
+// Column strips rendered in parallel, one per hart ('-renderharts')
+static int		numrenderstrips = 1;
+
+// Compare each parallel frame with a single hart render ('-rendercheck')
+static boolean		rendercheck;
+static int		rendercheckframes;
+static int		rendercheckerrors;
+
+static boolean R_ReleaseViewLumps (void);
+
+static void R_PrintRenderCheck (void)
+{
+    printf ("R_RenderCheck: %d frames, %d mismatches, %d strips\n",
+	    rendercheckframes, rendercheckerrors, numrenderstrips);
+}
+
+//
+// R_InitRenderStrips
+//
+static void R_InitRenderStrips (void)
+{
+    int		p;
+
+    numrenderstrips = smp_num_harts ();
+
+    //!
+    // @arg <n>
+    // @category video
+    //
+    // Render the player view on n harts, each drawing a vertical
+    // strip of the screen. Default is all the harts available.
+    //
+
+    p = M_CheckParmWithArgs ("-renderharts", 1);
+
+    if (p > 0)
+    {
+	numrenderstrips = atoi (myargv[p+1]);
+    }
+
+    if (numrenderstrips < 1)
+	numrenderstrips = 1;
+    if (numrenderstrips > MAXRENDERSTRIPS)
+	numrenderstrips = MAXRENDERSTRIPS;
+
+    //!
+    // @category video
+    //
+    // Render every frame twice, in strips and on a single hart, and
+    // check the screen digests match. A summary is printed at exit.
+    //
+
+    rendercheck = M_CheckParm ("-rendercheck") > 0;
+
+    if (rendercheck)
+    {
+	I_AtExit (R_PrintRenderCheck, true);
+    }
+
+    Z_SetPurgeRelease (R_ReleaseViewLumps);
+
+    printf ("R_Init: rendering in %d strips\n", numrenderstrips);
+}
+
+#endif
+
+
+static void R_PrintFramePeaks (void)
+{
+    printf ("R_FramePeaks: most per frame: drawsegs [%d] vissprites [%d] "
+	    "clip ranges [%d] visplanes [%d] openings [%d], arena bytes: "
+	    "drawsegs [%d] sprites [%d] clip ranges [%d] planes [%d]\n",
+	    framepeaks.drawsegs, framepeaks.vissprites, framepeaks.clipranges,
+	    framepeaks.visplanes, framepeaks.openings,
+	    framepeaks.drawsegbytes, framepeaks.spritebytes,
+	    framepeaks.clipbytes, framepeaks.planebytes);
+}
+
+
 //
 // R_Init
 //
@@ -771,6 +875,8 @@ void R_Init (void)
     R_InitPointToAngle ();
     printf (".");
     R_InitTables ();
+    R_InitSpans ();
+    R_InitWallBatch ();
     // viewwidth / viewheight / detailLevel are set by the defaults
     printf (".");
 
@@ -784,6 +890,12 @@ void R_Init (void)
     printf (".");
 	
     framecount = 0;
+
+#ifdef RENDER_SMP
+    R_InitRenderStrips ();
+#endif
+
+    I_AtExit (R_PrintFramePeaks, true);
 }
 
 
@@ -817,20 +929,82 @@ R_PointInSubsector
 
 
 
+//
+// R_InterpolateSectors
+// Moves the floors and ceilings between their heights before
+//  and after the last tic, until R_RestoreSectors.
+//
+static void R_InterpolateSectors (void)
+{
+    sector_t*	sec;
+    int		i;
+
+    if (!interpolateview)
+	return;
+
+    if (!sectorheights)
+	sectorheights = Z_Malloc (numsectors * 2 * sizeof(fixed_t),
+				  PU_LEVEL, &sectorheights);
+
+    for (i = 0, sec = sectors; i < numsectors; i++, sec++)
+    {
+	sectorheights[i * 2] = sec->floorheight;
+	sectorheights[i * 2 + 1] = sec->ceilingheight;
+
+	sec->floorheight = sec->oldfloorheight
+	    + FixedMul (sec->floorheight - sec->oldfloorheight, fractionaltic);
+	sec->ceilingheight = sec->oldceilingheight
+	    + FixedMul (sec->ceilingheight - sec->oldceilingheight, fractionaltic);
+    }
+}
+
+static void R_RestoreSectors (void)
+{
+    sector_t*	sec;
+    int		i;
+
+    if (!interpolateview)
+	return;
+
+    for (i = 0, sec = sectors; i < numsectors; i++, sec++)
+    {
+	sec->floorheight = sectorheights[i * 2];
+	sec->ceilingheight = sectorheights[i * 2 + 1];
+    }
+}
+
+
 //
 // R_SetupFrame
 //
 void R_SetupFrame (player_t* player)
 {		
+    mobj_t*	mo;
     int		i;
     
+    mo = player->mo;
     viewplayer = player;
-    viewx = player->mo->x;
-    viewy = player->mo->y;
-    viewangle = player->mo->angle + viewangleoffset;
     extralight = player->extralight;
 
-    viewz = player->viewz;
+    if (interpolateview)
+    {
+	viewx = mo->oldx + FixedMul (mo->x - mo->oldx, fractionaltic);
+	viewy = mo->oldy + FixedMul (mo->y - mo->oldy, fractionaltic);
+	viewz = player->oldviewz
+	    + FixedMul (player->viewz - player->oldviewz, fractionaltic);
+
+	// the shortest way round
+	viewangle = mo->oldangle
+	    + FixedMul ((int) (mo->angle - mo->oldangle), fractionaltic)
+	    + viewangleoffset;
+    }
+    else
+    {
+	viewx = mo->x;
+	viewy = mo->y;
+	viewz = player->viewz;
+	viewangle = mo->angle + viewangleoffset;
+    }
     
     viewsin = finesine[viewangle>>ANGLETOFINESHIFT];
     viewcos = finecosine[viewangle>>ANGLETOFINESHIFT];
@@ -850,11 +1024,331 @@ void R_SetupFrame (player_t* player)
     }
     else
 	fixedcolormap = 0;
-		
+}
+
+
+
+#ifdef RENDER_SMP
+
+// BSP, planes and masked runs of each strip (see R_RecordStripPhases).
+static perfstamp_t	stripphases[MAXRENDERSTRIPS][3];
+
+//
+// R_RenderStrip
+// Renders the view columns of one strip out of numstrips.
+// Every strip walks the whole BSP and does all the clipping and
+//  plane bookkeeping, so that wall scales, texture steps and span
+//  starts are exactly those of a full view render: only the pixel
+//  writes are restricted to the strip by the drawers (dc_stripx1/2).
+//
+static void R_RenderStrip (player_t* player, int strip, int numstrips)
+{
+    perfstamp_t*	phases = stripphases[strip];
+
+    dc_stripx1 = (viewwidth * strip) / numstrips;
+    dc_stripx2 = (viewwidth * (strip + 1)) / numstrips - 1;
+    framearenas = &striparenas[strip];
+    R_SetSpriteStrip (strip);
+
+    R_SetupFrame (player);
+
+    // Clear buffers.
+    R_ClearClipSegs ();
+    R_ClearDrawSegs ();
+    R_ClearPlanes ();
+    R_ClearSprites ();
+
+    // The head node is the last node output.
+    M_PerfStart (&phases[0]);
+    R_RenderBSPNode (numnodes-1);
+    M_PerfLap (&phases[0]);
+
+    M_PerfStart (&phases[1]);
+    R_DrawPlanes ();
+    M_PerfLap (&phases[1]);
+
+    M_PerfStart (&phases[2]);
+    R_DrawMasked ();
+    M_PerfLap (&phases[2]);
+}
+
+//
+// R_RecordStripPhases
+// The strips run at once: each of their phases is one sample per
+//  frame, the run of the slowest strip.
+//
+static void R_RecordStripPhases (int numstrips)
+{
+    int		phase;
+    int		slowest;
+    int		i;
+
+    for (phase = 0; phase < 3; phase++)
+    {
+	slowest = 0;
+	for (i = 1; i < numstrips; i++)
+	{
+	    if (stripphases[i][phase].time > stripphases[slowest][phase].time)
+		slowest = i;
+	}
+	M_PerfRecord (perf_bsp + phase, &stripphases[slowest][phase]);
+    }
+}
+
+
+static int		stripfuzzpos;
+
+// Render jobs running on this hart (see R_ReleaseViewLumps).
+static R_THREAD int	renderjobs;
+
+static void R_RenderStripJob (void *arg, int index)
+{
+    renderjobs++;
+
+    // Same drawer state at the start of every strip as a full render.
+    colfunc = basecolfunc;
+    fuzzpos = stripfuzzpos;
+
+    R_RenderStrip (arg, index, numrenderstrips);
+    renderjobs--;
+
+    // Skipped fuzz columns are stepped over, so all strips end
+    //  with the same fuzz position.
+    if (index == 0)
+	stripfuzzpos = fuzzpos;
+}
+
+//
+// R_ReserveArenas
+// Makes room in the arenas of every strip for twice the most a strip
+//  has needed so far, before the harts render them: they allocate
+//  from the zone, where they cannot purge, only if a frame needs more.
+// Returns false until a frame has been rendered: the view is then
+//  rendered as one strip by the calling hart.
+//
+static boolean R_ReserveArenas (void)
+{
+    size_t	drawsegs = 0;
+    size_t	clipranges = 0;
+    size_t	planes = 0;
+    size_t	sprites = 0;
+    int		i;
+
+    for (i = 0; i < MAXRENDERSTRIPS; i++)
+    {
+	if (striparenas[i].drawsegs.peak > drawsegs)
+	    drawsegs = striparenas[i].drawsegs.peak;
+	if (striparenas[i].clipranges.peak > clipranges)
+	    clipranges = striparenas[i].clipranges.peak;
+	if (striparenas[i].planes.peak > planes)
+	    planes = striparenas[i].planes.peak;
+	if (striparenas[i].sprites.peak > sprites)
+	    sprites = striparenas[i].sprites.peak;
+    }
+
+    if (drawsegs == 0)
+	return false;
+
+    for (i = 0; i < numrenderstrips; i++)
+    {
+	Z_ArenaReserve (&striparenas[i].drawsegs, 2 * drawsegs);
+	Z_ArenaReserve (&striparenas[i].clipranges, 2 * clipranges);
+	Z_ArenaReserve (&striparenas[i].planes, 2 * planes);
+	Z_ArenaReserve (&striparenas[i].sprites, 2 * sprites);
+    }
+
+    return true;
+}
+
+static void R_RenderStrips (player_t* player)
+{
+    // The calling hart keeps its view variables up to date.
+    R_SetupFrame (player);
+    R_InitSpriteStrips (numrenderstrips);
+
+    stripfuzzpos = fuzzpos;
+
+    // Lumps cached by a hart must stay in memory until all are done.
+    Z_SetPurgeLock (true);
+    smp_parallel_for (R_RenderStripJob, player, numrenderstrips);
+    Z_SetPurgeLock (false);
+    R_RecordStripPhases (numrenderstrips);
+
+    fuzzpos = stripfuzzpos;
+    dc_stripx1 = 0;
+    dc_stripx2 = viewwidth - 1;
+}
+
+static void R_ScreenDigest (sha1_digest_t digest)
+{
+    sha1_context_t	context;
+
+    SHA1_Init (&context);
+    SHA1_Update (&context, I_VideoBuffer, SCREENWIDTH * SCREENHEIGHT);
+    SHA1_Final (digest, &context);
+}
+
+//
+// R_RenderCheck
+// Renders the frame in strips then again on hart 0 alone,
+//  and compares the screen digests: they must be identical.
+//
+static void R_RenderCheck (player_t* player)
+{
+    sha1_digest_t	parallel;
+    sha1_digest_t	single;
+    int			startfuzzpos;
+
+    startfuzzpos = fuzzpos;
+    R_RenderStrips (player);
+    R_ScreenDigest (parallel);
+
+    // New frame number: sprites are added again.
+    framecount++;
+    fuzzpos = startfuzzpos;
+    R_InitSpriteStrips (1);
+    R_RenderStrip (player, 0, 1);
+    R_ScreenDigest (single);
+
+    rendercheckframes++;
+    if (memcmp (parallel, single, sizeof(sha1_digest_t)))
+    {
+	rendercheckerrors++;
+	printf ("R_RenderCheck: frame %d differs from single hart render\n",
+		framecount);
+    }
+}
+
+
+//
+// Background view rendering
+// The view of a world snapshot is rendered by other harts while
+//  hart 0 runs the next tics (see D_Display).
+//
+static smp_task_t	viewtask;
+static boolean		viewpending;	// started and not waited for
+static boolean		viewrendered;	// not yet taken by R_FinishPlayerView
+static int		viewstrips;
+static int		viewfuzzpos;
+
+static void R_RenderViewJob (void *arg, int index)
+{
+    perfstamp_t	perfstart;
+
+    renderjobs++;
+    M_PerfStart (&perfstart);
+    colfunc = basecolfunc;
+    fuzzpos = viewfuzzpos;
     framecount++;
-    validcount++;
+
+    if (viewstrips > 1)
+	R_RenderStrips (arg);
+    else
+    {
+	R_InitSpriteStrips (1);
+	R_RenderStrip (arg, 0, 1);
+	R_RecordStripPhases (1);
+	dc_stripx1 = 0;
+	dc_stripx2 = viewwidth - 1;
+    }
+
+    viewfuzzpos = fuzzpos;
+    M_PerfStop (perf_render, &perfstart);
+    renderjobs--;
+}
+
+//
+// R_StartPlayerView
+// Snapshots the world and renders it into the view window
+//  in the background.
+//
+void R_StartPlayerView (player_t* player)
+{
+    player_t*	snapshot;
+
+    R_FinishPlayerView ();
+
+    snapshot = R_SnapshotWorld (player);
+
+    if (!R_ReserveArenas ())
+    {
+	// Nothing yet to size the arenas by: render the view here.
+	viewstrips = 1;
+	R_RenderViewJob (snapshot, 0);
+	viewrendered = true;
+	return;
+    }
+
+    // Lumps cached for the view must stay until it is done; if the
+    //  game loop runs out of memory meanwhile it waits for the view
+    //  (R_ReleaseViewLumps).
+    Z_SetPurgeLock (true);
+    viewpending = true;
+    viewstrips = numrenderstrips;
+    smp_submit (&viewtask, R_RenderViewJob, snapshot);
+}
+
+//
+// R_WaitPlayerView
+// Waits for the view started by R_StartPlayerView, if any,
+//  and releases the lumps it kept.
+//
+static void R_WaitPlayerView (void)
+{
+    if (!viewpending)
+	return;
+
+    smp_wait (&viewtask);
+    Z_SetPurgeLock (false);
+    viewpending = false;
+    viewrendered = true;
+}
+
+//
+// R_FinishPlayerView
+// Waits for the view started by R_StartPlayerView.
+// Returns false if none was started since the last call.
+//
+boolean R_FinishPlayerView (void)
+{
+    boolean	rendered;
+
+    R_WaitPlayerView ();
+    rendered = viewrendered;
+    viewrendered = false;
+
+    return rendered;
 }
 
+//
+// R_ReleaseViewLumps
+// Called by Z_Malloc when the zone is full of lumps kept for the
+//  view rendered in the background: the game loop waits for the
+//  view instead of failing. The harts rendering it cannot wait for
+//  themselves, their allocations still fail.
+//
+static boolean R_ReleaseViewLumps (void)
+{
+    if (!viewpending || renderjobs > 0)
+	return false;
+
+    R_WaitPlayerView ();
+
+    return true;
+}
+
+//
+// R_ViewStageTimes
+// Time spent rendering in the background and waiting for it,
+//  in mtime ticks.
+//
+void R_ViewStageTimes (uint64_t* busy, uint64_t* stall)
+{
+    *busy = viewtask.busy;
+    *stall = viewtask.stall;
+}
+
+#endif
 
 
 //
@@ -862,6 +1356,39 @@ void R_SetupFrame (player_t* player)
 //
 void R_RenderPlayerView (player_t* player)
 {	
+    perfstamp_t	perfstart;
+    perfstamp_t	phasestart;
+
+    M_PerfStart (&perfstart);
+    framecount++;
+    R_UseLiveWorld ();
+    R_InterpolateSectors ();
+
+#ifdef RENDER_SMP
+    if (numrenderstrips > 1 && R_ReserveArenas ())
+    {
+	// check for new console commands.
+	NetUpdate ();
+
+	if (rendercheck)
+	    R_RenderCheck (player);
+	else
+	    R_RenderStrips (player);
+
+	// Check for new console commands.
+	NetUpdate ();
+	R_RestoreSectors ();
+	M_PerfStop (perf_render, &perfstart);
+	return;
+    }
+#endif
+
+    dc_stripx1 = 0;
+    dc_stripx2 = viewwidth - 1;
+    framearenas = &striparenas[0];
+    R_InitSpriteStrips (1);
+    R_SetSpriteStrip (0);
+
     R_SetupFrame (player);
 
     // Clear buffers.
@@ -874,18 +1401,27 @@ void R_RenderPlayerView (player_t* player)
     NetUpdate ();
 
     // The head node is the last node output.
+    M_PerfStart (&phasestart);
     R_RenderBSPNode (numnodes-1);
+    M_PerfStop (perf_bsp, &phasestart);
     
     // Check for new console commands.
     NetUpdate ();
     
+    M_PerfStart (&phasestart);
     R_DrawPlanes ();
+    M_PerfStop (perf_planes, &phasestart);
     
     // Check for new console commands.
     NetUpdate ();
     
+    M_PerfStart (&phasestart);
     R_DrawMasked ();
+    M_PerfStop (perf_masked, &phasestart);
 
     // Check for new console commands.
     NetUpdate ();				
+
+    R_RestoreSectors ();
+    M_PerfStop (perf_render, &perfstart);
 }
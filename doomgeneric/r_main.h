@@ -22,6 +22,7 @@
 
 #include "d_player.h"
 #include "r_data.h"
+#include "z_zone.h"
 
 
 
@@ -29,8 +30,8 @@
 //
 // POV related.
 //
-extern fixed_t		viewcos;
-extern fixed_t		viewsin;
+extern R_THREAD fixed_t		viewcos;
+extern R_THREAD fixed_t		viewsin;
 
 extern int		viewwindowx;
 extern int		viewwindowy;
@@ -46,8 +47,61 @@ extern fixed_t		projection;
 
 extern int		validcount;
 
-extern int		linecount;
-extern int		loopcount;
+// frames rendered so far
+extern int		framecount;
+
+// The view is drawn fractionaltic of the way from the positions
+//  before the last tic to the current ones (-uncapped).
+extern boolean		interpolateview;
+extern fixed_t		fractionaltic;
+
+// at most one view strip per hart (see R_RenderPlayerView)
+#define MAXRENDERSTRIPS		8
+
+// Memory arenas of one view strip, emptied at the start of every
+//  frame (see R_ReserveArenas).
+typedef struct
+{
+    arena_t	drawsegs;
+    arena_t	clipranges;
+    arena_t	planes;
+    arena_t	sprites;
+
+} framearenas_t;
+
+// Arenas of the strip rendered by this hart.
+extern R_THREAD framearenas_t*	framearenas;
+
+// Most storage a frame has needed so far (high-watermarks), printed
+//  at exit. Bytes are those of the arenas of one strip.
+typedef struct
+{
+    int		drawsegs;
+    int		vissprites;
+    int		clipranges;
+    int		visplanes;
+    int		openings;
+
+    int		drawsegbytes;
+    int		spritebytes;
+    int		clipbytes;
+    int		planebytes;
+
+} framepeaks_t;
+
+extern framepeaks_t	framepeaks;
+
+// Raises a high-watermark of framepeaks. Every view strip has the
+//  same drawsegs, sprites and planes: only the first one counts.
+#define R_FramePeak(peak, value)					\
+    do									\
+    {									\
+	if (dc_stripx1 == 0 && (int) (value) > (peak))			\
+	    (peak) = (value);						\
+    } while (0)
+
+extern R_THREAD int		linecount;
+extern R_THREAD int		loopcount;
 
 
 //
@@ -67,11 +121,11 @@ extern int		loopcount;
 #define LIGHTZSHIFT		20
 
 extern lighttable_t*	scalelight[LIGHTLEVELS][MAXLIGHTSCALE];
-extern lighttable_t*	scalelightfixed[MAXLIGHTSCALE];
+extern R_THREAD lighttable_t*	scalelightfixed[MAXLIGHTSCALE];
 extern lighttable_t*	zlight[LIGHTLEVELS][MAXLIGHTZ];
 
-extern int		extralight;
-extern lighttable_t*	fixedcolormap;
+extern R_THREAD int		extralight;
+extern R_THREAD lighttable_t*	fixedcolormap;
 
 
 // Number of diminishing brightness levels.
@@ -89,7 +143,7 @@ extern	int		detailshift;
 // Function pointers to switch refresh/drawing functions.
 // Used to select shadow mode etc.
 //
-extern void		(*colfunc) (void);
+extern R_THREAD void		(*colfunc) (void);
 extern void		(*transcolfunc) (void);
 extern void		(*basecolfunc) (void);
 extern void		(*fuzzcolfunc) (void);
@@ -151,6 +205,14 @@ R_AddPointToBox
 // Called by G_Drawer.
 void R_RenderPlayerView (player_t *player);
 
+#ifdef RENDER_SMP
+// Pipelined display: the view is rendered in the
+//  background while the next tics run.
+void R_StartPlayerView (player_t *player);
+boolean R_FinishPlayerView (void);
+void R_ViewStageTimes (uint64_t *busy, uint64_t *stall);
+#endif
+
 // Called by startup code.
 void R_Init (void);
 
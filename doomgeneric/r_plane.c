@@ -41,17 +41,24 @@ planefunction_t		ceilingfunc;
 // opening
 //
 
+
 // Here comes the obnoxious "visplane".
-#define MAXVISPLANES	128
-visplane_t		visplanes[MAXVISPLANES];
-visplane_t*		lastvisplane;
-visplane_t*		floorplane;
-visplane_t*		ceilingplane;
+// All planes of the frame in creation order, and chained by
+//  height, flat and light level, also in creation order.
+#define VISPLANEHASH	128
+#define R_VisplaneHash(height, picnum, lightlevel)			\
+    (((unsigned) (height) >> FRACBITS) * 7				\
+     + (unsigned) (picnum) * 3 + (unsigned) (lightlevel))
+
+R_THREAD visplane_t*		visplanes;
+R_THREAD visplane_t*		lastvisplane;
+R_THREAD visplane_t*		visplanehash[VISPLANEHASH];
+R_THREAD int			numvisplanes;
+R_THREAD int			numopenings;
+R_THREAD visplane_t*		floorplane;
+R_THREAD visplane_t*		ceilingplane;
 
-// ?
-#define MAXOPENINGS	SCREENWIDTH*64
-short			openings[MAXOPENINGS];
-short*			lastopening;
+planestats_t			planestats;
 
 
 //
@@ -59,31 +66,31 @@ short*			lastopening;
 //  floorclip starts out SCREENHEIGHT
 //  ceilingclip starts out -1
 //
-short			floorclip[SCREENWIDTH];
-short			ceilingclip[SCREENWIDTH];
+R_THREAD short			floorclip[MAXWIDTH];
+R_THREAD short			ceilingclip[MAXWIDTH];
 
 //
 // spanstart holds the start of a plane span
 // initialized to 0 at start
 //
-int			spanstart[SCREENHEIGHT];
-int			spanstop[SCREENHEIGHT];
+R_THREAD int			spanstart[MAXHEIGHT];
+R_THREAD int			spanstop[MAXHEIGHT];
 
 //
 // texture mapping
 //
-lighttable_t**		planezlight;
-fixed_t			planeheight;
+R_THREAD lighttable_t**		planezlight;
+R_THREAD fixed_t			planeheight;
 
-fixed_t			yslope[SCREENHEIGHT];
-fixed_t			distscale[SCREENWIDTH];
-fixed_t			basexscale;
-fixed_t			baseyscale;
+fixed_t			yslope[MAXHEIGHT];
+fixed_t			distscale[MAXWIDTH];
+R_THREAD fixed_t			basexscale;
+R_THREAD fixed_t			baseyscale;
 
-fixed_t			cachedheight[SCREENHEIGHT];
-fixed_t			cacheddistance[SCREENHEIGHT];
-fixed_t			cachedxstep[SCREENHEIGHT];
-fixed_t			cachedystep[SCREENHEIGHT];
+R_THREAD fixed_t			cachedheight[MAXHEIGHT];
+R_THREAD fixed_t			cacheddistance[MAXHEIGHT];
+R_THREAD fixed_t			cachedxstep[MAXHEIGHT];
+R_THREAD fixed_t			cachedystep[MAXHEIGHT];
 
 
 
@@ -131,6 +138,11 @@ R_MapPlane
     }
 #endif
 
+    // Nothing to draw in this strip. The distance cache only
+    //  depends on planeheight, it can be left as is.
+    if (x2 < dc_stripx1 || x1 > dc_stripx2)
+	return;
+
     if (planeheight != cachedheight[y])
     {
 	cachedheight[y] = planeheight;
@@ -187,8 +199,15 @@ void R_ClearPlanes (void)
 	ceilingclip[i] = -1;
     }
 
-    lastvisplane = visplanes;
-    lastopening = openings;
+    R_FramePeak (framepeaks.openings, numopenings);
+    R_FramePeak (framepeaks.planebytes, framearenas->planes.peak);
+
+    Z_ArenaReset (&framearenas->planes);
+    memset (visplanehash, 0, sizeof(visplanehash));
+    visplanes = NULL;
+    lastvisplane = NULL;
+    numvisplanes = 0;
+    numopenings = 0;
     
     // texture calculation
     memset (cachedheight, 0, sizeof(cachedheight));
@@ -204,6 +223,75 @@ void R_ClearPlanes (void)
 
 
 
+//
+// R_AllocOpenings
+// Clipping lists kept for the masked walls and the sprites.
+//
+short* R_AllocOpenings (int count)
+{
+    numopenings += count;
+
+    return Z_ArenaAlloc (&framearenas->planes, count * sizeof(short));
+}
+
+
+//
+// R_NewPlane
+// Columns and rows are left empty.
+//
+static visplane_t*
+R_NewPlane
+( fixed_t	height,
+  int		picnum,
+  int		lightlevel )
+{
+    visplane_t*		pl;
+    visplane_t**	link;
+    int			columns;
+
+    columns = viewwidth + 2;
+    pl = Z_ArenaAlloc (&framearenas->planes, sizeof(visplane_t)
+			+ 2 * columns * sizeof(unsigned short));
+
+    pl->height = height;
+    pl->picnum = picnum;
+    pl->lightlevel = lightlevel;
+    pl->minx = SCREENWIDTH;
+    pl->maxx = -1;
+    pl->top = (unsigned short *) (pl + 1) + 1;
+    pl->bottom = pl->top + columns;
+
+    // Bottoms are only read where the top is 0xffff, but must not
+    //  be 0xffff themselves (see R_MakeSpans): the memory may have
+    //  held tops the frame before.
+    memset (pl->top,0xff,viewwidth*sizeof(*pl->top));
+    memset (pl->bottom-1,0,columns*sizeof(*pl->bottom));
+
+    // After the planes with the same hash: R_FindPlane returns
+    //  the first one created, as the linear search did.
+    pl->hashnext = NULL;
+    link = &visplanehash[R_VisplaneHash (height, picnum, lightlevel)
+			 & (VISPLANEHASH - 1)];
+
+    while (*link != NULL)
+	link = &(*link)->hashnext;
+
+    *link = pl;
+
+    pl->next = NULL;
+
+    if (lastvisplane != NULL)
+	lastvisplane->next = pl;
+    else
+	visplanes = pl;
+
+    lastvisplane = pl;
+    numvisplanes++;
+
+    return pl;
+}
+
+
 //
 // R_FindPlane
 //
@@ -221,34 +309,20 @@ R_FindPlane
 	lightlevel = 0;
     }
 	
-    for (check=visplanes; check<lastvisplane; check++)
+    for (check = visplanehash[R_VisplaneHash (height, picnum, lightlevel)
+			      & (VISPLANEHASH - 1)];
+	 check != NULL;
+	 check = check->hashnext)
     {
 	if (height == check->height
 	    && picnum == check->picnum
 	    && lightlevel == check->lightlevel)
 	{
-	    break;
+	    return check;
 	}
     }
-    
-			
-    if (check < lastvisplane)
-	return check;
-		
-    if (lastvisplane - visplanes == MAXVISPLANES)
-	I_Error ("R_FindPlane: no more visplanes");
-		
-    lastvisplane++;
 
-    check->height = height;
-    check->picnum = picnum;
-    check->lightlevel = lightlevel;
-    check->minx = SCREENWIDTH;
-    check->maxx = -1;
-    
-    memset (check->top,0xff,sizeof(check->top));
-		
-    return check;
+    return R_NewPlane (height, picnum, lightlevel);
 }
 
 
@@ -290,7 +364,7 @@ R_CheckPlane
     }
 
     for (x=intrl ; x<= intrh ; x++)
-	if (pl->top[x] != 0xff)
+	if (pl->top[x] != 0xffff)
 	    break;
 
     if (x > intrh)
@@ -303,16 +377,10 @@ R_CheckPlane
     }
 	
     // make a new visplane
-    lastvisplane->height = pl->height;
-    lastvisplane->picnum = pl->picnum;
-    lastvisplane->lightlevel = pl->lightlevel;
-    
-    pl = lastvisplane++;
+    pl = R_NewPlane (pl->height, pl->picnum, pl->lightlevel);
     pl->minx = start;
     pl->maxx = stop;
 
-    memset (pl->top,0xff,sizeof(pl->top));
-		
     return pl;
 }
 
@@ -366,21 +434,19 @@ void R_DrawPlanes (void)
     int			angle;
     int                 lumpnum;
 				
-#ifdef RANGECHECK
-    if (ds_p - drawsegs > MAXDRAWSEGS)
-	I_Error ("R_DrawPlanes: drawsegs overflow (%i)",
-		 ds_p - drawsegs);
-    
-    if (lastvisplane - visplanes > MAXVISPLANES)
-	I_Error ("R_DrawPlanes: visplane overflow (%i)",
-		 lastvisplane - visplanes);
-    
-    if (lastopening - openings > MAXOPENINGS)
-	I_Error ("R_DrawPlanes: opening overflow (%i)",
-		 lastopening - openings);
-#endif
+    // Every strip has all the planes of the view: counted once.
+    if (dc_stripx1 == 0)
+    {
+	planestats.frames++;
+	planestats.visplanes += numvisplanes;
+
+	if (numvisplanes > planestats.maxvisplanes)
+	    planestats.maxvisplanes = numvisplanes;
+    }
+
+    R_FramePeak (framepeaks.visplanes, numvisplanes);
 
-    for (pl = visplanes ; pl < lastvisplane ; pl++)
+    for (pl = visplanes ; pl != NULL ; pl = pl->next)
     {
 	if (pl->minx > pl->maxx)
 	    continue;
@@ -402,7 +468,7 @@ void R_DrawPlanes (void)
 		dc_yl = pl->top[x];
 		dc_yh = pl->bottom[x];
 
-		if (dc_yl <= dc_yh)
+		if (dc_yl <= dc_yh && x >= dc_stripx1 && x <= dc_stripx2)
 		{
 		    angle = (viewangle + xtoviewangle[x])>>ANGLETOSKYSHIFT;
 		    dc_x = x;
@@ -414,7 +480,7 @@ void R_DrawPlanes (void)
 	}
 	
 	// regular flat
-        lumpnum = firstflat + flattranslation[pl->picnum];
+        lumpnum = firstflat + renderflattranslation[pl->picnum];
 	ds_source = W_CacheLumpNum(lumpnum, PU_STATIC);
 	
 	planeheight = abs(pl->height-viewz);
@@ -428,8 +494,8 @@ void R_DrawPlanes (void)
 
 	planezlight = zlight[light];
 
-	pl->top[pl->maxx+1] = 0xff;
-	pl->top[pl->minx-1] = 0xff;
+	pl->top[pl->maxx+1] = 0xffff;
+	pl->top[pl->minx-1] = 0xffff;
 		
 	stop = pl->maxx + 1;
 
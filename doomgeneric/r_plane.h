@@ -25,8 +25,19 @@
 
 
 
-// Visplane related.
-extern  short*		lastopening;
+// Visplanes of the frames drawn since the counts were cleared.
+typedef struct
+{
+    int		frames;
+    int64_t	visplanes;
+    int		maxvisplanes;
+
+} planestats_t;
+
+extern planestats_t	planestats;
+
+// Visplanes of the frame being drawn.
+extern R_THREAD int	numvisplanes;
 
 
 typedef void (*planefunction_t) (int top, int bottom);
@@ -34,11 +45,11 @@ typedef void (*planefunction_t) (int top, int bottom);
 extern planefunction_t	floorfunc;
 extern planefunction_t	ceilingfunc_t;
 
-extern short		floorclip[SCREENWIDTH];
-extern short		ceilingclip[SCREENWIDTH];
+extern R_THREAD short		floorclip[MAXWIDTH];
+extern R_THREAD short		ceilingclip[MAXWIDTH];
 
-extern fixed_t		yslope[SCREENHEIGHT];
-extern fixed_t		distscale[SCREENWIDTH];
+extern fixed_t		yslope[MAXHEIGHT];
+extern fixed_t		distscale[MAXWIDTH];
 
 void R_InitPlanes (void);
 void R_ClearPlanes (void);
@@ -71,6 +82,9 @@ R_CheckPlane
   int		start,
   int		stop );
 
+// count clip values that stay valid until the end of the frame.
+short* R_AllocOpenings (int count);
+
 
 
 #endif
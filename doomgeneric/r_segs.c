@@ -36,56 +36,61 @@
 // OPTIMIZE: closed two sided lines as single sided
 
 // True if any of the segs textures might be visible.
-boolean		segtextured;	
+R_THREAD boolean		segtextured;	
 
 // False if the back side is the same plane.
-boolean		markfloor;	
-boolean		markceiling;
+R_THREAD boolean		markfloor;	
+R_THREAD boolean		markceiling;
 
-boolean		maskedtexture;
-int		toptexture;
-int		bottomtexture;
-int		midtexture;
+R_THREAD boolean		maskedtexture;
+R_THREAD int		toptexture;
+R_THREAD int		bottomtexture;
+R_THREAD int		midtexture;
 
 
-angle_t		rw_normalangle;
+R_THREAD angle_t		rw_normalangle;
 // angle to line origin
-int		rw_angle1;	
+R_THREAD int		rw_angle1;	
 
 //
 // regular wall
 //
-int		rw_x;
-int		rw_stopx;
-angle_t		rw_centerangle;
-fixed_t		rw_offset;
-fixed_t		rw_distance;
-fixed_t		rw_scale;
-fixed_t		rw_scalestep;
-fixed_t		rw_midtexturemid;
-fixed_t		rw_toptexturemid;
-fixed_t		rw_bottomtexturemid;
+R_THREAD int		rw_x;
+R_THREAD int		rw_stopx;
+R_THREAD angle_t		rw_centerangle;
+R_THREAD fixed_t		rw_offset;
+R_THREAD fixed_t		rw_distance;
+R_THREAD fixed_t		rw_scale;
+R_THREAD fixed_t		rw_scalestep;
+R_THREAD fixed_t		rw_midtexturemid;
+R_THREAD fixed_t		rw_toptexturemid;
+R_THREAD fixed_t		rw_bottomtexturemid;
 
-int		worldtop;
-int		worldbottom;
-int		worldhigh;
-int		worldlow;
+R_THREAD int		worldtop;
+R_THREAD int		worldbottom;
+R_THREAD int		worldhigh;
+R_THREAD int		worldlow;
 
-fixed_t		pixhigh;
-fixed_t		pixlow;
-fixed_t		pixhighstep;
-fixed_t		pixlowstep;
+R_THREAD fixed_t		pixhigh;
+R_THREAD fixed_t		pixlow;
+R_THREAD fixed_t		pixhighstep;
+R_THREAD fixed_t		pixlowstep;
 
-fixed_t		topfrac;
-fixed_t		topstep;
+// wall columns of each tier waiting to be drawn
+static R_THREAD wallbatch_t	midbatch;
+static R_THREAD wallbatch_t	topbatch;
+static R_THREAD wallbatch_t	bottombatch;
 
-fixed_t		bottomfrac;
-fixed_t		bottomstep;
+R_THREAD fixed_t		topfrac;
+R_THREAD fixed_t		topstep;
 
+R_THREAD fixed_t		bottomfrac;
+R_THREAD fixed_t		bottomstep;
 
-lighttable_t**	walllights;
 
-short*		maskedtexturecol;
+R_THREAD lighttable_t**	walllights;
+
+R_THREAD short*		maskedtexturecol;
 
 
 
@@ -108,9 +113,9 @@ R_RenderMaskedSegRange
     //   for horizontal / vertical / diagonal. Diagonal?
     // OPTIMIZE: get rid of LIGHTSEGSHIFT globally
     curline = ds->curline;
-    frontsector = curline->frontsector;
-    backsector = curline->backsector;
-    texnum = texturetranslation[curline->sidedef->midtexture];
+    frontsector = R_RenderSector (curline->frontsector);
+    backsector = R_RenderSector (curline->backsector);
+    texnum = rendertexturetranslation[R_RenderSide (curline->sidedef)->midtexture];
 	
     lightnum = (frontsector->lightlevel >> LIGHTSEGSHIFT)+extralight;
 
@@ -146,11 +151,20 @@ R_RenderMaskedSegRange
 	    ? frontsector->ceilingheight : backsector->ceilingheight;
 	dc_texturemid = dc_texturemid - viewz;
     }
-    dc_texturemid += curline->sidedef->rowoffset;
+    dc_texturemid += R_RenderSide (curline->sidedef)->rowoffset;
 			
     if (fixedcolormap)
 	dc_colormap = fixedcolormap;
     
+    // only columns in the strip are drawn
+    if (x1 < dc_stripx1)
+    {
+	spryscale += (dc_stripx1 - x1)*rw_scalestep;
+	x1 = dc_stripx1;
+    }
+    if (x2 > dc_stripx2)
+	x2 = dc_stripx2;
+
     // draw the columns
     for (dc_x = x1 ; dc_x <= x2 ; dc_x++)
     {
@@ -159,7 +173,7 @@ R_RenderMaskedSegRange
 	{
 	    if (!fixedcolormap)
 	    {
-		index = spryscale>>LIGHTSCALESHIFT;
+		index = spryscale>>(LIGHTSCALESHIFT+hires);
 
 		if (index >=  MAXLIGHTSCALE )
 		    index = MAXLIGHTSCALE-1;
@@ -185,6 +199,22 @@ R_RenderMaskedSegRange
 
 
 
+//
+// R_FlushWallBatches
+// Draws the wall columns queued by R_RenderSegLoop. Their texture
+//  columns are in cached patches and composites, which allocating
+//  may purge: R_GetColumn calls this before it can allocate.
+//
+void R_FlushWallBatches (void)
+{
+    R_FlushWallColumns (&midbatch);
+    R_FlushWallColumns (&topbatch);
+    R_FlushWallColumns (&bottombatch);
+}
+
+
+
+
 //
 // R_RenderSegLoop
 // Draws zero, one, or two textures (and possibly a masked
@@ -206,9 +236,14 @@ void R_RenderSegLoop (void)
     fixed_t		texturecolumn;
     int			top;
     int			bottom;
+    boolean		instrip;
 
     for ( ; rw_x < rw_stopx ; rw_x++)
     {
+	// clipping is done for the whole view, texture
+	//  columns are only fetched in the strip drawn
+	instrip = rw_x >= dc_stripx1 && rw_x <= dc_stripx2;
+
 	// mark floor / ceiling areas
 	yl = (topfrac+HEIGHTUNIT-1)>>HEIGHTBITS;
 
@@ -249,15 +284,16 @@ void R_RenderSegLoop (void)
 	    }
 	}
 	
-	// texturecolumn and lighting are independent of wall tiers
-	if (segtextured)
+	// texturecolumn and lighting are independent of wall tiers,
+	//  and only needed for columns in the strip
+	if (segtextured && instrip)
 	{
 	    // calculate texture offset
 	    angle = (rw_centerangle + xtoviewangle[rw_x])>>ANGLETOFINESHIFT;
 	    texturecolumn = rw_offset-FixedMul(finetangent[angle],rw_distance);
 	    texturecolumn >>= FRACBITS;
 	    // calculate lighting
-	    index = rw_scale>>LIGHTSCALESHIFT;
+	    index = rw_scale>>(LIGHTSCALESHIFT+hires);
 
 	    if (index >=  MAXLIGHTSCALE )
 		index = MAXLIGHTSCALE-1;
@@ -280,8 +316,11 @@ void R_RenderSegLoop (void)
 	    dc_yl = yl;
 	    dc_yh = yh;
 	    dc_texturemid = rw_midtexturemid;
-	    dc_source = R_GetColumn(midtexture,texturecolumn);
-	    colfunc ();
+	    if (instrip)
+	    {
+		dc_source = R_GetColumn(midtexture,texturecolumn);
+		R_BatchWallColumn (&midbatch);
+	    }
 	    ceilingclip[rw_x] = viewheight;
 	    floorclip[rw_x] = -1;
 	}
@@ -302,8 +341,11 @@ void R_RenderSegLoop (void)
 		    dc_yl = yl;
 		    dc_yh = mid;
 		    dc_texturemid = rw_toptexturemid;
-		    dc_source = R_GetColumn(toptexture,texturecolumn);
-		    colfunc ();
+		    if (instrip)
+		    {
+			dc_source = R_GetColumn(toptexture,texturecolumn);
+			R_BatchWallColumn (&topbatch);
+		    }
 		    ceilingclip[rw_x] = mid;
 		}
 		else
@@ -331,9 +373,12 @@ void R_RenderSegLoop (void)
 		    dc_yl = mid;
 		    dc_yh = yh;
 		    dc_texturemid = rw_bottomtexturemid;
-		    dc_source = R_GetColumn(bottomtexture,
-					    texturecolumn);
-		    colfunc ();
+		    if (instrip)
+		    {
+			dc_source = R_GetColumn(bottomtexture,
+						texturecolumn);
+			R_BatchWallColumn (&bottombatch);
+		    }
 		    floorclip[rw_x] = mid;
 		}
 		else
@@ -358,6 +403,8 @@ void R_RenderSegLoop (void)
 	topfrac += topstep;
 	bottomfrac += bottomstep;
     }
+
+    R_FlushWallBatches ();
 }
 
 
@@ -378,17 +425,17 @@ R_StoreWallRange
     angle_t		distangle, offsetangle;
     fixed_t		vtop;
     int			lightnum;
+    short*		openings;
 
-    // don't overflow and crash
-    if (ds_p == &drawsegs[MAXDRAWSEGS])
-	return;		
+    if (ds_p == drawsegs + maxdrawsegs)
+	R_GrowDrawSegs ();
 		
 #ifdef RANGECHECK
     if (start >=viewwidth || start > stop)
 	I_Error ("Bad R_RenderWallRange: %i to %i", start , stop);
 #endif
     
-    sidedef = curline->sidedef;
+    sidedef = R_RenderSide (curline->sidedef);
     linedef = curline->linedef;
 
     // mark the segment as visible for auto map
@@ -453,7 +500,7 @@ R_StoreWallRange
     if (!backsector)
     {
 	// single sided line
-	midtexture = texturetranslation[sidedef->midtexture];
+	midtexture = rendertexturetranslation[sidedef->midtexture];
 	// a single sided line is terminal, so it must mark ends
 	markfloor = markceiling = true;
 	if (linedef->flags & ML_DONTPEGBOTTOM)
@@ -567,7 +614,7 @@ R_StoreWallRange
 	if (worldhigh < worldtop)
 	{
 	    // top texture
-	    toptexture = texturetranslation[sidedef->toptexture];
+	    toptexture = rendertexturetranslation[sidedef->toptexture];
 	    if (linedef->flags & ML_DONTPEGTOP)
 	    {
 		// top of texture at top
@@ -586,7 +633,7 @@ R_StoreWallRange
 	if (worldlow > worldbottom)
 	{
 	    // bottom texture
-	    bottomtexture = texturetranslation[sidedef->bottomtexture];
+	    bottomtexture = rendertexturetranslation[sidedef->bottomtexture];
 
 	    if (linedef->flags & ML_DONTPEGBOTTOM )
 	    {
@@ -605,8 +652,8 @@ R_StoreWallRange
 	{
 	    // masked midtexture
 	    maskedtexture = true;
-	    ds_p->maskedtexturecol = maskedtexturecol = lastopening - rw_x;
-	    lastopening += rw_stopx - rw_x;
+	    ds_p->maskedtexturecol = maskedtexturecol
+		= R_AllocOpenings (rw_stopx - rw_x) - rw_x;
 	}
     }
     
@@ -715,17 +762,17 @@ R_StoreWallRange
     if ( ((ds_p->silhouette & SIL_TOP) || maskedtexture)
 	 && !ds_p->sprtopclip)
     {
-	memcpy (lastopening, ceilingclip+start, 2*(rw_stopx-start));
-	ds_p->sprtopclip = lastopening - start;
-	lastopening += rw_stopx - start;
+	openings = R_AllocOpenings (rw_stopx - start);
+	memcpy (openings, ceilingclip+start, 2*(rw_stopx-start));
+	ds_p->sprtopclip = openings - start;
     }
     
     if ( ((ds_p->silhouette & SIL_BOTTOM) || maskedtexture)
 	 && !ds_p->sprbottomclip)
     {
-	memcpy (lastopening, floorclip+start, 2*(rw_stopx-start));
-	ds_p->sprbottomclip = lastopening - start;
-	lastopening += rw_stopx - start;	
+	openings = R_AllocOpenings (rw_stopx - start);
+	memcpy (openings, floorclip+start, 2*(rw_stopx-start));
+	ds_p->sprbottomclip = openings - start;
     }
 
     if (maskedtexture && !(ds_p->silhouette&SIL_TOP))
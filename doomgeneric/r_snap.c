@@ -0,0 +1,139 @@
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	World snapshots, so the player view can be rendered
+//	 while the game simulates the next tics.
+//	The renderer only reads the level geometry, which does
+//	 not change during a level, and the state copied here:
+//	 sector heights/flats/lights, sidedef textures/offsets,
+//	 the things linked in sectors, the animated texture and
+//	 flat translations and the player (view, weapon sprites).
+//
+
+
+#include <string.h>
+
+#include "z_zone.h"
+
+#include "r_snap.h"
+
+
+extern int		numflats;
+extern int		numtextures;
+
+sector_t*		rendersectors;
+side_t*			rendersides;
+int*			renderflattranslation;
+int*			rendertexturetranslation;
+
+// Snapshot storage, freed with the level.
+static sector_t*	snapsectors;
+static side_t*		snapsides;
+static mobj_t*		snapmobjs;
+static int		snapmobjsmax;
+
+// Translations are sized for the WAD: allocated once.
+static int*		snapflattranslation;
+static int*		snaptexturetranslation;
+
+static player_t		snapplayer;
+static mobj_t		snapplayermo;
+
+
+//
+// R_UseLiveWorld
+//
+void R_UseLiveWorld (void)
+{
+    rendersectors = sectors;
+    rendersides = sides;
+    renderflattranslation = flattranslation;
+    rendertexturetranslation = texturetranslation;
+}
+
+
+//
+// R_SnapshotWorld
+//
+player_t* R_SnapshotWorld (player_t* player)
+{
+    sector_t*	sec;
+    mobj_t*	thing;
+    mobj_t**	link;
+    int		count;
+    int		i;
+
+    if (!snapsectors)
+    {
+	snapsectors = Z_Malloc (numsectors * sizeof(sector_t),
+				PU_LEVEL, &snapsectors);
+	snapsides = Z_Malloc (numsides * sizeof(side_t),
+			      PU_LEVEL, &snapsides);
+	snapmobjsmax = 0;
+    }
+
+    if (!snapflattranslation)
+    {
+	snapflattranslation = Z_Malloc ((numflats + 1) * sizeof(int),
+					PU_STATIC, NULL);
+	snaptexturetranslation = Z_Malloc ((numtextures + 1) * sizeof(int),
+					   PU_STATIC, NULL);
+    }
+
+    // Things are only reachable from their sector.
+    count = 0;
+    for (i = 0 ; i < numsectors ; i++)
+	for (thing = sectors[i].thinglist ; thing ; thing = thing->snext)
+	    count++;
+
+    if (count > snapmobjsmax || !snapmobjs)
+    {
+	if (snapmobjs)
+	    Z_Free (snapmobjs);
+	snapmobjsmax = count * 2 + 64;
+	snapmobjs = Z_Malloc (snapmobjsmax * sizeof(mobj_t),
+			      PU_LEVEL, &snapmobjs);
+    }
+
+    memcpy (snapsectors, sectors, numsectors * sizeof(sector_t));
+    memcpy (snapsides, sides, numsides * sizeof(side_t));
+    memcpy (snapflattranslation, flattranslation,
+	    (numflats + 1) * sizeof(int));
+    memcpy (snaptexturetranslation, texturetranslation,
+	    (numtextures + 1) * sizeof(int));
+
+    count = 0;
+    for (i = 0, sec = snapsectors ; i < numsectors ; i++, sec++)
+    {
+	link = &sec->thinglist;
+	for (thing = sectors[i].thinglist ; thing ; thing = thing->snext)
+	{
+	    snapmobjs[count] = *thing;
+	    snapmobjs[count].sprev = NULL;
+	    *link = &snapmobjs[count];
+	    link = &snapmobjs[count].snext;
+	    count++;
+	}
+	*link = NULL;
+    }
+
+    snapplayer = *player;
+    snapplayermo = *player->mo;
+    snapplayer.mo = &snapplayermo;
+
+    rendersectors = snapsectors;
+    rendersides = snapsides;
+    renderflattranslation = snapflattranslation;
+    rendertexturetranslation = snaptexturetranslation;
+
+    return &snapplayer;
+}
@@ -0,0 +1,54 @@
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	World snapshots, so the player view can be rendered
+//	 while the game simulates the next tics.
+//
+
+
+#ifndef __R_SNAP__
+#define __R_SNAP__
+
+#include "d_player.h"
+#include "r_defs.h"
+#include "r_state.h"
+
+
+// World state read by the renderer: either the live level
+//  or the last snapshot (see R_SnapshotWorld).
+extern sector_t*	rendersectors;
+extern side_t*		rendersides;
+extern int*		renderflattranslation;
+extern int*		rendertexturetranslation;
+
+// Level data points into the live arrays: these map such
+//  pointers to the copy being rendered.
+static inline sector_t* R_RenderSector (sector_t* sec)
+{
+    return sec ? rendersectors + (sec - sectors) : NULL;
+}
+
+static inline side_t* R_RenderSide (side_t* side)
+{
+    return rendersides + (side - sides);
+}
+
+// Renders the live level.
+void R_UseLiveWorld (void);
+
+// Copies the sectors, sides, things and animation state seen
+//  from the player and renders them until the next call to
+//  R_UseLiveWorld. Returns the copy of the player.
+player_t* R_SnapshotWorld (player_t* player);
+
+
+#endif
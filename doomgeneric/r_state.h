@@ -94,34 +94,34 @@ extern side_t*		sides;
 //
 // POV data.
 //
-extern fixed_t		viewx;
-extern fixed_t		viewy;
-extern fixed_t		viewz;
+extern R_THREAD fixed_t		viewx;
+extern R_THREAD fixed_t		viewy;
+extern R_THREAD fixed_t		viewz;
 
-extern angle_t		viewangle;
-extern player_t*	viewplayer;
+extern R_THREAD angle_t		viewangle;
+extern R_THREAD player_t*	viewplayer;
 
 
 // ?
 extern angle_t		clipangle;
 
 extern int		viewangletox[FINEANGLES/2];
-extern angle_t		xtoviewangle[SCREENWIDTH+1];
+extern angle_t		xtoviewangle[MAXWIDTH+1];
 //extern fixed_t		finetangent[FINEANGLES/2];
 
-extern fixed_t		rw_distance;
-extern angle_t		rw_normalangle;
+extern R_THREAD fixed_t		rw_distance;
+extern R_THREAD angle_t		rw_normalangle;
 
 
 
 // angle to line origin
-extern int		rw_angle1;
+extern R_THREAD int		rw_angle1;
 
 // Segs count?
-extern int		sscount;
+extern R_THREAD int		sscount;
 
-extern visplane_t*	floorplane;
-extern visplane_t*	ceilingplane;
+extern R_THREAD visplane_t*	floorplane;
+extern R_THREAD visplane_t*	ceilingplane;
 
 
 #endif
@@ -21,6 +21,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 
 #include "deh_main.h"
@@ -68,12 +69,12 @@ typedef struct
 fixed_t		pspritescale;
 fixed_t		pspriteiscale;
 
-lighttable_t**	spritelights;
+R_THREAD lighttable_t**	spritelights;
 
 // constant arrays
 //  used for psprite clipping and initializing clipping
-short		negonearray[SCREENWIDTH];
-short		screenheightarray[SCREENWIDTH];
+short		negonearray[MAXWIDTH];
+short		screenheightarray[MAXWIDTH];
 
 
 //
@@ -281,9 +282,12 @@ void R_InitSpriteDefs (char** namelist)
 //
 // GAME FUNCTIONS
 //
-vissprite_t	vissprites[MAXVISSPRITES];
-vissprite_t*	vissprite_p;
-int		newvissprite;
+R_THREAD vissprite_t*	vissprites;
+R_THREAD vissprite_t*	vissprite_p;
+R_THREAD int		newvissprite;
+
+// room in vissprites, kept from frame to frame
+static R_THREAD int	maxvissprites = MAXVISSPRITES;
 
 
 
@@ -311,19 +315,35 @@ void R_InitSprites (char** namelist)
 //
 void R_ClearSprites (void)
 {
+    R_FramePeak (framepeaks.vissprites, vissprite_p - vissprites);
+    R_FramePeak (framepeaks.spritebytes, framearenas->sprites.peak);
+
+    Z_ArenaReset (&framearenas->sprites);
+    vissprites = Z_ArenaAlloc (&framearenas->sprites,
+			       maxvissprites * sizeof(*vissprites));
     vissprite_p = vissprites;
 }
 
 
 //
 // R_NewVisSprite
+// The vissprites move when they need more room: pointers to them
+//  are only kept once they have all been added (R_SortVisSprites).
 //
-vissprite_t	overflowsprite;
-
 vissprite_t* R_NewVisSprite (void)
 {
-    if (vissprite_p == &vissprites[MAXVISSPRITES])
-	return &overflowsprite;
+    vissprite_t*	grown;
+
+    if (vissprite_p == vissprites + maxvissprites)
+    {
+	grown = Z_ArenaAlloc (&framearenas->sprites,
+			      2 * maxvissprites * sizeof(*vissprites));
+	memcpy (grown, vissprites, maxvissprites * sizeof(*vissprites));
+
+	vissprite_p = grown + (vissprite_p - vissprites);
+	vissprites = grown;
+	maxvissprites *= 2;
+    }
     
     vissprite_p++;
     return vissprite_p-1;
@@ -337,11 +357,11 @@ vissprite_t* R_NewVisSprite (void)
 // Masked means: partly transparent, i.e. stored
 //  in posts/runs of opaque pixels.
 //
-short*		mfloorclip;
-short*		mceilingclip;
+R_THREAD short*		mfloorclip;
+R_THREAD short*		mceilingclip;
 
-fixed_t		spryscale;
-fixed_t		sprtopscreen;
+R_THREAD fixed_t		spryscale;
+R_THREAD fixed_t		sprtopscreen;
 
 void R_DrawMaskedColumn (column_t* column)
 {
@@ -473,10 +493,29 @@ void R_ProjectSprite (mobj_t* thing)
     
     angle_t		ang;
     fixed_t		iscale;
+
+    fixed_t		thingx;
+    fixed_t		thingy;
+    fixed_t		thingz;
+
+    // Between tics, the position is interpolated but not the
+    //  rotation: things spawned in the last tic turn after.
+    if (interpolateview)
+    {
+	thingx = thing->oldx + FixedMul (thing->x - thing->oldx, fractionaltic);
+	thingy = thing->oldy + FixedMul (thing->y - thing->oldy, fractionaltic);
+	thingz = thing->oldz + FixedMul (thing->z - thing->oldz, fractionaltic);
+    }
+    else
+    {
+	thingx = thing->x;
+	thingy = thing->y;
+	thingz = thing->z;
+    }
     
     // transform the origin point
-    tr_x = thing->x - viewx;
-    tr_y = thing->y - viewy;
+    tr_x = thingx - viewx;
+    tr_y = thingy - viewy;
 	
     gxt = FixedMul(tr_x,viewcos); 
     gyt = -FixedMul(tr_y,viewsin);
@@ -514,7 +553,7 @@ void R_ProjectSprite (mobj_t* thing)
     if (sprframe->rotate)
     {
 	// choose a different rotation based on player view
-	ang = R_PointToAngle (thing->x, thing->y);
+	ang = R_PointToAngle (thingx, thingy);
 	rot = (ang-thing->angle+(unsigned)(ANG45/2)*9)>>29;
 	lump = sprframe->lump[rot];
 	flip = (boolean)sprframe->flip[rot];
@@ -545,10 +584,10 @@ void R_ProjectSprite (mobj_t* thing)
     vis = R_NewVisSprite ();
     vis->mobjflags = thing->flags;
     vis->scale = xscale<<detailshift;
-    vis->gx = thing->x;
-    vis->gy = thing->y;
-    vis->gz = thing->z;
-    vis->gzt = thing->z + spritetopoffset[lump];
+    vis->gx = thingx;
+    vis->gy = thingy;
+    vis->gz = thingz;
+    vis->gzt = thingz + spritetopoffset[lump];
     vis->texturemid = vis->gzt - viewz;
     vis->x1 = x1 < 0 ? 0 : x1;
     vis->x2 = x2 >= viewwidth ? viewwidth-1 : x2;	
@@ -589,7 +628,7 @@ void R_ProjectSprite (mobj_t* thing)
     else
     {
 	// diminished light
-	index = xscale>>(LIGHTSCALESHIFT-detailshift);
+	index = xscale>>(LIGHTSCALESHIFT-detailshift+hires);
 
 	if (index >= MAXLIGHTSCALE) 
 	    index = MAXLIGHTSCALE-1;
@@ -601,6 +640,40 @@ void R_ProjectSprite (mobj_t* thing)
 
 
 
+//
+// R_InitSpriteStrips
+// Sets up the per strip records of sectors whose sprites were
+//  added this frame (see R_AddSprites). Called before the strips
+//  are rendered, they are freed with the level.
+//
+static int*		stripsectorframes[MAXRENDERSTRIPS];
+static R_THREAD int*	spritesectorframes;
+
+void R_InitSpriteStrips (int numstrips)
+{
+    int		i;
+
+    for (i=0 ; i<numstrips ; i++)
+    {
+	if (!stripsectorframes[i])
+	{
+	    Z_Malloc (numsectors * sizeof(int), PU_LEVEL,
+		      &stripsectorframes[i]);
+	    memset (stripsectorframes[i], 0, numsectors * sizeof(int));
+	}
+    }
+}
+
+//
+// R_SetSpriteStrip
+//
+void R_SetSpriteStrip (int strip)
+{
+    spritesectorframes = stripsectorframes[strip];
+}
+
+
+
 //
 // R_AddSprites
 // During BSP traversal, this adds sprites by sector.
@@ -614,11 +687,13 @@ void R_AddSprites (sector_t* sec)
     // A sector might have been split into several
     //  subsectors during BSP building.
     // Thus we check whether its already added.
-    if (sec->validcount == validcount)
+    // Each strip renders all the sprites of the view,
+    //  so the mark is kept per strip, not in the sector.
+    if (spritesectorframes[sec - rendersectors] == framecount)
 	return;		
 
     // Well, now it will be done.
-    sec->validcount = validcount;
+    spritesectorframes[sec - rendersectors] = framecount;
 	
     lightnum = (sec->lightlevel >> LIGHTSEGSHIFT)+extralight;
 
@@ -746,7 +821,7 @@ void R_DrawPlayerSprites (void)
     
     // get light level
     lightnum =
-	(viewplayer->mo->subsector->sector->lightlevel >> LIGHTSEGSHIFT) 
+	(R_RenderSector (viewplayer->mo->subsector->sector)->lightlevel >> LIGHTSEGSHIFT) 
 	+extralight;
 
     if (lightnum < 0)		
@@ -776,7 +851,7 @@ void R_DrawPlayerSprites (void)
 //
 // R_SortVisSprites
 //
-vissprite_t	vsprsortedhead;
+R_THREAD vissprite_t	vsprsortedhead;
 
 
 void R_SortVisSprites (void)
@@ -835,8 +910,8 @@ void R_SortVisSprites (void)
 //
 // R_DrawSprite
 //
-static short		clipbot[SCREENWIDTH];
-static short		cliptop[SCREENWIDTH];
+static R_THREAD short		clipbot[MAXWIDTH];
+static R_THREAD short		cliptop[MAXWIDTH];
 void R_DrawSprite (vissprite_t* spr)
 {
     drawseg_t*		ds;
@@ -846,6 +921,12 @@ void R_DrawSprite (vissprite_t* spr)
     fixed_t		scale;
     fixed_t		lowscale;
     int			silhouette;
+
+    // Sprites outside the strip draw nothing; shadows still
+    //  step fuzzpos as they would for the whole view.
+    if (spr->colormap
+	&& (spr->x2 < dc_stripx1 || spr->x1 > dc_stripx2))
+	return;
 		
     for (x = spr->x1 ; x<=spr->x2 ; x++)
 	clipbot[x] = cliptop[x] = -2;
@@ -22,22 +22,23 @@
 
 
 
+// Room for vissprites at startup, doubled when a frame needs more.
 #define MAXVISSPRITES  	128
 
-extern vissprite_t	vissprites[MAXVISSPRITES];
-extern vissprite_t*	vissprite_p;
-extern vissprite_t	vsprsortedhead;
+extern R_THREAD vissprite_t*	vissprites;
+extern R_THREAD vissprite_t*	vissprite_p;
+extern R_THREAD vissprite_t	vsprsortedhead;
 
 // Constant arrays used for psprite clipping
 //  and initializing clipping.
-extern short		negonearray[SCREENWIDTH];
-extern short		screenheightarray[SCREENWIDTH];
+extern short		negonearray[MAXWIDTH];
+extern short		screenheightarray[MAXWIDTH];
 
 // vars for R_DrawMaskedColumn
-extern short*		mfloorclip;
-extern short*		mceilingclip;
-extern fixed_t		spryscale;
-extern fixed_t		sprtopscreen;
+extern R_THREAD short*		mfloorclip;
+extern R_THREAD short*		mceilingclip;
+extern R_THREAD fixed_t		spryscale;
+extern R_THREAD fixed_t		sprtopscreen;
 
 extern fixed_t		pspritescale;
 extern fixed_t		pspriteiscale;
@@ -53,6 +54,8 @@ void R_AddPSprites (void);
 void R_DrawSprites (void);
 void R_InitSprites (char** namelist);
 void R_ClearSprites (void);
+void R_InitSpriteStrips (int numstrips);
+void R_SetSpriteStrip (int strip);
 void R_DrawMasked (void);
 
 void
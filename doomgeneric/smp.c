@@ -0,0 +1,394 @@
+/**
+ * @file smp.c
+ * @brief Secondary harts bring-up and a lightweight job system.
+ *
+ * Secondary harts (QEMU '-smp N') enter smp_hart_entry() from boot.s on
+ * their own stack and sleep in 'wfi' with only the machine software
+ * interrupt (MSIP) enabled, so the CLINT 'msip' register is used to wake
+ * them up. No trap is taken: global interrupts stay disabled on those harts.
+ *
+ * Each hart owns a job queue protected by a spinlock (A extension atomics).
+ * smp_parallel_for() spreads jobs over the queues, wakes the harts and then
+ * works itself until all jobs are done; an idle hart steals from the others.
+ * smp_submit() queues a single job on a secondary hart and returns at once:
+ * the caller goes on with its own work and later joins with smp_wait().
+ *
+ * Jobs run concurrently with each other: non reentrant code such as malloc()
+ * or the zone allocator must only be called with a spinlock held.
+ *
+ * Every hart has its own copy of the thread-local variables (__thread, used
+ * by the renderer): a block laid out by the linker script after the .tdata
+ * and .tbss template, with tp pointing to it.
+ */
+#include <stdint.h>
+#include <stddef.h>
+#include "uart_serial.h"
+#include "rtc.h"
+#include "smp.h"
+
+// CLINT machine software interrupt pending register, one 32 bits word per hart
+#define CLINT_BASE      0x02000000UL
+#define CLINT_MSIP(h)   ((volatile uint32_t *)(CLINT_BASE + 4 * (h)))
+
+#define MIE_MSIE        (1 << 3)    // Machine-mode Software Interrupt Enable Flag
+
+#define MISA_EXT(c)     (1UL << ((c) - 'A'))
+#define MSTATUS_FS_INIT 0x2000      // Floating point unit state: initial
+#define MSTATUS_VS_INIT 0x200       // Vector unit state: initial
+
+#define QUEUE_SIZE      256
+
+// keep gcc from turning copy loops into memcpy() calls (see smp_tls_setup())
+#define NO_LIBCALL      __attribute__((optimize("no-tree-loop-distribute-patterns")))
+
+// thread-local storage template and per hart blocks, see riscv64-virt.ld
+extern uint8_t _tdata_start[];
+extern uint8_t _tdata_end[];
+extern uint8_t _tbss_end[];
+extern uint8_t _tls_blocks[];
+extern uint8_t _tls_block_size[];
+
+typedef struct {
+    smp_job_func_t func;
+    void *arg;
+    int index;
+    volatile int *pending;  // jobs of the same smp_parallel_for() still to complete
+    uint64_t *busy;         // run time accounting (smp_submit() jobs only)
+} smp_job_t;
+
+typedef struct {
+    spinlock_t lock;
+    uint32_t head;          // next job to steal
+    uint32_t tail;          // next free slot
+    smp_job_t jobs[QUEUE_SIZE];
+} __attribute__((aligned(64))) job_queue_t;
+
+static job_queue_t queues[SMP_MAX_HARTS];
+
+static volatile uint32_t harts_online_mask = 1;     // hart 0 is running main()
+static int num_harts = 1;
+static volatile int active_harts = SMP_MAX_HARTS;
+
+//
+// Spinlocks
+//
+
+void spin_lock(spinlock_t *lock) {
+    while (__atomic_exchange_n(&lock->locked, 1, __ATOMIC_ACQUIRE)) {
+        while (lock->locked) {
+            // wait without hammering the bus with AMOs
+        }
+    }
+}
+
+void spin_unlock(spinlock_t *lock) {
+    __atomic_store_n(&lock->locked, 0, __ATOMIC_RELEASE);
+}
+
+//
+// Job queues
+//
+
+static int queue_push(job_queue_t *q, smp_job_t *job) {
+    int ok = 0;
+    spin_lock(&q->lock);
+    if (q->tail - q->head < QUEUE_SIZE) {
+        q->jobs[q->tail % QUEUE_SIZE] = *job;
+        q->tail++;
+        ok = 1;
+    }
+    spin_unlock(&q->lock);
+    return ok;
+}
+
+// owner takes the most recently queued job, thieves the oldest one
+static int queue_pop(job_queue_t *q, smp_job_t *job, int steal) {
+    int ok = 0;
+    if (q->head == q->tail) {
+        return 0;   // racy but cheap check: avoid locking empty queues
+    }
+    spin_lock(&q->lock);
+    if (q->head != q->tail) {
+        if (steal) {
+            *job = q->jobs[q->head % QUEUE_SIZE];
+            q->head++;
+        } else {
+            q->tail--;
+            *job = q->jobs[q->tail % QUEUE_SIZE];
+        }
+        ok = 1;
+    }
+    spin_unlock(&q->lock);
+    return ok;
+}
+
+static void run_job(smp_job_t *job) {
+    if (job->busy) {
+        uint64_t start = kmtime();
+        job->func(job->arg, job->index);
+        *job->busy += kmtime() - start;
+    } else {
+        job->func(job->arg, job->index);
+    }
+    __atomic_fetch_sub(job->pending, 1, __ATOMIC_RELEASE);
+}
+
+// Runs one job from own queue or stolen from other harts. Returns 0 when none is found.
+static int run_one_job(int hartid) {
+    smp_job_t job;
+
+    if (queue_pop(&queues[hartid], &job, 0)) {
+        run_job(&job);
+        return 1;
+    }
+    for (int i = 1; i < num_harts; i++) {
+        int victim = (hartid + i) % num_harts;
+        if (queue_pop(&queues[victim], &job, 1)) {
+            run_job(&job);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void wake_hart(int hartid) {
+    *CLINT_MSIP(hartid) = 1;
+}
+
+/**
+ * @brief Initializes the TLS block of a hart from the template and points tp to it.
+ *        Called from boot.s for hart 0 and smp_hart_entry() for the others, before
+ *        any thread-local variable is used. Copies with plain loops: the vector
+ *        unit memcpy() may not be usable yet on the calling hart.
+ *
+ * @param hartid
+ */
+NO_LIBCALL void smp_tls_setup(uint64_t hartid) {
+    uint64_t block_size = (uint64_t)_tls_block_size;
+    uint64_t tdata_size = _tdata_end - _tdata_start;
+    uint64_t tls_size = _tbss_end - _tdata_start;
+    uint8_t *block = _tls_blocks + hartid * block_size;
+    uint64_t i;
+
+    for (i = 0; i < tdata_size; i++)
+        block[i] = _tdata_start[i];
+    for (; i < tls_size; i++)
+        block[i] = 0;
+
+    asm volatile("mv tp, %0" :: "r"(block));
+}
+
+/**
+ * @brief Entry point of secondary harts (see boot.s). Never returns.
+ *
+ * @param hartid
+ */
+void smp_hart_entry(uint64_t hartid) {
+    // jobs may use FPU and vector unit (libc memory functions): turn them on as on hart 0
+    uint64_t misa;
+    asm volatile("csrr %0, misa" : "=r"(misa));
+    if (misa & (MISA_EXT('F') | MISA_EXT('D')))
+        asm volatile("csrs mstatus, %0" :: "r"(MSTATUS_FS_INIT));
+    if (misa & MISA_EXT('V'))
+        asm volatile("csrs mstatus, %0" :: "r"(MSTATUS_VS_INIT));
+
+    smp_tls_setup(hartid);
+
+    __atomic_fetch_or(&harts_online_mask, 1U << hartid, __ATOMIC_RELEASE);
+
+    // 'wfi' resumes on pending software interrupt, even with interrupts globally disabled
+    asm volatile("csrs mie, %0" :: "r"(MIE_MSIE));
+
+    while (1) {
+        // clear wakeup request before looking for work: a job queued after the
+        // check leaves MSIP pending and 'wfi' won't sleep
+        *CLINT_MSIP(hartid) = 0;
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+        if (hartid < active_harts) {
+            while (run_one_job(hartid))
+                ;
+        }
+        asm volatile("wfi");
+    }
+}
+
+/**
+ * @brief Waits for secondary harts to park and returns number of usable harts.
+ *        Harts must be numbered contiguously from 0.
+ */
+int smp_init() {
+    // parked harts check in as soon as they start: give them some time
+    kusleep(10000);
+
+    uint32_t mask = harts_online_mask;
+    num_harts = 0;
+    while (num_harts < SMP_MAX_HARTS && (mask & (1U << num_harts)))
+        num_harts++;
+
+    kprintf("smp_init(): harts online mask [%x], using [%d] harts\n", mask, num_harts);
+    return num_harts;
+}
+
+int smp_num_harts() {
+    return num_harts;
+}
+
+/**
+ * @brief Limits the harts running jobs to the first 'num_harts' ones (for benchmarks).
+ */
+void smp_set_active_harts(int n) {
+    active_harts = n < 1 ? 1 : n;
+}
+
+/**
+ * @brief Runs func(arg, i) for i in [0, count) on all harts and waits for completion.
+ *        May be called from any hart, including from a job.
+ */
+void smp_parallel_for(smp_job_func_t func, void *arg, int count) {
+    volatile int pending = count;
+    int self = read_mhartid();
+    int harts = num_harts < active_harts ? num_harts : active_harts;
+    smp_job_t job = { .func = func, .arg = arg, .pending = &pending };
+
+    for (int i = 0; i < count; i++) {
+        job.index = i;
+        if (!queue_push(&queues[i % harts], &job)) {
+            run_job(&job);  // queue full
+        }
+    }
+
+    // hart 0 runs jobs only while it waits for them, others steal its share
+    for (int h = 1; h < harts; h++) {
+        if (h != self)
+            wake_hart(h);
+    }
+
+    // calling hart works too, then waits for jobs stolen by others
+    while (__atomic_load_n(&pending, __ATOMIC_ACQUIRE) > 0) {
+        run_one_job(self);
+    }
+}
+
+/**
+ * @brief Queues func(arg, 0) on a secondary hart and returns without waiting.
+ *        The task must not be pending already. Without secondary harts the job
+ *        runs before returning.
+ */
+void smp_submit(smp_task_t *task, smp_job_func_t func, void *arg) {
+    static int next_hart;
+    int harts = num_harts < active_harts ? num_harts : active_harts;
+    smp_job_t job = { .func = func, .arg = arg, .pending = &task->pending, .busy = &task->busy };
+
+    task->pending = 1;
+    if (harts < 2) {
+        run_job(&job);
+        return;
+    }
+
+    // round robin over secondary harts, idle ones steal if it is busy
+    next_hart = next_hart % (harts - 1) + 1;
+    if (!queue_push(&queues[next_hart], &job)) {
+        run_job(&job);  // queue full
+        return;
+    }
+    wake_hart(next_hart);
+}
+
+/**
+ * @brief Waits for a job queued by smp_submit(), running other jobs meanwhile.
+ */
+void smp_wait(smp_task_t *task) {
+    int self = read_mhartid();
+    uint64_t start;
+
+    if (__atomic_load_n(&task->pending, __ATOMIC_ACQUIRE) == 0)
+        return;
+
+    start = kmtime();
+    while (__atomic_load_n(&task->pending, __ATOMIC_ACQUIRE) > 0) {
+        run_one_job(self);
+    }
+    task->stall += kmtime() - start;
+}
+
+//
+// Self-test and scaling benchmark
+//
+
+#define SELFTEST_JOBS   1000
+
+static volatile int selftest_runs[SELFTEST_JOBS];
+static volatile uint32_t selftest_harts;
+
+static void selftest_job(void *arg, int index) {
+    __atomic_fetch_add(&selftest_runs[index], 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add((volatile uint64_t *)arg, index, __ATOMIC_RELAXED);
+    __atomic_fetch_or(&selftest_harts, 1U << read_mhartid(), __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief Checks each job runs exactly once and reports harts which took part.
+ *
+ * @return int 0 on success
+ */
+int smp_selftest() {
+    volatile uint64_t sum = 0;
+    uint64_t expected = (uint64_t)SELFTEST_JOBS * (SELFTEST_JOBS - 1) / 2;
+    int errors = 0;
+
+    for (int i = 0; i < SELFTEST_JOBS; i++)
+        selftest_runs[i] = 0;
+    selftest_harts = 0;
+
+    smp_parallel_for(selftest_job, (void *)&sum, SELFTEST_JOBS);
+
+    for (int i = 0; i < SELFTEST_JOBS; i++) {
+        if (selftest_runs[i] != 1)
+            errors++;
+    }
+    if (sum != expected)
+        errors++;
+
+    kprintf("smp_selftest(): %s, jobs [%d], errors [%d], harts mask [%x]\n",
+            errors ? "FAILED" : "passed", SELFTEST_JOBS, errors, selftest_harts);
+    return errors;
+}
+
+#define BENCH_JOBS      64
+#define BENCH_LOOPS     200000
+
+static volatile uint64_t bench_results[BENCH_JOBS];
+
+// CPU bound job: xorshift iterations
+static void bench_job(void *arg, int index) {
+    uint64_t x = index + 1;
+    for (int i = 0; i < BENCH_LOOPS; i++) {
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+    }
+    bench_results[index] = x;
+}
+
+/**
+ * @brief Runs the same work with 1..N harts and prints speedup vs one hart.
+ */
+void smp_bench() {
+    uint64_t t1 = 0;
+
+    kprintf("smp_bench(): jobs [%d], harts elapsed_us speedup\n", BENCH_JOBS);
+    for (int n = 1; n <= num_harts; n++) {
+        smp_set_active_harts(n);
+        uint64_t t0 = kmtime();
+        smp_parallel_for(bench_job, NULL, BENCH_JOBS);
+        uint64_t elapsed = kmtime() - t0;
+        if (n == 1)
+            t1 = elapsed;
+        // mtime is 10MHz: 10 ticks per us
+        uint64_t speedup = elapsed ? (t1 * 100) / elapsed : 0;
+        kprintf("smp_bench(): %d %d %d.%d%d\n", n, (int)(elapsed / 10),
+                (int)(speedup / 100), (int)(speedup / 10 % 10), (int)(speedup % 10));
+    }
+    smp_set_active_harts(SMP_MAX_HARTS);
+}
@@ -0,0 +1,40 @@
+#ifndef SMP
+#define SMP
+
+#include <stdint.h>
+
+// must match boot.s
+#define SMP_MAX_HARTS   8
+
+// Job function: 'index' is the job number within smp_parallel_for()
+typedef void (*smp_job_func_t)(void *arg, int index);
+
+typedef struct {
+    volatile int locked;
+} spinlock_t;
+
+// Job running in the background (see smp_submit())
+typedef struct {
+    volatile int pending;   // 1 while the job is queued or running
+    uint64_t busy;          // mtime ticks spent running the job, all runs
+    uint64_t stall;         // mtime ticks spent in smp_wait(), all runs
+} smp_task_t;
+
+void spin_lock(spinlock_t *lock);
+void spin_unlock(spinlock_t *lock);
+
+uint64_t read_mhartid();
+
+void smp_tls_setup(uint64_t hartid);
+
+int smp_init();
+int smp_num_harts();
+void smp_set_active_harts(int num_harts);
+void smp_parallel_for(smp_job_func_t func, void *arg, int count);
+void smp_submit(smp_task_t *task, smp_job_func_t func, void *arg);
+void smp_wait(smp_task_t *task);
+
+int smp_selftest();
+void smp_bench();
+
+#endif
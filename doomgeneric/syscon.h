@@ -2,6 +2,7 @@
 #define SYSCON
 
 void poweroff(void);
+void poweroff_exit(int status);
 void reboot(void);
 
 #endif
\ No newline at end of file
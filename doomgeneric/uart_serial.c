@@ -4,22 +4,54 @@
  * 
  * @see https://github.com/michaeljclark/riscv-probe/blob/master/libfemto/drivers/ns16550a.c
  * 
+ * Output is synchronous until kconsole_start(): from then on kprintf() formats into
+ * a local buffer and copies it into a lock-free ring, drained by the THR empty
+ * interrupt (through the PLIC) or from the idle loop (kconsole_idle()). Producers
+ * may run on any hart; they reserve ring space with a CAS and publish in order.
+ * When the ring is full the newest output is dropped and a marker says how much.
+ * Output to stderr stays synchronous: the ring is flushed first, so I_Error()
+ * messages always reach the UART before the machine powers off.
+ * Interrupt handlers must not print once output is buffered.
  */
 #include <stddef.h>
 #include <stdarg.h>
 #include <stdlib.h>
+#include <string.h>
 #include "uart_serial.h"
+#include "plic.h"
 
 
 #define UART_BASE       0x10000000UL  // Adjust this to your actual UART base address
 #define UART_LSR        (UART_BASE + 0x05) // Line Status Register address
 #define UART_RBR        (UART_BASE + 0x00) // Receiver Buffer Register address
 #define UART_THR        (UART_BASE + 0x00) // Transmit Hold Register address
+#define UART_IER        (UART_BASE + 0x01) // Interrupt Enable Register address
+#define UART_IIR        (UART_BASE + 0x02) // Interrupt Identification Register address (read)
+#define UART_FCR        (UART_BASE + 0x02) // FIFO Control Register address (write)
 
 #define UART_LSR_DR     0x01  // Data Ready
+#define UART_LSR_THRE   0x20  // Transmit Hold Register (FIFO) Empty
+#define UART_IER_THRI   0x02  // THR empty interrupt
+#define UART_FCR_ENABLE 0x07  // enable and clear FIFOs
+#define UART_FIFO_SIZE  16    // 16550A
 
+#define MSTATUS_MIE     (1 << 3)
+
+// console ring, power of 2
+#define CONSOLE_RING_SIZE   (64 * 1024)
+// kvprintf() formats this much before copying into the ring
+#define CONSOLE_MSG_SIZE    256
+
+#ifdef DG_NATIVE
+// native build: registers emulated by native.c
+uint8_t native_uart_read(uint64_t addr);
+void native_uart_write(uint64_t addr, uint8_t value);
+#define mmio_read_char(ADDR)         native_uart_read(ADDR)
+#define mmio_write_char(ADDR, CHAR)  native_uart_write(ADDR, CHAR)
+#else
 #define mmio_read_char(ADDR)         (*(volatile uint8_t *)(ADDR))
 #define mmio_write_char(ADDR, CHAR)  *((volatile uint8_t *)(ADDR)) = (CHAR)
+#endif
 
 
 /**
@@ -31,6 +63,194 @@ void uart_putchar(uint8_t ch) {
     mmio_write_char(UART_THR, ch);
 }
 
+//
+// Asynchronous console
+//
+
+enum {
+    CONSOLE_SYNC,   // bytes go straight to THR
+    CONSOLE_IDLE,   // ring drained by kconsole_idle()
+    CONSOLE_IRQ,    // ring drained by the THR empty interrupt
+};
+
+static char console_ring[CONSOLE_RING_SIZE];
+static volatile int console_mode = CONSOLE_SYNC;
+static volatile uint32_t console_reserved;     // producers own [committed, reserved)
+static volatile uint32_t console_committed;    // bytes before this are in the ring
+static volatile uint32_t console_drained;      // next byte to send
+static volatile uint32_t console_drop_pending; // bytes dropped, not yet reported
+static volatile int console_draining;          // consumer lock (irq, idle or flush)
+
+static struct {
+    uint64_t bytes;
+    uint64_t dropped;
+    uint32_t max_used;
+} console_stats;
+
+static void console_write_sync(const char *s, int n) {
+    for (int i = 0; i < n; i++)
+        uart_putchar(s[i]);
+}
+
+// Reserves, fills and publishes ring space. Returns 0 if it does not fit.
+static int console_push(const char *s, uint32_t n) {
+    uint32_t start, used, offset, first;
+
+    do {
+        start = __atomic_load_n(&console_reserved, __ATOMIC_RELAXED);
+        used = start + n - __atomic_load_n(&console_drained, __ATOMIC_ACQUIRE);
+        if (used > CONSOLE_RING_SIZE)
+            return 0;
+    } while (!__atomic_compare_exchange_n(&console_reserved, &start, start + n, 0,
+                                          __ATOMIC_ACQUIRE, __ATOMIC_RELAXED));
+
+    offset = start % CONSOLE_RING_SIZE;
+    first = CONSOLE_RING_SIZE - offset;
+    if (first > n)
+        first = n;
+    memcpy(&console_ring[offset], s, first);
+    memcpy(&console_ring[0], s + first, n - first);
+
+    // publish in reservation order: wait for earlier producers still copying
+    while (__atomic_load_n(&console_committed, __ATOMIC_ACQUIRE) != start)
+        ;
+    __atomic_store_n(&console_committed, start + n, __ATOMIC_RELEASE);
+
+    if (used > console_stats.max_used)
+        console_stats.max_used = used;
+    return 1;
+}
+
+// Sends what fits in the UART FIFO. Consumer side: console_draining must be held.
+static void console_drain_fifo(void) {
+    uint32_t committed = __atomic_load_n(&console_committed, __ATOMIC_ACQUIRE);
+    uint32_t drained = console_drained;
+
+    if (!(mmio_read_char(UART_LSR) & UART_LSR_THRE))
+        return;
+    for (int i = 0; i < UART_FIFO_SIZE && drained != committed; i++, drained++)
+        uart_putchar(console_ring[drained % CONSOLE_RING_SIZE]);
+    __atomic_store_n(&console_drained, drained, __ATOMIC_RELEASE);
+}
+
+static void console_kick(void) {
+    if (console_mode == CONSOLE_IRQ)
+        mmio_write_char(UART_IER, UART_IER_THRI);  // raises the interrupt if THR is empty
+}
+
+static int ksnprintf(char *buffer, size_t size, const char *format, ...) {
+    va_list arg;
+    va_start(arg, format);
+    int res = kvsnprintf(buffer, size, format, arg);
+    va_end(arg);
+    return res;
+}
+
+static void console_write(const char *s, int n) {
+    if (n <= 0)
+        return;
+    if (console_mode == CONSOLE_SYNC) {
+        console_write_sync(s, n);
+        return;
+    }
+
+    uint32_t dropped = __atomic_exchange_n(&console_drop_pending, 0, __ATOMIC_RELAXED);
+    if (dropped) {
+        char marker[48];
+        int len = ksnprintf(marker, sizeof(marker), "\n[console: %u bytes dropped]\n", dropped);
+        if (!console_push(marker, len))
+            __atomic_fetch_add(&console_drop_pending, dropped, __ATOMIC_RELAXED);
+    }
+
+    if (console_push(s, n)) {
+        __atomic_fetch_add(&console_stats.bytes, n, __ATOMIC_RELAXED);
+    } else {
+        // ring full: drop the newest output, the game loop must not wait for the UART
+        __atomic_fetch_add(&console_drop_pending, n, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&console_stats.dropped, n, __ATOMIC_RELAXED);
+    }
+    console_kick();
+}
+
+// PLIC handler of the UART: refills the FIFO while output is pending
+static void console_irq(void *arg) {
+    mmio_read_char(UART_IIR);   // acknowledge
+
+    if (__atomic_exchange_n(&console_draining, 1, __ATOMIC_ACQUIRE))
+        return;     // kconsole_flush() in progress on another hart
+    console_drain_fifo();
+    if (console_drained == __atomic_load_n(&console_committed, __ATOMIC_ACQUIRE)) {
+        // nothing left: mask THR empty until next kick, unless a producer just committed
+        mmio_write_char(UART_IER, 0);
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        if (console_drained != console_committed)
+            mmio_write_char(UART_IER, UART_IER_THRI);
+    }
+    __atomic_store_n(&console_draining, 0, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Buffers console output from now on.
+ *
+ * @param irq true: drain from the THR empty interrupt (requires plic_init()),
+ *            false: drain from kconsole_idle()
+ */
+void kconsole_start(bool irq) {
+    mmio_write_char(UART_FCR, UART_FCR_ENABLE);
+    if (irq && plic_register(PLIC_IRQ_UART, console_irq, NULL, 0) == 0) {
+        console_mode = CONSOLE_IRQ;
+    } else {
+        console_mode = CONSOLE_IDLE;
+    }
+    kprintf("kconsole_start(): buffered output, drained by [%s]\n",
+            console_mode == CONSOLE_IRQ ? "interrupt" : "idle loop");
+}
+
+/**
+ * @brief Drains the ring without waiting for the UART. Call when idle (hart 0).
+ */
+void kconsole_idle(void) {
+    if (console_mode != CONSOLE_IDLE)
+        return;
+    if (__atomic_exchange_n(&console_draining, 1, __ATOMIC_ACQUIRE))
+        return;
+    while (console_drained != __atomic_load_n(&console_committed, __ATOMIC_ACQUIRE) &&
+           (mmio_read_char(UART_LSR) & UART_LSR_THRE))
+        console_drain_fifo();
+    __atomic_store_n(&console_draining, 0, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Synchronously sends all buffered output (panic path, power off).
+ *        Callable from any hart, with or without interrupts.
+ */
+void kconsole_flush(void) {
+    if (console_mode == CONSOLE_SYNC)
+        return;
+
+    // keep the UART interrupt handler of this hart out while spinning on the consumer lock
+#ifndef DG_NATIVE
+    uint64_t mstatus;
+    asm volatile("csrrc %0, mstatus, %1" : "=r"(mstatus) : "r"(MSTATUS_MIE));
+#endif
+    while (__atomic_exchange_n(&console_draining, 1, __ATOMIC_ACQUIRE))
+        ;
+    while (console_drained != __atomic_load_n(&console_reserved, __ATOMIC_ACQUIRE))
+        console_drain_fifo();   // also waits for producers still copying
+    __atomic_store_n(&console_draining, 0, __ATOMIC_RELEASE);
+#ifndef DG_NATIVE
+    asm volatile("csrs mstatus, %0" :: "r"(mstatus & MSTATUS_MIE));
+#endif
+}
+
+/**
+ * @brief Prints bytes written and dropped through the ring.
+ */
+void kconsole_print_stats(void) {
+    kprintf("kconsole: buffered [%d] bytes, dropped [%d] bytes, ring high-watermark [%d] of [%d]\n",
+            console_stats.bytes, console_stats.dropped, console_stats.max_used, CONSOLE_RING_SIZE);
+}
+
 bool uart_data_is_ready() {
     return ((mmio_read_char(UART_LSR) & UART_LSR_DR) != 0);
 }
@@ -125,7 +345,8 @@ uint8_t* uitoa(uint8_t *str, uint64_t num, int base) {
  * @return int 0-255 value
  */
 int kputchar(int ch) {
-    uart_putchar(ch & 0xff);
+    char c = ch & 0xff;
+    console_write(&c, 1);
     return ch;
 }
 
@@ -153,9 +374,9 @@ int kprint(uint8_t *print_string) {
         if (print_string[i] == 0) {
             break;
         }
-        kputchar(print_string[i]);
         i++;
     }
+    console_write((char *)print_string, i);
 	return i;
 }
 
@@ -349,20 +570,48 @@ int kvsnprintf(char *buffer, size_t buffer_size, const char *format, va_list arg
 }
 
 
-int kvprintf(const char *format, va_list arg) {
+// kvprintf() output buffer: one copy into the console ring per CONSOLE_MSG_SIZE bytes
+typedef struct {
+  char buf[CONSOLE_MSG_SIZE];
+  int len;
+  int sync;
+} kv_out_t;
+
+static void kv_flush(kv_out_t *out) {
+  if (out->sync)
+    console_write_sync(out->buf, out->len);
+  else
+    console_write(out->buf, out->len);
+  out->len = 0;
+}
+
+static void kv_putchar(kv_out_t *out, int ch) {
+  if (out->len == CONSOLE_MSG_SIZE)
+    kv_flush(out);
+  out->buf[out->len++] = ch;
+}
+
+static int kv_print(kv_out_t *out, const char *s) {
+  int i = 0;
+  while (s[i])
+    kv_putchar(out, s[i++]);
+  return i;
+}
+
+static int kvprintf_out(kv_out_t *out, const char *format, va_list arg) {
   int res = 0;
   while (*format) {
     if (*format == '%') {
       ++format;
       if (!*format)
-	    return res;
+	    break;
       switch (*format) {
       case 'd':
       case 'i':
 	{
 	  int n = va_arg(arg, int);
 	  if (n < 0) {
-	    kputchar('-');
+	    kv_putchar(out, '-');
 		res++;
 	    n = ~n + 1;
 	  }
@@ -375,10 +624,10 @@ int kvprintf(const char *format, va_list arg) {
 	    n /= 10;
 	  }
 	  while (p_buf != buf) {
-	    kputchar(*--p_buf);
+	    kv_putchar(out, *--p_buf);
 		res++;
 	  }
-	  kputchar(lsh);
+	  kv_putchar(out, lsh);
 	  res++;
 	}
 	break;
@@ -394,10 +643,10 @@ int kvprintf(const char *format, va_list arg) {
 	    n /= 10;
 	  }
 	  while (p_buf != buf) {
-	    kputchar(*--p_buf);
+	    kv_putchar(out, *--p_buf);
 		res++;
 	  }
-	  kputchar(lsh);
+	  kv_putchar(out, lsh);
 	  res++;
 	}
 	break;
@@ -413,10 +662,10 @@ int kvprintf(const char *format, va_list arg) {
 	    n /= 8;
 	  }
 	  while (p_buf != buf) {
-	    kputchar(*--p_buf);
+	    kv_putchar(out, *--p_buf);
 		res++;
 	  }
-	  kputchar(lsh);
+	  kv_putchar(out, lsh);
 	  res++;
 	}
 	break;
@@ -432,10 +681,10 @@ int kvprintf(const char *format, va_list arg) {
 	    n /= 16;
 	  }
 	  while (p_buf != buf) {
-	    kputchar(*--p_buf);
+	    kv_putchar(out, *--p_buf);
 		res++;
 	  }
-	  kputchar(lsh);
+	  kv_putchar(out, lsh);
 	  res++;
 	}
 	break;
@@ -451,23 +700,23 @@ int kvprintf(const char *format, va_list arg) {
 	    n /= 16;
 	  }
 	  while (p_buf != buf) {
-	    kputchar(_toupper(*--p_buf));
+	    kv_putchar(out, _toupper(*--p_buf));
 		res++;
 	  }
-	  kputchar(_toupper(lsh));
+	  kv_putchar(out, _toupper(lsh));
 	  res++;
 	}
 	break;
       case 'c':
-	kputchar(va_arg(arg, int));
+	kv_putchar(out, va_arg(arg, int));
 	res++;
 	break;
       case 's':
-	res += kprint(va_arg(arg, char *));
+	res += kv_print(out, va_arg(arg, char *));
 	break;
       case 'p':
 	{
-          kprint("0x");
+          res += kv_print(out, "0x");
 	  size_t ptr = va_arg(arg, size_t);
 	  char lsh = to_hex_digit(ptr % 16);
 	  ptr /= 16;
@@ -478,32 +727,48 @@ int kvprintf(const char *format, va_list arg) {
 	    ptr /= 16;
 	  }
 	  while (p_buf != buf) {
-	    kputchar(*--p_buf);
+	    kv_putchar(out, *--p_buf);
 		res++;
 	  }
-	  kputchar(lsh);
+	  kv_putchar(out, lsh);
 	  res++;
 	}
 	break;
       case '%':
-	kputchar('%');
+	kv_putchar(out, '%');
 	res++;
 	break;
       default:
-	kputchar('%');
+	kv_putchar(out, '%');
 	res++;
-	kputchar(*format);
+	kv_putchar(out, *format);
 	res++;
       }
     } else {
-      kputchar(*format);
+      kv_putchar(out, *format);
 	  res++;
 	}
     ++format;
   }
+  kv_flush(out);
   return res;
 }
 
+int kvprintf(const char *format, va_list arg) {
+  kv_out_t out = { .len = 0, .sync = 0 };
+  return kvprintf_out(&out, format, arg);
+}
+
+/**
+ * @brief kvprintf() bypassing the console ring (stderr): buffered output is flushed
+ *        first, then the message is written synchronously.
+ */
+int kvprintf_unbuffered(const char *format, va_list arg) {
+  kv_out_t out = { .len = 0, .sync = 1 };
+  kconsole_flush();
+  return kvprintf_out(&out, format, arg);
+}
+
 /**
  * @brief Limited version of printf() which only supports the following specifiers:
  * 
@@ -14,4 +14,11 @@ int kvsnprintf(char *buffer, size_t buffer_size, const char *format, va_list arg
 int kgetchar();
 int kreadchar();
 
+// asynchronous console (see uart_serial.c)
+void kconsole_start(bool irq);
+void kconsole_idle(void);
+void kconsole_flush(void);
+void kconsole_print_stats(void);
+int kvprintf_unbuffered(const char *format, va_list arg);
+
 #endif
\ No newline at end of file
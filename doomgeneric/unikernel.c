@@ -1,5 +1,6 @@
 #include <stdint.h>
 #include "syscon.h"
+#include "uart_serial.h"
 
 // "test" syscon-compatible device is at memory-mapped address 0x100000
 // according to our device tree
@@ -7,11 +8,26 @@
 
 void poweroff(void) {
   //kputs("Poweroff requested");
+  kconsole_flush();
   *(uint32_t *)SYSCON_ADDR = 0x5555;
 }
 
+/**
+ * @brief Powers off reporting an exit status: QEMU exits with 'status'
+ *        (test device FAIL code when it is not zero).
+ */
+void poweroff_exit(int status) {
+  if (status == 0) {
+    poweroff();
+    return;
+  }
+  kconsole_flush();
+  *(uint32_t *)SYSCON_ADDR = ((status & 0xffff) << 16) | 0x3333;
+}
+
 void reboot(void) {
   //kputs("Reboot requested");
+  kconsole_flush();
   *(uint32_t *)SYSCON_ADDR = 0x7777;
 }
 
@@ -30,6 +30,7 @@
 #include "deh_str.h"
 #include "i_swap.h"
 #include "i_video.h"
+#include "m_argv.h"
 #include "m_bbox.h"
 #include "m_misc.h"
 #include "v_video.h"
@@ -91,13 +92,13 @@ void V_CopyRect(int srcx, int srcy, byte *source,
  
 #ifdef RANGECHECK 
     if (srcx < 0
-     || srcx + width > SCREENWIDTH
+     || srcx + width > ORIGWIDTH
      || srcy < 0
-     || srcy + height > SCREENHEIGHT 
+     || srcy + height > ORIGHEIGHT 
      || destx < 0
-     || destx + width > SCREENWIDTH
+     || destx + width > ORIGWIDTH
      || desty < 0
-     || desty + height > SCREENHEIGHT)
+     || desty + height > ORIGHEIGHT)
     {
         I_Error ("Bad V_CopyRect");
     }
@@ -105,8 +106,24 @@ void V_CopyRect(int srcx, int srcy, byte *source,
 
     V_MarkRect(destx, desty, width, height); 
  
-    src = source + SCREENWIDTH * srcy + srcx; 
-    dest = dest_screen + SCREENWIDTH * desty + destx; 
+    // Both screens have the same size and layout.
+
+    src = source + SCREENOFS(srcx << hires, srcy << hires); 
+    dest = dest_screen + SCREENOFS(destx << hires, desty << hires); 
+
+    width <<= hires;
+    height <<= hires;
+
+    if (colmajor)
+    {
+        for ( ; width>0 ; width--) 
+        { 
+            memcpy(dest, src, height); 
+            src += SCREENHEIGHT; 
+            dest += SCREENHEIGHT; 
+        } 
+        return;
+    }
 
     for ( ; height>0 ; height--) 
     { 
@@ -131,19 +148,61 @@ void V_SetPatchClipCallback(vpatchclipfunc_t func)
     patchclip_callback = func;
 }
 
+//
+// V_DrawPatchColumn
+// Draws the posts of a patch column at desttop.
+// With -hires each pixel is doubled in both directions.
+//
+
+static void V_DrawPatchColumn(byte *desttop, column_t *column)
+{
+    int count;
+    byte *dest;
+    byte *source;
+    int xstep, ystep;
+
+    xstep = SCREENXSTEP;
+    ystep = SCREENYSTEP;
+
+    // step through the posts in a column
+    while (column->topdelta != 0xff)
+    {
+        source = (byte *)column + 3;
+        dest = desttop + (column->topdelta << hires) * ystep;
+        count = column->length;
+
+        if (hires)
+        {
+            while (count--)
+            {
+                dest[0] = dest[xstep] = *source;
+                dest[ystep] = dest[ystep + xstep] = *source++;
+                dest += ystep * 2;
+            }
+        }
+        else
+        {
+            while (count--)
+            {
+                *dest = *source++;
+                dest += ystep;
+            }
+        }
+        column = (column_t *)((byte *)column + column->length + 4);
+    }
+}
+
 //
 // V_DrawPatch
 // Masks a column based masked pic to the screen. 
+// x and y are in the 320x200 screen, also with -hires.
 //
 
 void V_DrawPatch(int x, int y, patch_t *patch)
 { 
-    int count;
     int col;
     column_t *column;
     byte *desttop;
-    byte *dest;
-    byte *source;
     int w;
 
     y -= SHORT(patch->topoffset);
@@ -158,9 +217,9 @@ void V_DrawPatch(int x, int y, patch_t *patch)
 
 #ifdef RANGECHECK
     if (x < 0
-     || x + SHORT(patch->width) > SCREENWIDTH
+     || x + SHORT(patch->width) > ORIGWIDTH
      || y < 0
-     || y + SHORT(patch->height) > SCREENHEIGHT)
+     || y + SHORT(patch->height) > ORIGHEIGHT)
     {
         I_Error("Bad V_DrawPatch x=%i y=%i patch.width=%i patch.height=%i topoffset=%i leftoffset=%i", x, y, patch->width, patch->height, patch->topoffset, patch->leftoffset);
     }
@@ -169,28 +228,14 @@ void V_DrawPatch(int x, int y, patch_t *patch)
     V_MarkRect(x, y, SHORT(patch->width), SHORT(patch->height));
 
     col = 0;
-    desttop = dest_screen + y * SCREENWIDTH + x;
+    desttop = dest_screen + SCREENOFS(x << hires, y << hires);
 
     w = SHORT(patch->width);
 
-    for ( ; col<w ; x++, col++, desttop++)
+    for ( ; col<w ; x++, col++, desttop += SCREENXSTEP << hires)
     {
         column = (column_t *)((byte *)patch + LONG(patch->columnofs[col]));
-
-        // step through the posts in a column
-        while (column->topdelta != 0xff)
-        {
-            source = (byte *)column + 3;
-            dest = desttop + column->topdelta*SCREENWIDTH;
-            count = column->length;
-
-            while (count--)
-            {
-                *dest = *source++;
-                dest += SCREENWIDTH;
-            }
-            column = (column_t *)((byte *)column + column->length + 4);
-        }
+        V_DrawPatchColumn(desttop, column);
     }
 }
 
@@ -202,12 +247,9 @@ void V_DrawPatch(int x, int y, patch_t *patch)
 
 void V_DrawPatchFlipped(int x, int y, patch_t *patch)
 {
-    int count;
     int col; 
     column_t *column; 
     byte *desttop;
-    byte *dest;
-    byte *source; 
     int w; 
  
     y -= SHORT(patch->topoffset); 
@@ -222,9 +264,9 @@ void V_DrawPatchFlipped(int x, int y, patch_t *patch)
 
 #ifdef RANGECHECK 
     if (x < 0
-     || x + SHORT(patch->width) > SCREENWIDTH
+     || x + SHORT(patch->width) > ORIGWIDTH
      || y < 0
-     || y + SHORT(patch->height) > SCREENHEIGHT)
+     || y + SHORT(patch->height) > ORIGHEIGHT)
     {
         I_Error("Bad V_DrawPatchFlipped");
     }
@@ -233,28 +275,14 @@ void V_DrawPatchFlipped(int x, int y, patch_t *patch)
     V_MarkRect (x, y, SHORT(patch->width), SHORT(patch->height));
 
     col = 0;
-    desttop = dest_screen + y * SCREENWIDTH + x;
+    desttop = dest_screen + SCREENOFS(x << hires, y << hires);
 
     w = SHORT(patch->width);
 
-    for ( ; col<w ; x++, col++, desttop++)
+    for ( ; col<w ; x++, col++, desttop += SCREENXSTEP << hires)
     {
         column = (column_t *)((byte *)patch + LONG(patch->columnofs[w-1-col]));
-
-        // step through the posts in a column
-        while (column->topdelta != 0xff )
-        {
-            source = (byte *)column + 3;
-            dest = desttop + column->topdelta*SCREENWIDTH;
-            count = column->length;
-
-            while (count--)
-            {
-                *dest = *source++;
-                dest += SCREENWIDTH;
-            }
-            column = (column_t *)((byte *)column + column->length + 4);
-        }
+        V_DrawPatchColumn(desttop, column);
     }
 }
 
@@ -295,10 +323,10 @@ void V_DrawTLPatch(int x, int y, patch_t * patch)
     }
 
     col = 0;
-    desttop = dest_screen + y * SCREENWIDTH + x;
+    desttop = dest_screen + SCREENOFS(x, y);
 
     w = SHORT(patch->width);
-    for (; col < w; x++, col++, desttop++)
+    for (; col < w; x++, col++, desttop += SCREENXSTEP)
     {
         column = (column_t *) ((byte *) patch + LONG(patch->columnofs[col]));
 
@@ -307,13 +335,13 @@ void V_DrawTLPatch(int x, int y, patch_t * patch)
         while (column->topdelta != 0xff)
         {
             source = (byte *) column + 3;
-            dest = desttop + column->topdelta * SCREENWIDTH;
+            dest = desttop + column->topdelta * SCREENYSTEP;
             count = column->length;
 
             while (count--)
             {
                 *dest = tinttable[((*dest) << 8) + *source++];
-                dest += SCREENWIDTH;
+                dest += SCREENYSTEP;
             }
             column = (column_t *) ((byte *) column + column->length + 4);
         }
@@ -343,10 +371,10 @@ void V_DrawXlaPatch(int x, int y, patch_t * patch)
     }
 
     col = 0;
-    desttop = dest_screen + y * SCREENWIDTH + x;
+    desttop = dest_screen + SCREENOFS(x, y);
 
     w = SHORT(patch->width);
-    for(; col < w; x++, col++, desttop++)
+    for(; col < w; x++, col++, desttop += SCREENXSTEP)
     {
         column = (column_t *) ((byte *) patch + LONG(patch->columnofs[col]));
 
@@ -355,14 +383,14 @@ void V_DrawXlaPatch(int x, int y, patch_t * patch)
         while(column->topdelta != 0xff)
         {
             source = (byte *) column + 3;
-            dest = desttop + column->topdelta * SCREENWIDTH;
+            dest = desttop + column->topdelta * SCREENYSTEP;
             count = column->length;
 
             while(count--)
             {
                 *dest = xlatab[*dest + ((*source) << 8)];
                 source++;
-                dest += SCREENWIDTH;
+                dest += SCREENYSTEP;
             }
             column = (column_t *) ((byte *) column + column->length + 4);
         }
@@ -394,10 +422,10 @@ void V_DrawAltTLPatch(int x, int y, patch_t * patch)
     }
 
     col = 0;
-    desttop = dest_screen + y * SCREENWIDTH + x;
+    desttop = dest_screen + SCREENOFS(x, y);
 
     w = SHORT(patch->width);
-    for (; col < w; x++, col++, desttop++)
+    for (; col < w; x++, col++, desttop += SCREENXSTEP)
     {
         column = (column_t *) ((byte *) patch + LONG(patch->columnofs[col]));
 
@@ -406,13 +434,13 @@ void V_DrawAltTLPatch(int x, int y, patch_t * patch)
         while (column->topdelta != 0xff)
         {
             source = (byte *) column + 3;
-            dest = desttop + column->topdelta * SCREENWIDTH;
+            dest = desttop + column->topdelta * SCREENYSTEP;
             count = column->length;
 
             while (count--)
             {
                 *dest = tinttable[((*dest) << 8) + *source++];
-                dest += SCREENWIDTH;
+                dest += SCREENYSTEP;
             }
             column = (column_t *) ((byte *) column + column->length + 4);
         }
@@ -445,11 +473,11 @@ void V_DrawShadowedPatch(int x, int y, patch_t *patch)
     }
 
     col = 0;
-    desttop = dest_screen + y * SCREENWIDTH + x;
-    desttop2 = dest_screen + (y + 2) * SCREENWIDTH + x + 2;
+    desttop = dest_screen + SCREENOFS(x, y);
+    desttop2 = dest_screen + SCREENOFS(x + 2, y + 2);
 
     w = SHORT(patch->width);
-    for (; col < w; x++, col++, desttop++, desttop2++)
+    for (; col < w; x++, col++, desttop += SCREENXSTEP, desttop2 += SCREENXSTEP)
     {
         column = (column_t *) ((byte *) patch + LONG(patch->columnofs[col]));
 
@@ -458,16 +486,16 @@ void V_DrawShadowedPatch(int x, int y, patch_t *patch)
         while (column->topdelta != 0xff)
         {
             source = (byte *) column + 3;
-            dest = desttop + column->topdelta * SCREENWIDTH;
-            dest2 = desttop2 + column->topdelta * SCREENWIDTH;
+            dest = desttop + column->topdelta * SCREENYSTEP;
+            dest2 = desttop2 + column->topdelta * SCREENYSTEP;
             count = column->length;
 
             while (count--)
             {
                 *dest2 = tinttable[((*dest2) << 8)];
-                dest2 += SCREENWIDTH;
+                dest2 += SCREENYSTEP;
                 *dest = *source++;
-                dest += SCREENWIDTH;
+                dest += SCREENYSTEP;
 
             }
             column = (column_t *) ((byte *) column + column->length + 4);
@@ -498,6 +526,9 @@ void V_LoadXlaTable(void)
 //
 // V_DrawBlock
 // Draw a linear block of pixels into the view buffer.
+// Unlike patches, the block is in screen pixels, and its pixels
+// are stored in the layout of the screens: rows of width pixels,
+// or columns of height pixels with -colmajor.
 //
 
 void V_DrawBlock(int x, int y, int width, int height, byte *src) 
@@ -516,7 +547,18 @@ void V_DrawBlock(int x, int y, int width, int height, byte *src)
  
     V_MarkRect (x, y, width, height); 
  
-    dest = dest_screen + y * SCREENWIDTH + x; 
+    dest = dest_screen + SCREENOFS(x, y); 
+
+    if (colmajor)
+    {
+	while (width--) 
+	{ 
+	    memcpy (dest, src, height); 
+	    src += height; 
+	    dest += SCREENHEIGHT; 
+	} 
+	return;
+    }
 
     while (height--) 
     { 
@@ -531,7 +573,12 @@ void V_DrawFilledBox(int x, int y, int w, int h, int c)
     uint8_t *buf, *buf1;
     int x1, y1;
 
-    buf = I_VideoBuffer + SCREENWIDTH * y + x;
+    x <<= hires;
+    y <<= hires;
+    w <<= hires;
+    h <<= hires;
+
+    buf = I_VideoBuffer + SCREENOFS(x, y);
 
     for (y1 = 0; y1 < h; ++y1)
     {
@@ -539,38 +586,22 @@ void V_DrawFilledBox(int x, int y, int w, int h, int c)
 
         for (x1 = 0; x1 < w; ++x1)
         {
-            *buf1++ = c;
+            *buf1 = c;
+            buf1 += SCREENXSTEP;
         }
 
-        buf += SCREENWIDTH;
+        buf += SCREENYSTEP;
     }
 }
 
 void V_DrawHorizLine(int x, int y, int w, int c)
 {
-    uint8_t *buf;
-    int x1;
-
-    buf = I_VideoBuffer + SCREENWIDTH * y + x;
-
-    for (x1 = 0; x1 < w; ++x1)
-    {
-        *buf++ = c;
-    }
+    V_DrawFilledBox(x, y, w, 1, c);
 }
 
 void V_DrawVertLine(int x, int y, int h, int c)
 {
-    uint8_t *buf;
-    int y1;
-
-    buf = I_VideoBuffer + SCREENWIDTH * y + x;
-
-    for (y1 = 0; y1 < h; ++y1)
-    {
-        *buf = c;
-        buf += SCREENWIDTH;
-    }
+    V_DrawFilledBox(x, y, 1, h, c);
 }
 
 void V_DrawBox(int x, int y, int w, int h, int c)
@@ -588,7 +619,21 @@ void V_DrawBox(int x, int y, int w, int h, int c)
  
 void V_DrawRawScreen(byte *raw)
 {
-    memcpy(dest_screen, raw, SCREENWIDTH * SCREENHEIGHT);
+    int x, y;
+
+    if (!hires && !colmajor)
+    {
+        memcpy(dest_screen, raw, SCREENWIDTH * SCREENHEIGHT);
+        return;
+    }
+
+    for (y = 0; y < SCREENHEIGHT; y++)
+    {
+        for (x = 0; x < SCREENWIDTH; x++)
+        {
+            dest_screen[SCREENOFS(x, y)] = raw[(y >> hires) * ORIGWIDTH + (x >> hires)];
+        }
+    }
 }
 
 //
@@ -596,9 +641,34 @@ void V_DrawRawScreen(byte *raw)
 // 
 void V_Init (void) 
 { 
-    // no-op!
     // There used to be separate screens that could be drawn to; these are
     // now handled in the upper layers.
+
+    //!
+    // @category video
+    //
+    // Render the 3D view at 640x400, the size of the frame buffer,
+    // instead of scaling up 320x200. Menus, the status bar and the
+    // other 2D graphics are drawn with their pixels doubled.
+    //
+
+    if (M_CheckParm("-hires"))
+    {
+        hires = 1;
+    }
+
+    //!
+    // @category video
+    //
+    // Store the screens column by column, so that the wall and
+    // sprite columns of the 3D view are drawn to contiguous bytes.
+    // The frame is transposed when it is presented.
+    //
+
+    if (M_CheckParm("-colmajor"))
+    {
+        colmajor = 1;
+    }
 }
 
 // Set the buffer that the code draws to.
@@ -793,6 +863,7 @@ void V_ScreenShot(char *format)
     int i;
     char lbmname[16]; // haleyjd 20110213: BUG FIX - 12 is too small!
     char *ext;
+    byte *screen;
     
     // find a file name to save it to
 
@@ -823,10 +894,23 @@ void V_ScreenShot(char *format)
         I_Error ("V_ScreenShot: Couldn't create a PCX");
     }
 
+    // Image files are stored row by row.
+    screen = I_VideoBuffer;
+
+    if (colmajor)
+    {
+        screen = Z_Malloc(SCREENWIDTH * SCREENHEIGHT, PU_STATIC, NULL);
+
+        for (i = 0; i < SCREENHEIGHT; i++)
+        {
+            I_ReadScreenRow(I_VideoBuffer, i, screen + i * SCREENWIDTH);
+        }
+    }
+
 #ifdef HAVE_LIBPNG
     if (png_screenshots)
     {
-    WritePNGfile(lbmname, I_VideoBuffer,
+    WritePNGfile(lbmname, screen,
                  SCREENWIDTH, SCREENHEIGHT,
                  W_CacheLumpName (DEH_String("PLAYPAL"), PU_CACHE));
     }
@@ -834,10 +918,15 @@ void V_ScreenShot(char *format)
 #endif
     {
     // save the pcx file
-    WritePCXfile(lbmname, I_VideoBuffer,
+    WritePCXfile(lbmname, screen,
                  SCREENWIDTH, SCREENHEIGHT,
                  W_CacheLumpName (DEH_String("PLAYPAL"), PU_CACHE));
     }
+
+    if (screen != I_VideoBuffer)
+    {
+        Z_Free(screen);
+    }
 }
 
 #define MOUSE_SPEED_BOX_WIDTH  120
@@ -872,7 +961,7 @@ void V_DrawMouseSpeedBox(int speed)
 
     // Calculate box position
 
-    box_x = SCREENWIDTH - MOUSE_SPEED_BOX_WIDTH - 10;
+    box_x = ORIGWIDTH - MOUSE_SPEED_BOX_WIDTH - 10;
     box_y = 15;
 
     V_DrawFilledBox(box_x, box_y,
@@ -1,6 +1,8 @@
 // CLINT (Core Local Interruptor) registers
 #include "virt_clint.h"
 #include "uart_serial.h"
+#include "plic.h"
+#include "prof.h"
 
 // inline asm in C language
 // see https://gcc.gnu.org/onlinedocs/gcc/Extended-Asm.html
@@ -63,18 +65,74 @@ void enable_timer_interrupt() {
 #define MCAUSE_INTERRUPT 0x8000000000000000UL
 #define MCAUSE_CODE_MASK 0x7ff
 #define MCAUSE_MTI 7    // Machine Timer Interrupt
-
+#define MCAUSE_MEI 11   // Machine External Interrupt (PLIC)
+
+// Timer deadlines of hart 0 sharing its 'mtimecmp' (mtime ticks)
+#define NO_DEADLINE     UINT64_MAX
+
+static volatile uint64_t sleep_deadline = NO_DEADLINE;     // sleep_us() wakeup
+static volatile uint64_t profile_deadline = NO_DEADLINE;   // next profiler sample
+static uint64_t profile_period;
+
+// set by input interrupts (PLIC_WAKE): they end sleep_us() early, profiler samples
+// and console output don't
+static volatile int sleep_woken;
+
+// hart 0 sleep statistics (clint_print_stats)
+static struct {
+    uint64_t start;         // mtime at init_interrupts()
+    uint64_t sleeps;        // sleep_until() calls that waited
+    uint64_t wakeups;       // returns from 'wfi'
+    uint64_t early;         // sleeps ended by an input interrupt
+    uint64_t late_total;    // deadline to wakeup, sleeps that reached their deadline
+    uint64_t late_max;
+} sleep_stats;
+
+// Arm 'mtimecmp' for the nearest deadline, or mask the timer interrupt if none
+static void program_timer() {
+    uint64_t next = sleep_deadline < profile_deadline ? sleep_deadline : profile_deadline;
+
+    if (next == NO_DEADLINE) {
+        asm volatile("csrc mie, %0" :: "r"(MIE_MTIE));
+        return;
+    }
+    write_mtimecmp(next);
+    asm volatile("csrs mie, %0" :: "r"(MIE_MTIE));
+}
 
 __attribute__((interrupt ("machine")))
+__attribute__((optimize ("omit-frame-pointer")))   // keep s0 as the interrupted code set it
 __attribute__((aligned(4)))     // IMPORTANT setting 'mvect' register requires aligned address
-/* Very basic interrupt handler, based on the assumption that we have just timer interrupt events */
+/* Interrupt handler: timer (sleep_us() wakeup, profiler) and device interrupts through the PLIC */
 void handle_interrupt(void) {
+    uint64_t fp;
+    // frame pointer of the interrupted code: read before s0 is used by this handler
+    asm volatile("mv %0, s0" : "=r"(fp));
+
+    uint64_t mcause;
+    asm volatile("csrr %0, mcause" : "=r"(mcause));
+
+    if ((mcause & MCAUSE_INTERRUPT) && (mcause & MCAUSE_CODE_MASK) == MCAUSE_MEI) {
+        // console output interrupts must not end the sleep
+        if (plic_dispatch())
+            sleep_woken = 1;
+        return;
+    }
+
     //kprintf("handle_interrupt()\n");
-    asm volatile("csrc mie, %0" 
-        : /* Outputs: */
-        : /* Inputs: */ "r"(MIE_MTIE)
-        : /* Clobbered registers: */ 
-    );
+    uint64_t now = read_mtime();
+
+    if (now >= profile_deadline) {
+        uint64_t mepc;
+        asm volatile("csrr %0, mepc" : "=r"(mepc));
+        prof_sample(mepc, fp);
+        // from now on, not from the missed deadline: no burst after a long masked section
+        profile_deadline = now + profile_period;
+    }
+    if (now >= sleep_deadline)
+        sleep_deadline = NO_DEADLINE;
+
+    program_timer();
 }
 
 // Initialize interupts
@@ -85,6 +143,7 @@ int init_interrupts() {
     uint64_t mtvec_value;
     asm volatile("csrr %0, mtvec" : "=r"(mtvec_value));
     kprintf("init_interrupts(): mtvec register value [%p]\n", mtvec_value);
+    sleep_stats.start = read_mtime();
     if (mtvec_value != (uint64_t)&handle_interrupt) {
         kprintf("init_interrupts(): ERROR since 'mtvect' update value failed!\n");
         return -1;
@@ -92,14 +151,67 @@ int init_interrupts() {
     return 0;
 }
 
-// sleep execution for specified number of microseconds
+// sleep until 'mtime' reaches 'deadline', or until an input interrupt:
+// one timer, armed once, whatever the length of the wait
+void sleep_until(uint64_t deadline) {
+    // interrupts masked while checking the wakeup conditions: 'wfi' still
+    // resumes on a pending one, which is taken when they are enabled again
+    asm volatile("csrc mstatus, %0" :: "r"(MSTATUS_MIE));
+    if (read_mtime() >= deadline) {
+        asm volatile("csrs mstatus, %0" :: "r"(MSTATUS_MIE));
+        return;
+    }
+    sleep_woken = 0;
+    sleep_deadline = deadline;
+    program_timer();
+
+    while (sleep_deadline != NO_DEADLINE && !sleep_woken) {
+        asm volatile("wfi");    // interrupt controlled waiting (Wait For Interrupt)
+        asm volatile("csrs mstatus, %0" :: "r"(MSTATUS_MIE));
+        asm volatile("csrc mstatus, %0" :: "r"(MSTATUS_MIE));
+        sleep_stats.wakeups++;
+    }
+
+    uint64_t now = read_mtime();
+    sleep_stats.sleeps++;
+    if (now < deadline) {
+        sleep_stats.early++;
+    } else {
+        uint64_t late = now - deadline;
+        sleep_stats.late_total += late;
+        if (late > sleep_stats.late_max)
+            sleep_stats.late_max = late;
+    }
+
+    sleep_deadline = NO_DEADLINE;
+    program_timer();
+    asm volatile("csrs mstatus, %0" :: "r"(MSTATUS_MIE));
+}
+
+// sleep execution for specified number of microseconds, or until an input interrupt
 void sleep_us(uint64_t us) {
     //kprintf("sleep_us(): us [%d]\n", us);
-    uint64_t now = read_mtime();
-    uint64_t target = now + (us * (MTIME_FREQ/1000000));
-    write_mtimecmp(target);
-    
-    enable_timer_interrupt();
+    sleep_until(read_mtime() + (us * (MTIME_FREQ/1000000)));
+}
+
+void clint_print_stats(void) {
+    uint64_t elapsed = read_mtime() - sleep_stats.start;
+    uint64_t seconds = elapsed / MTIME_FREQ;
+    uint64_t timed = sleep_stats.sleeps - sleep_stats.early;
+    uint64_t avg = timed ? sleep_stats.late_total / timed : 0;
+    // mtime is 10MHz: 10 ticks per us
+    kprintf("clint: sleeps [%d], ended by interrupt [%d], wakeups [%d] ([%d] per second), "
+            "wakeup delay avg [%d]us max [%d]us\n",
+            sleep_stats.sleeps, sleep_stats.early, sleep_stats.wakeups,
+            seconds ? sleep_stats.wakeups / seconds : sleep_stats.wakeups,
+            avg / 10, sleep_stats.late_max / 10);
+}
 
-    asm volatile("wfi");    // interrupt controlled waiting (Wait For Interrupt)
+// sample the running code every 'period' mtime ticks from the timer interrupt (0: stop)
+void set_profile_timer(uint64_t period) {
+    asm volatile("csrc mstatus, %0" :: "r"(MSTATUS_MIE));
+    profile_period = period;
+    profile_deadline = period ? read_mtime() + period : NO_DEADLINE;
+    program_timer();
+    asm volatile("csrs mstatus, %0" :: "r"(MSTATUS_MIE));
 }
@@ -7,5 +7,8 @@
 int init_interrupts();
 
 void sleep_us(uint64_t us);
+void sleep_until(uint64_t deadline);
+void clint_print_stats(void);
+void set_profile_timer(uint64_t period);
 
 #endif
\ No newline at end of file
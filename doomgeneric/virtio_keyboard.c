@@ -4,6 +4,8 @@
 #include <stdint.h>
 #include <stddef.h>
 #include "uart_serial.h"
+#include "rtc.h"
+#include "plic.h"
 #include "virtio_keyboard.h"
 
 // Qemu address for Virtio MMIO array of devices, as defined in Device Tree.
@@ -76,8 +78,11 @@ enum {
 };
 
 
-// Virtqueue constants
-#define QUEUE_SIZE (1<<3)   // 8
+// Virtqueue constants: deep enough for bursts of key events between two reads
+#define QUEUE_SIZE (1<<6)   // 64, at most (power of 2, see queue_num)
+
+// Key events taken from the virtqueue, waiting for virtio_keyboard_read_event()
+#define EVENT_RING_SIZE 256 // power of 2
 
 // Descriptor flags
 #define VIRTQ_DESC_F_NEXT  1
@@ -124,6 +129,34 @@ static struct virtio_input_event buffers[QUEUE_SIZE];
 // Track next used slot
 static uint16_t used_idx  = 0;
 
+// negotiated virtqueue size
+static uint16_t queue_num = QUEUE_SIZE;
+
+// index of the keyboard in 'virtio_mmio_devices[]'
+static int keyboard_dev = -1;
+
+// events are taken from the virtqueue by the interrupt handler (or by the reader when polling)
+static int irq_mode = 0;
+
+// single producer (interrupt handler), single consumer (game loop) ring, both on hart 0
+typedef struct {
+    struct virtio_input_event event;
+    uint64_t arrival;       // mtime when taken from the virtqueue
+} key_event_t;
+
+static key_event_t event_ring[EVENT_RING_SIZE];
+static volatile uint32_t event_head = 0;   // next event to read
+static volatile uint32_t event_tail = 0;   // next free slot
+
+static struct {
+    uint64_t irqs;
+    uint64_t events;
+    uint64_t dropped;       // ring full
+    uint32_t max_depth;
+    uint64_t latency_total; // from virtqueue to reader (mtime ticks)
+    uint64_t latency_max;
+} kbd_stats;
+
 
 int detect_virtio_keyboard(void) {
     for (int n=0; n<VIRTIO_MMIO_SZ ; ++n) {
@@ -186,9 +219,13 @@ int virtio_keyboard_init(void)
     // Setup single virtqueue (id==0)
     virtio_mmio_devices[dev_idx].queueSel = 0; // queue id == 0
     uint32_t qmax = virtio_mmio_devices[dev_idx].queueNumMax;
-    if (qmax < QUEUE_SIZE)
+    if (qmax == 0)
         return -3;
-    virtio_mmio_devices[dev_idx].queueNum = QUEUE_SIZE;
+    // split virtqueue sizes are powers of 2
+    queue_num = QUEUE_SIZE;
+    while (queue_num > qmax)
+        queue_num >>= 1;
+    virtio_mmio_devices[dev_idx].queueNum = queue_num;
 
     // configure Descriptor ring
     virtio_mmio_devices[dev_idx].queueDescLow = ((uintptr_t)desc) & 0xffffffff;
@@ -204,7 +241,7 @@ int virtio_keyboard_init(void)
     virtio_mmio_devices[dev_idx].queueReady = 1;
 
     // Populate the “available” ring with our buffers
-    for (uint16_t i = 0; i < QUEUE_SIZE; i++) {
+    for (uint16_t i = 0; i < queue_num; i++) {
         desc[i].addr  = (uint64_t)(uintptr_t)&buffers[i];
         desc[i].len   = sizeof(buffers[i]);
         desc[i].flags = VIRTQ_DESC_F_WRITE;   // device writes events into us
@@ -212,44 +249,141 @@ int virtio_keyboard_init(void)
 
         avail.ring[i] = i;
     }
-    // ask device not to use interrupt on new events. we'll pool for new events
+    // ask device not to use interrupt on new events until virtio_keyboard_enable_irq()
     avail.flags = VIRTQ_AVAIL_F_NO_INTERRUPT;
     // Publish initial avail.idx
-    avail.idx   = QUEUE_SIZE;
+    avail.idx   = queue_num;
 
     // Finally tell device we’re fully up
-    kprintf("Notify device driver is ok\n");
+    kprintf("Notify device driver is ok, queue size [%d]\n", queue_num);
     virtio_mmio_devices[dev_idx].status |= VIRTIO_STATUS_DRIVER_OK;
+    keyboard_dev = dev_idx;
 
     return 0;
 }
 
-
-//-------------------------------------------------------------
-// Read the next key scancode (blocks/polls)
-//-------------------------------------------------------------
-struct virtio_input_event virtio_keyboard_read_event(void)
+// Moves key events from the used ring to the event ring and gives the buffers back to the device.
+// Runs in the interrupt handler (or in the reader when polling): no libc calls.
+static void drain_used_ring(void)
 {
-    while (used_idx < used.idx) { // Check for a used buffer
-        //kprintf("virtio_keyboard_read_scancode(): used.idx [%d], used_idx [%d]\n", used.idx, used_idx);
+    uint64_t now = kmtime();
+    int requeued = 0;
 
+    while (used_idx != used.idx) { // Check for a used buffer
         // get event
-        uint32_t buf_id = used.ring[used_idx % QUEUE_SIZE].id;
-        struct virtio_input_event e = buffers[buf_id];
+        uint32_t buf_id = used.ring[used_idx % queue_num].id;
+        struct virtio_input_event e;
+        e.type = buffers[buf_id].type;
+        e.code = buffers[buf_id].code;
+        e.value = buffers[buf_id].value;
 
         // Re-queue this buffer for more events
         desc[buf_id].flags  = VIRTQ_DESC_F_WRITE;
-        avail.ring[avail.idx % QUEUE_SIZE] = buf_id;
+        avail.ring[avail.idx % queue_num] = buf_id;
+        __atomic_thread_fence(__ATOMIC_RELEASE);    // ring entry visible before index
         avail.idx++;
+        requeued = 1;
 
         // keep track of used events
         used_idx++;
 
-        // return on key-press events (type=1, value=1) or key-released (type=1, value=0)
-        //kprintf("e->type [%d], e->code [%d], e->value [%d]\n", e.type, e.code, e.value);
-        if (e.type == VirtioInputEvKey)
-            return e;
+        // keep key-press events (type=1, value=1) or key-released (type=1, value=0)
         // skip non-key event (if any)
+        if (e.type != VirtioInputEvKey)
+            continue;
+
+        uint32_t depth = event_tail - event_head;
+        if (depth >= EVENT_RING_SIZE) {
+            kbd_stats.dropped++;    // reader is too late: drop newest
+            continue;
+        }
+        key_event_t *slot = &event_ring[event_tail % EVENT_RING_SIZE];
+        slot->event.type = e.type;
+        slot->event.code = e.code;
+        slot->event.value = e.value;
+        slot->arrival = now;
+        __atomic_thread_fence(__ATOMIC_RELEASE);
+        event_tail++;
+
+        kbd_stats.events++;
+        if (depth + 1 > kbd_stats.max_depth)
+            kbd_stats.max_depth = depth + 1;
+    }
+
+    // device may be waiting for buffers
+    if (requeued)
+        virtio_mmio_devices[keyboard_dev].queueNotify = 0;
+}
+
+// PLIC handler of the keyboard device
+static void virtio_keyboard_irq(void *arg)
+{
+    uint32_t status = virtio_mmio_devices[keyboard_dev].interruptStatus;
+    virtio_mmio_devices[keyboard_dev].interruptAck = status;
+
+    kbd_stats.irqs++;
+    drain_used_ring();
+}
+
+/**
+ * @brief Switches from polling to interrupts: events are queued by the PLIC handler
+ *        and a key event wakes hart 0 from 'wfi'. Requires plic_init().
+ *
+ * @return 0 on success, -1 if the keyboard is not initialized
+ */
+int virtio_keyboard_enable_irq(void)
+{
+    if (keyboard_dev < 0)
+        return -1;
+    if (plic_register(PLIC_IRQ_VIRTIO(keyboard_dev), virtio_keyboard_irq, NULL, PLIC_WAKE) != 0)
+        return -1;
+
+    irq_mode = 1;
+    avail.flags = 0;
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+    // events which arrived while interrupts were off
+    drain_used_ring();
+    return 0;
+}
+
+/**
+ * @brief Prints event counts and latency from virtqueue to reader.
+ */
+void virtio_keyboard_print_stats(void)
+{
+    uint64_t avg = kbd_stats.events ? kbd_stats.latency_total / kbd_stats.events : 0;
+
+    kprintf("virtio_keyboard: mode [%s], irqs [%d], key events [%d], dropped [%d], max queued [%d]\n",
+            irq_mode ? "irq" : "poll", kbd_stats.irqs, kbd_stats.events, kbd_stats.dropped,
+            kbd_stats.max_depth);
+    // mtime runs at 10 MHz
+    kprintf("virtio_keyboard: latency to reader avg [%d] us, max [%d] us\n",
+            avg / 10, kbd_stats.latency_max / 10);
+}
+
+
+//-------------------------------------------------------------
+// Read the next key event (does not block)
+//-------------------------------------------------------------
+struct virtio_input_event virtio_keyboard_read_event(void)
+{
+    if (!irq_mode && keyboard_dev >= 0 && event_head == event_tail)
+        drain_used_ring();
+
+    if (event_head != event_tail) {
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);    // event written before tail moved
+        key_event_t *slot = &event_ring[event_head % EVENT_RING_SIZE];
+        struct virtio_input_event e = slot->event;
+        uint64_t latency = kmtime() - slot->arrival;
+        __atomic_thread_fence(__ATOMIC_RELEASE);    // slot read before it is reused
+        event_head++;
+
+        kbd_stats.latency_total += latency;
+        if (latency > kbd_stats.latency_max)
+            kbd_stats.latency_max = latency;
+        //kprintf("e->type [%d], e->code [%d], e->value [%d]\n", e.type, e.code, e.value);
+        return e;
     }
     // no key event found
     struct virtio_input_event nokey = {.type = VirtioInputEvNone};
@@ -23,7 +23,10 @@ enum {
 
 
 int virtio_keyboard_init();
+int virtio_keyboard_enable_irq(void);
 
 struct virtio_input_event virtio_keyboard_read_event(void);
 
+void virtio_keyboard_print_stats(void);
+
 #endif
\ No newline at end of file
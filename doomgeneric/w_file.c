@@ -26,6 +26,7 @@
 #include "w_file.h"
 
 extern wad_file_class_t stdc_wad_file;
+extern wad_file_class_t fwcfg_wad_file;
 
 /*
 #ifdef _WIN32
@@ -47,6 +48,7 @@ static wad_file_class_t *wad_file_classes[] =
 #ifdef HAVE_MMAP
     &posix_wad_file,
 #endif
+    &fwcfg_wad_file,
     &stdc_wad_file,
 };
 
@@ -63,7 +65,17 @@ wad_file_t *W_OpenFile(char *path)
 
     if (!M_CheckParm("-mmap"))
     {
-        return stdc_wad_file.OpenFile(path);
+        // Files supplied by the host through fw_cfg take precedence
+        // over the WAD linked in the kernel image.
+
+        result = fwcfg_wad_file.OpenFile(path);
+
+        if (result == NULL)
+        {
+            result = stdc_wad_file.OpenFile(path);
+        }
+
+        return result;
     }
 
     // Try all classes in order until we find one that works
@@ -0,0 +1,126 @@
+//
+// Copyright(C) 1993-1996 Id Software, Inc.
+// Copyright(C) 2005-2014 Simon Howard
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	WAD I/O functions for files supplied by the host through
+//	QEMU fw_cfg, eg. -fw_cfg name=opt/doom/iwad,file=doom.wad
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "w_file.h"
+#include "z_zone.h"
+
+#include "qemu_dma.h"
+#include "rtc.h"
+
+typedef struct
+{
+    wad_file_t wad;
+    const fw_cfg_file_t *file;
+} fwcfg_wad_file_t;
+
+extern wad_file_class_t fwcfg_wad_file;
+
+// The whole file is copied into guest memory with DMA when it is
+// opened and exposed as a memory mapped file: lumps are then used
+// in place and never read again through fw_cfg.
+
+static wad_file_t *W_FwCfg_OpenFile(char *path)
+{
+    fwcfg_wad_file_t *result;
+    const fw_cfg_file_t *file;
+    byte *data;
+    uint64_t start;
+
+    file = fw_cfg_find(path);
+
+    if (file == NULL)
+    {
+        return NULL;
+    }
+
+    // The zone is far too small for an IWAD: use the heap.
+
+    data = malloc(file->size);
+
+    if (data == NULL)
+    {
+        printf("W_FwCfg_OpenFile: no memory for %s (%u bytes)\n",
+               path, file->size);
+        return NULL;
+    }
+
+    start = kmtime();
+
+    if (fw_cfg_read_file(file, 0, data, file->size) != file->size)
+    {
+        printf("W_FwCfg_OpenFile: failed to read %s\n", path);
+        free(data);
+        return NULL;
+    }
+
+    printf("W_FwCfg_OpenFile: %s, %u bytes in %d us\n",
+           path, file->size, (int) ((kmtime() - start) / 10));
+
+    result = Z_Malloc(sizeof(fwcfg_wad_file_t), PU_STATIC, 0);
+    result->wad.file_class = &fwcfg_wad_file;
+    result->wad.mapped = data;
+    result->wad.length = file->size;
+    result->file = file;
+
+    return &result->wad;
+}
+
+static void W_FwCfg_CloseFile(wad_file_t *wad)
+{
+    fwcfg_wad_file_t *fwcfg_wad;
+
+    fwcfg_wad = (fwcfg_wad_file_t *) wad;
+
+    free(fwcfg_wad->wad.mapped);
+    Z_Free(fwcfg_wad);
+}
+
+// Read data from the specified position in the file into the
+// provided buffer.  Returns the number of bytes read.
+
+static size_t W_FwCfg_Read(wad_file_t *wad, unsigned int offset,
+                           void *buffer, size_t buffer_len)
+{
+    if (offset >= wad->length)
+    {
+        return 0;
+    }
+
+    if (buffer_len > wad->length - offset)
+    {
+        buffer_len = wad->length - offset;
+    }
+
+    memcpy(buffer, wad->mapped + offset, buffer_len);
+
+    return buffer_len;
+}
+
+
+wad_file_class_t fwcfg_wad_file =
+{
+    W_FwCfg_OpenFile,
+    W_FwCfg_CloseFile,
+    W_FwCfg_Read,
+};
+
@@ -69,11 +69,22 @@ static wad_file_t *W_StdC_OpenFile(char *path) {
     printf("W_StdC_OpenFile: path [%s]\n", path);
 
     stdc_wad_file_t *result;
+    char *base;
+
+    // Only the IWAD is linked in the kernel image
+    base = strrchr(path, '/');
+    base = base != NULL ? base + 1 : path;
+    if (strcasecmp(base, "doom1.wad") != 0)
+    {
+        return NULL;
+    }
+
     // Create a new stdc_wad_file_t to hold the file handle.
 
     result = Z_Malloc(sizeof(stdc_wad_file_t), PU_STATIC, 0);
     result->wad.file_class = &stdc_wad_file;
-    result->wad.mapped = NULL;
+    // WAD is linked in the kernel image: expose it as a memory mapped file
+    result->wad.mapped = doom1_wad_start;
     result->wad.length = doom1_wad_sz;
     result->fstream = NULL; // no fstream since already in memory
 
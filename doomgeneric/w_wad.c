@@ -36,6 +36,10 @@
 
 #include "w_wad.h"
 
+#ifdef RENDER_SMP
+#include "smp.h"
+#endif
+
 typedef struct
 {
     // Should be "IWAD" or "PWAD".
@@ -56,6 +60,17 @@ typedef struct
 // GLOBALS
 //
 
+// Lump cache bookkeeping is shared by the game loop and the harts
+//  rendering in the background.
+#ifdef RENDER_SMP
+static spinlock_t	cachelock;
+#define W_LockCache()	spin_lock (&cachelock)
+#define W_UnlockCache()	spin_unlock (&cachelock)
+#else
+#define W_LockCache()
+#define W_UnlockCache()
+#endif
+
 // Location of each lump on disk.
 
 lumpinfo_t *lumpinfo;		
@@ -373,6 +388,24 @@ void W_ReadLump(unsigned int lump, void *dest)
 
 
 
+//
+// W_LumpIsMapped
+//
+// Lumps can be accessed in place when the WAD is memory mapped, provided
+// they are aligned for the widest field (32 bits) of the structures
+// overlaid on them; misaligned lumps are copied to the zone instead.
+// Lumps which are modified after loading (eg. BLOCKMAP) are read into
+// their own buffer with W_ReadLump, so the mapped data is never written.
+//
+
+static boolean W_LumpIsMapped(lumpinfo_t *lump)
+{
+    byte *mapped = lump->wad_file->mapped;
+
+    return mapped != NULL
+        && ((uintptr_t) (mapped + lump->position) & 3) == 0;
+}
+
 //
 // W_CacheLumpNum
 //
@@ -402,26 +435,33 @@ void *W_CacheLumpNum(int lumpnum, int tag)
     // region.  If the lump is in an ordinary file, we may already
     // have it cached; otherwise, load it into memory.
 
-    if (lump->wad_file->mapped != NULL)
+    if (W_LumpIsMapped(lump))
     {
         // Memory mapped file, return from the mmapped region.
 
         result = lump->wad_file->mapped + lump->position;
     }
-    else if (lump->cache != NULL)
-    {
-        // Already cached, so just switch the zone tag.
-
-        result = lump->cache;
-        Z_ChangeTag(lump->cache, tag);
-    }
     else
     {
-        // Not yet loaded, so load it now
+        W_LockCache();
+
+        if (lump->cache != NULL)
+        {
+            // Already cached, so just switch the zone tag.
+
+            result = lump->cache;
+            Z_ChangeTag(lump->cache, tag);
+        }
+        else
+        {
+            // Not yet loaded, so load it now
 
-        lump->cache = Z_Malloc(W_LumpLength(lumpnum), tag, &lump->cache);
-	W_ReadLump (lumpnum, lump->cache);
-        result = lump->cache;
+            lump->cache = Z_Malloc(W_LumpLength(lumpnum), tag, &lump->cache);
+            W_ReadLump (lumpnum, lump->cache);
+            result = lump->cache;
+        }
+
+        W_UnlockCache();
     }
 	
     return result;
@@ -429,6 +469,22 @@ void *W_CacheLumpNum(int lumpnum, int tag)
 
 
 
+//
+// W_LumpInMemory
+//
+// True if W_CacheLumpNum can return the lump without allocating:
+// it is mapped or already cached.
+//
+
+boolean W_LumpInMemory(int lumpnum)
+{
+    lumpinfo_t *lump = &lumpinfo[lumpnum];
+
+    return W_LumpIsMapped(lump) || lump->cache != NULL;
+}
+
+
+
 //
 // W_CacheLumpName
 //
@@ -458,13 +514,15 @@ void W_ReleaseLumpNum(int lumpnum)
 
     lump = &lumpinfo[lumpnum];
 
-    if (lump->wad_file->mapped != NULL)
+    if (W_LumpIsMapped(lump))
     {
         // Memory-mapped file, so nothing needs to be done here.
     }
     else
     {
+        W_LockCache();
         Z_ChangeTag(lump->cache, PU_CACHE);
+        W_UnlockCache();
     }
 }
 
@@ -21,6 +21,10 @@
 #include "i_system.h"
 #include "doomtype.h"
 
+#ifdef RENDER_SMP
+#include "smp.h"
+#endif
+
 
 //
 // ZONE MEMORY ALLOCATION
@@ -63,6 +67,25 @@ typedef struct
 
 memzone_t*	mainzone;
 
+// While held, purgable blocks are kept: lumps cached by harts
+//  rendering in parallel stay valid until the frame is done.
+static int	purgelocks;
+
+// Called when an allocation fails while purging is locked
+//  (see Z_SetPurgeRelease).
+static boolean	(*purgerelease) (void);
+
+// The game loop and the harts rendering in the background
+//  allocate from the same zone.
+#ifdef RENDER_SMP
+static spinlock_t	zonelock;
+#define Z_Lock()	spin_lock (&zonelock)
+#define Z_Unlock()	spin_unlock (&zonelock)
+#else
+#define Z_Lock()
+#define Z_Unlock()
+#endif
+
 
 
 //
@@ -121,9 +144,10 @@ void Z_Init (void)
 
 
 //
-// Z_Free
+// Z_FreeBlock
+// Z_Free with the zone lock held.
 //
-void Z_Free (void* ptr)
+static void Z_FreeBlock (void* ptr)
 {
     memblock_t*		block;
     memblock_t*		other;
@@ -173,6 +197,17 @@ void Z_Free (void* ptr)
 }
 
 
+//
+// Z_Free
+//
+void Z_Free (void* ptr)
+{
+    Z_Lock ();
+    Z_FreeBlock (ptr);
+    Z_Unlock ();
+}
+
+
 
 //
 // Z_Malloc
@@ -203,6 +238,8 @@ Z_Malloc
 
     // account for size of block header
     size += sizeof(memblock_t);
+
+    Z_Lock ();
     
     // if there is a free block behind the rover,
     //  back up over them
@@ -219,12 +256,19 @@ Z_Malloc
         if (rover == start)
         {
             // scanned all the way around the list
+            Z_Unlock ();
+
+            // the blocks kept by the lock can be purged once it is
+            //  released: try again
+            if (purgelocks > 0 && purgerelease != NULL && purgerelease ())
+                return Z_Malloc (size - sizeof(memblock_t), tag, user);
+
             I_Error ("Z_Malloc: failed on allocation of %i bytes", size);
         }
 	
         if (rover->tag != PU_FREE)
         {
-            if (rover->tag < PU_PURGELEVEL)
+            if (rover->tag < PU_PURGELEVEL || purgelocks > 0)
             {
                 // hit a block that can't be purged,
                 // so move base past it
@@ -236,7 +280,7 @@ Z_Malloc
 
                 // the rover can be the base block
                 base = base->prev;
-                Z_Free ((byte *)rover+sizeof(memblock_t));
+                Z_FreeBlock ((byte *)rover+sizeof(memblock_t));
                 base = base->next;
                 rover = base->next;
             }
@@ -269,7 +313,10 @@ Z_Malloc
     }
 	
 	if (user == NULL && tag >= PU_PURGELEVEL)
+	{
+	    Z_Unlock ();
 	    I_Error ("Z_Malloc: an owner is required for purgable blocks");
+	}
 
     base->user = user;
     base->tag = tag;
@@ -285,6 +332,8 @@ Z_Malloc
     mainzone->rover = base->next;	
 	
     base->id = ZONEID;
+
+    Z_Unlock ();
     
     return result;
 }
@@ -301,6 +350,8 @@ Z_FreeTags
 {
     memblock_t*	block;
     memblock_t*	next;
+
+    Z_Lock ();
 	
     for (block = mainzone->blocklist.next ;
 	 block != &mainzone->blocklist ;
@@ -314,8 +365,10 @@ Z_FreeTags
 	    continue;
 	
 	if (block->tag >= lowtag && block->tag <= hightag)
-	    Z_Free ( (byte *)block+sizeof(memblock_t));
+	    Z_FreeBlock ( (byte *)block+sizeof(memblock_t));
     }
+
+    Z_Unlock ();
 }
 
 
@@ -440,7 +493,9 @@ void Z_ChangeTag2(void *ptr, int tag, char *file, int line)
         I_Error("%s:%i: Z_ChangeTag: an owner is required "
                 "for purgable blocks", file, line);
 
+    Z_Lock ();
     block->tag = tag;
+    Z_Unlock ();
 }
 
 void Z_ChangeUser(void *ptr, void **user)
@@ -454,8 +509,34 @@ void Z_ChangeUser(void *ptr, void **user)
         I_Error("Z_ChangeUser: Tried to change user for invalid block!");
     }
 
+    Z_Lock ();
     block->user = user;
     *user = ptr;
+    Z_Unlock ();
+}
+
+
+
+//
+// Z_SetPurgeLock
+// Calls nest: purging resumes when every lock is released.
+//
+void Z_SetPurgeLock(boolean locked)
+{
+    Z_Lock ();
+    purgelocks += locked ? 1 : -1;
+    Z_Unlock ();
+}
+
+//
+// Z_SetPurgeRelease
+// func is called by Z_Malloc when it runs out of memory while purging
+//  is locked. It returns true once it has released its lock, and the
+//  allocation is then tried again.
+//
+void Z_SetPurgeRelease(boolean (*func) (void))
+{
+    purgerelease = func;
 }
 
 
@@ -486,3 +567,124 @@ unsigned int Z_ZoneSize(void)
     return mainzone->size;
 }
 
+
+
+//
+// ARENAS
+//
+struct arenablock_s
+{
+    arenablock_t*	next;
+    size_t		size;		// bytes after the header
+};
+
+// Smallest block taken from the zone.
+#define ARENA_MINBLOCK	(16 * 1024)
+
+static void Z_ArenaAddBlock (arena_t* arena, size_t size)
+{
+    arenablock_t*	block;
+
+    block = Z_Malloc (sizeof(arenablock_t) + size, PU_STATIC, NULL);
+    block->next = arena->blocks;
+    block->size = size;
+
+    arena->blocks = block;
+    arena->rover = (byte *) (block + 1);
+    arena->end = arena->rover + size;
+}
+
+//
+// Z_ArenaAlloc
+// The memory stays valid until the next Z_ArenaReset.
+//
+void* Z_ArenaAlloc (arena_t* arena, size_t size)
+{
+    size_t	blocksize;
+    void*	result;
+
+    size = (size + MEM_ALIGN - 1) & ~(MEM_ALIGN - 1);
+
+    if (arena->blocks == NULL || (size_t) (arena->end - arena->rover) < size)
+    {
+	// each new block twice as large as the last one
+	blocksize = ARENA_MINBLOCK;
+
+	if (arena->blocks != NULL && arena->blocks->size * 2 > blocksize)
+	    blocksize = arena->blocks->size * 2;
+
+	if (size > blocksize)
+	    blocksize = size;
+
+	Z_ArenaAddBlock (arena, blocksize);
+    }
+
+    result = arena->rover;
+    arena->rover += size;
+    arena->used += size;
+
+    if (arena->used > arena->peak)
+	arena->peak = arena->used;
+
+    return result;
+}
+
+//
+// Z_ArenaMerge
+// Replaces the blocks of the arena with one of size bytes.
+//
+static void Z_ArenaMerge (arena_t* arena, size_t size)
+{
+    arenablock_t*	block;
+    arenablock_t*	next;
+
+    for (block = arena->blocks; block != NULL; block = next)
+    {
+	next = block->next;
+	Z_Free (block);
+    }
+
+    arena->blocks = NULL;
+    Z_ArenaAddBlock (arena, size);
+}
+
+//
+// Z_ArenaReset
+// Releases everything allocated from the arena.
+//
+void Z_ArenaReset (arena_t* arena)
+{
+    if (arena->blocks != NULL && arena->blocks->next != NULL)
+    {
+	Z_ArenaMerge (arena, arena->peak);
+    }
+
+    if (arena->blocks != NULL)
+    {
+	arena->rover = (byte *) (arena->blocks + 1);
+	arena->end = arena->rover + arena->blocks->size;
+    }
+
+    arena->used = 0;
+}
+
+//
+// Z_ArenaReserve
+// Releases everything allocated from the arena and makes it one block
+//  of at least size bytes, so that allocating that much until the next
+//  reset takes nothing from the zone.
+//
+void Z_ArenaReserve (arena_t* arena, size_t size)
+{
+    if (size < arena->peak)
+	size = arena->peak;
+
+    if (size > 0
+     && (arena->blocks == NULL || arena->blocks->next != NULL
+	 || arena->blocks->size < size))
+    {
+	Z_ArenaMerge (arena, size);
+    }
+
+    Z_ArenaReset (arena);
+}
@@ -26,6 +26,8 @@
 
 #include <stdio.h>
 
+#include "doomtype.h"
+
 //
 // ZONE MEMORY
 // PU - purge tags.
@@ -59,9 +61,37 @@ void    Z_FileDumpHeap (FILE *f);
 void    Z_CheckHeap (void);
 void    Z_ChangeTag2 (void *ptr, int tag, char *file, int line);
 void    Z_ChangeUser(void *ptr, void **user);
+void    Z_SetPurgeLock(boolean locked);
+void    Z_SetPurgeRelease(boolean (*func) (void));
 int     Z_FreeMemory (void);
 unsigned int Z_ZoneSize(void);
 
+//
+// ARENAS
+// Bump allocation of memory that is all released at once, such as
+//  what the refresh needs for one frame. Blocks come from the zone;
+//  a reset merges them into one block as large as the most ever
+//  allocated between resets, so in steady state allocating is only
+//  moving a pointer. The refresh takes its visplanes, openings,
+//  drawsegs, clip ranges and vissprites from arenas reset at the
+//  start of every frame, so there is no limit on their number.
+//
+typedef struct arenablock_s arenablock_t;
+
+typedef struct
+{
+    arenablock_t*	blocks;		// the current one first
+    byte*		rover;		// free space in the current block
+    byte*		end;
+    size_t		used;		// bytes allocated since the reset
+    size_t		peak;		// most bytes allocated between resets
+
+} arena_t;
+
+void*	Z_ArenaAlloc (arena_t* arena, size_t size);
+void	Z_ArenaReset (arena_t* arena);
+void	Z_ArenaReserve (arena_t* arena, size_t size);
+
 //
 // This is used to get the local FILE:LINE info from CPP
 // prior to really call the function in question.